@@ -0,0 +1,46 @@
+#include "threadpool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threadCount) : stopping(false)
+{
+    if (threadCount == 0)
+        threadCount = max(1u, thread::hardware_concurrency());
+
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueReady.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        function<void()> task;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            queueReady.wait(lock, [this]()
+                            { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+size_t ThreadPool::size() const
+{
+    return workers.size();
+}
@@ -0,0 +1,53 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+using namespace std;
+
+// Fixed-size pool of worker threads. Tasks run in submission order across
+// the workers; exceptions thrown by a task surface from its future.
+class ThreadPool
+{
+private:
+    vector<thread> workers;
+    queue<function<void()>> tasks;
+    mutex queueMutex;
+    condition_variable queueReady;
+    bool stopping;
+
+    // Helper methods
+    void workerLoop();
+
+public:
+    // Constructor/Destructor
+    explicit ThreadPool(size_t threadCount = 0); // 0 = one per hardware thread
+    ~ThreadPool();                               // finishes queued tasks, then joins
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t size() const;
+
+    template <typename Task>
+    future<void> submit(Task task)
+    {
+        auto packaged = make_shared<packaged_task<void()>>(std::move(task));
+        future<void> result = packaged->get_future();
+        {
+            lock_guard<mutex> lock(queueMutex);
+            tasks.push([packaged]()
+                       { (*packaged)(); });
+        }
+        queueReady.notify_one();
+        return result;
+    }
+};
+
+#endif
@@ -9,6 +9,7 @@
 #include <ctime>
 #include <iomanip>
 #include <sstream>
+#include <climits>
 
 // Include all your headers
 #include "User/user.h"
@@ -20,31 +21,24 @@
 #include "Reservation/reservation.h"
 #include "Notification/notification.h"
 #include "LibraryEvent/libraryevent.h"
-#include "Persistence/persistence.h"
+#include "Registry/catalogcolumns.h"
+#include "Service/libraryservice.h"
 
 using namespace std;
 
+// Console front end. Library state and rules live in LibraryService; this
+// class reads input, calls the service and prints the outcome.
 class LibrarySystem
 {
 private:
-    vector<User> users;
-    vector<unique_ptr<Resource>> resources;
-    vector<Loan> loans;
-    vector<Reservation> reservations;
-    vector<Notification> notifications;
-    vector<LibraryEvent> events;
-
+    LibraryService service;
     string currentUserId;
-    const string DATA_FILE = "library_data.json";
 
     // Helper methods
-    string generateId(const string &prefix);
-    User *findUser(const string &userId);
-    Resource *findResource(const string &resourceId);
-    Loan *findActiveLoan(const string &userId, const string &resourceId);
     void displayMenu();
     void displayUserMenu();
     void displayAdminMenu();
+    static void displayResource(const Resource &resource);
 
     // User operations
     void registerUser();
@@ -55,6 +49,7 @@ private:
     void addResource();
     void searchResources();
     void displayAllResources();
+    void filterResources();
     void removeResource();
 
     // Loan operations
@@ -73,7 +68,7 @@ private:
     // Notification operations
     void sendNotification();
     void viewMyNotifications();
-    void markNotificationRead();
+    void markNotificationRead(const string &notificationId);
 
     // Event operations
     void createEvent();
@@ -81,30 +76,32 @@ private:
 
     // Utility methods
     void saveData();
-    void loadData();
     bool isAdmin();
     string getCurrentTimestamp();
     void checkOverdueLoans();
+    void viewSnapshotStats();
 
 public:
-    LibrarySystem();
+    // dataFile may be a .json file or a .lsm store directory
+    LibrarySystem(const string &dataFile = "library_data.json");
     ~LibrarySystem();
 
     void run();
 };
 
 // Implementation
-LibrarySystem::LibrarySystem()
+LibrarySystem::LibrarySystem(const string &dataFile)
+    : service(dataFile)
 {
-    loadData();
-
-    // Create default admin user if no users exist
-    if (users.empty())
-    {
-        User admin("admin001", "System Administrator", "admin@library.com", UserRole::LibraryAdmin);
-        users.push_back(admin);
+    const LoadReport &report = service.loadReport();
+    if (report.loaded)
+        cout << "Data loaded successfully.\n";
+    if (report.recovered > 0)
+        cout << "Recovered " << report.recovered << " logged change(s).\n";
+    if (report.skipped > 0)
+        cout << "Skipped " << report.skipped << " unreadable logged change(s).\n";
+    if (report.createdAdmin)
         cout << "Default admin user created: admin001\n";
-    }
 }
 
 LibrarySystem::~LibrarySystem()
@@ -112,40 +109,10 @@ LibrarySystem::~LibrarySystem()
     saveData();
 }
 
-string LibrarySystem::generateId(const string &prefix)
-{
-    static int counter = 1000;
-    return prefix + to_string(++counter);
-}
-
-User *LibrarySystem::findUser(const string &userId)
-{
-    auto it = find_if(users.begin(), users.end(),
-                      [&userId](const User &user)
-                      { return user.getUserId() == userId; });
-    return (it != users.end()) ? &(*it) : nullptr;
-}
-
-Resource *LibrarySystem::findResource(const string &resourceId)
-{
-    auto it = find_if(resources.begin(), resources.end(),
-                      [&resourceId](const unique_ptr<Resource> &resource)
-                      {
-                          return resource->getResourceId() == resourceId;
-                      });
-    return (it != resources.end()) ? it->get() : nullptr;
-}
-
-Loan *LibrarySystem::findActiveLoan(const string &userId, const string &resourceId)
+void LibrarySystem::displayResource(const Resource &resource)
 {
-    auto it = find_if(loans.begin(), loans.end(),
-                      [&userId, &resourceId](const Loan &loan)
-                      {
-                          return loan.getUserId() == userId &&
-                                 loan.getResourceId() == resourceId &&
-                                 !loan.getIsReturned();
-                      });
-    return (it != loans.end()) ? &(*it) : nullptr;
+    resource.displayInfo();
+    cout << "---\n";
 }
 
 void LibrarySystem::displayMenu()
@@ -171,6 +138,7 @@ void LibrarySystem::displayUserMenu()
     cout << "8. View My Reservations\n";
     cout << "9. View My Notifications\n";
     cout << "10. View All Resources\n";
+    cout << "11. Filter Resources\n";
     cout << "0. Logout\n";
     cout << "Choose an option: ";
 }
@@ -188,6 +156,8 @@ void LibrarySystem::displayAdminMenu()
     cout << "8. Create Event\n";
     cout << "9. View Events\n";
     cout << "10. Check Overdue Loans\n";
+    cout << "11. Snapshot Statistics\n";
+    cout << "12. Filter Resources\n";
     cout << "0. Logout\n";
     cout << "Choose an option: ";
 }
@@ -208,12 +178,11 @@ void LibrarySystem::registerUser()
     cin >> roleChoice;
 
     UserRole role = (roleChoice == 2) ? UserRole::Teacher : UserRole::Student;
-    string userId = generateId("USER");
-
-    User newUser(userId, name, email, role);
-    users.push_back(newUser);
-
-    cout << "User registered successfully! Your ID: " << userId << "\n";
+    ServiceResult result = service.registerUser(name, email, role);
+    if (result.ok())
+        cout << "User registered successfully! Your ID: " << result.id << "\n";
+    else
+        cout << LibraryService::statusMessage(result.status) << "\n";
 }
 
 void LibrarySystem::loginUser()
@@ -222,11 +191,11 @@ void LibrarySystem::loginUser()
     cout << "Enter User ID: ";
     cin >> userId;
 
-    User *user = findUser(userId);
-    if (user)
+    User user;
+    if (service.getUser(userId, user))
     {
         currentUserId = userId;
-        cout << "Login successful! Welcome, " << user->getName() << "\n";
+        cout << "Login successful! Welcome, " << user.getName() << "\n";
     }
     else
     {
@@ -247,7 +216,7 @@ void LibrarySystem::addResource()
     cin >> type;
 
     string title, author, category;
-    int year;
+    int year, copies;
 
     cout << "Enter title: ";
     cin.ignore();
@@ -262,7 +231,11 @@ void LibrarySystem::addResource()
     cout << "Enter publication year: ";
     cin >> year;
 
-    string resourceId = generateId("RES");
+    cout << "Enter number of copies: ";
+    cin >> copies;
+
+    // The service assigns the ID
+    unique_ptr<Resource> resource;
 
     switch (type)
     {
@@ -285,7 +258,7 @@ void LibrarySystem::addResource()
         cout << "Enter edition: ";
         getline(cin, edition);
 
-        resources.push_back(make_unique<Book>(title, author, resourceId, category, year, publisher, pages, isbn, edition));
+        resource = make_unique<Book>(title, author, "", category, year, publisher, pages, isbn, edition);
         break;
     }
     case 2:
@@ -313,7 +286,7 @@ void LibrarySystem::addResource()
         cout << "Enter end page: ";
         cin >> endPage;
 
-        resources.push_back(make_unique<Article>(title, author, resourceId, category, year, magazine, volume, issue, doi, startPage, endPage));
+        resource = make_unique<Article>(title, author, "", category, year, magazine, volume, issue, doi, startPage, endPage);
         break;
     }
     case 3:
@@ -347,12 +320,20 @@ void LibrarySystem::addResource()
         cin.ignore();
         getline(cin, abstractText);
 
-        resources.push_back(make_unique<Thesis>(title, author, resourceId, category, year, university, department, supervisor, thesisType, degree, pages, abstractText));
+        resource = make_unique<Thesis>(title, author, "", category, year, university, department, supervisor, thesisType, degree, pages, abstractText);
         break;
     }
+    default:
+        cout << "Invalid resource type!\n";
+        return;
     }
 
-    cout << "Resource added successfully! ID: " << resourceId << "\n";
+    resource->setCopies(copies);
+    ServiceResult result = service.addResource(currentUserId, std::move(resource));
+    if (result.ok())
+        cout << "Resource added successfully! ID: " << result.id << "\n";
+    else
+        cout << LibraryService::statusMessage(result.status) << "\n";
 }
 
 void LibrarySystem::searchResources()
@@ -363,72 +344,87 @@ void LibrarySystem::searchResources()
     getline(cin, keyword);
 
     cout << "\n=== Search Results ===\n";
-    bool found = false;
-
-    for (const auto &resource : resources)
-    {
-        if (resource->matchesKeyword(keyword))
-        {
-            resource->displayInfo();
-            cout << "---\n";
-            found = true;
-        }
-    }
-
-    if (!found)
+    if (service.searchResources(keyword, displayResource) == 0)
     {
         cout << "No resources found matching '" << keyword << "'\n";
     }
 }
 
+void LibrarySystem::filterResources()
+{
+    CatalogFilter filter;
+    int typeChoice;
+    string category, author;
+    char availableChoice;
+
+    cout << "Select type:\n0. Any\n1. Book\n2. Article\n3. Thesis\nChoice: ";
+    cin >> typeChoice;
+    if (typeChoice >= 1 && typeChoice <= 3)
+        filter.kind = static_cast<ResourceKind>(typeChoice);
+
+    cout << "Enter category (blank for any): ";
+    cin.ignore();
+    getline(cin, category);
+    filter.category = CatalogColumns::symbolKey(category);
+
+    cout << "Enter author (blank for any): ";
+    getline(cin, author);
+    filter.author = CatalogColumns::symbolKey(author);
+
+    cout << "Published from year (0 for any): ";
+    cin >> filter.minYear;
+    if (filter.minYear == 0)
+        filter.minYear = INT_MIN; // also matches resources with no valid year
+    cout << "Published up to year (0 for any): ";
+    cin >> filter.maxYear;
+    if (filter.maxYear == 0)
+        filter.maxYear = INT_MAX;
+
+    cout << "Available only? (y/n): ";
+    cin >> availableChoice;
+    filter.availableOnly = (availableChoice == 'y' || availableChoice == 'Y');
+
+    cout << "\n=== Filter Results ===\n";
+    size_t found = service.filterResources(filter, displayResource);
+    cout << found << " resource(s) found.\n";
+}
+
 void LibrarySystem::displayAllResources()
 {
     cout << "\n=== All Resources ===\n";
-    for (const auto &resource : resources)
-    {
-        resource->displayInfo();
-        cout << "---\n";
-    }
+    service.forEachResource(displayResource);
 }
 
-void LibrarySystem::borrowResource()
+void LibrarySystem::removeResource()
 {
     string resourceId;
-    cout << "Enter Resource ID to borrow: ";
+    cout << "Enter Resource ID to remove: ";
     cin >> resourceId;
 
-    Resource *resource = findResource(resourceId);
-    if (!resource)
-    {
-        cout << "Resource not found!\n";
-        return;
-    }
+    ServiceResult result = service.removeResource(currentUserId, resourceId);
+    if (result.ok())
+        cout << "Resource removed successfully!\n";
+    else
+        cout << LibraryService::statusMessage(result.status) << "\n";
+}
 
-    if (!resource->getAvailable())
-    {
-        cout << "Resource is not available for borrowing!\n";
-        return;
-    }
+void LibrarySystem::borrowResource()
+{
+    string resourceId;
+    cout << "Enter Resource ID to borrow: ";
+    cin >> resourceId;
 
-    // Check if user already has this resource
-    if (findActiveLoan(currentUserId, resourceId))
+    LoanResult result = service.borrowResource(currentUserId, resourceId);
+    if (!result.ok())
     {
-        cout << "You already have this resource borrowed!\n";
+        cout << LibraryService::statusMessage(result.status) << "\n";
         return;
     }
 
-    string loanId = generateId("LOAN");
-    time_t now = time(nullptr);
-    time_t dueDate = now + Loan::getLoanPeriod();
-
-    Loan newLoan(loanId, currentUserId, resourceId, now, dueDate);
-    loans.push_back(newLoan);
-
-    resource->setAvailable(false);
-
     cout << "Resource borrowed successfully!\n";
-    cout << "Loan ID: " << loanId << "\n";
-    cout << "Due Date: " << ctime(&dueDate);
+    cout << "Loan ID: " << result.loanId << "\n";
+    cout << "Copy: " << result.copyNumber << "\n";
+    cout << "Due Date: " << ctime(&result.dueDate);
 }
 
 void LibrarySystem::returnResource()
@@ -437,22 +433,11 @@ void LibrarySystem::returnResource()
     cout << "Enter Resource ID to return: ";
     cin >> resourceId;
 
-    Loan *loan = findActiveLoan(currentUserId, resourceId);
-    if (!loan)
-    {
-        cout << "No active loan found for this resource!\n";
-        return;
-    }
-
-    loan->markReturned();
-
-    Resource *resource = findResource(resourceId);
-    if (resource)
-    {
-        resource->setAvailable(true);
-    }
-
-    cout << "Resource returned successfully!\n";
+    LoanResult result = service.returnResource(currentUserId, resourceId);
+    if (result.ok())
+        cout << "Resource returned successfully!\n";
+    else
+        cout << LibraryService::statusMessage(result.status) << "\n";
 }
 
 void LibrarySystem::renewLoan()
@@ -461,47 +446,60 @@ void LibrarySystem::renewLoan()
     cout << "Enter Resource ID to renew: ";
     cin >> resourceId;
 
-    Loan *loan = findActiveLoan(currentUserId, resourceId);
-    if (!loan)
-    {
-        cout << "No active loan found for this resource!\n";
-        return;
-    }
+    LoanResult result = service.renewLoan(currentUserId, resourceId);
+    if (result.ok())
+        cout << "Loan renewed successfully!\n";
+    else
+        cout << LibraryService::statusMessage(result.status) << "\n";
+}
+
+void LibrarySystem::viewMyLoans()
+{
+    cout << "\n=== My Loans ===\n";
+    vector<Loan> loans = service.activeLoansFor(currentUserId);
 
-    if (loan->renew())
+    for (const auto &loan : loans)
     {
-        cout << "Loan renewed successfully!\n";
+        cout << "Loan ID: " << loan.getLoanId() << "\n";
+        cout << "Resource ID: " << loan.getResourceId() << "\n";
+        cout << "Copy: " << loan.getCopyNumber() << "\n";
+        cout << "Borrow Date: " << loan.getBorrowDate();
+        cout << "Due Date: " << loan.getDueDate();
+        cout << "Renewals: " << loan.getRenewalCount() << "/" << Loan::getMaxRenewals() << "\n";
+        if (loan.isOverdue())
+        {
+            cout << "*** OVERDUE ***\n";
+        }
+        cout << "---\n";
     }
-    else
+
+    if (loans.empty())
     {
-        cout << "Cannot renew loan. Maximum renewals reached.\n";
+        cout << "No active loans found.\n";
     }
 }
 
-void LibrarySystem::viewMyLoans()
+void LibrarySystem::viewAllLoans()
 {
-    cout << "\n=== My Loans ===\n";
-    bool found = false;
+    cout << "\n=== All Active Loans ===\n";
+    vector<Loan> loans = service.allActiveLoans();
 
     for (const auto &loan : loans)
     {
-        if (loan.getUserId() == currentUserId && !loan.getIsReturned())
+        time_t dueDate = loan.getDueDate();
+        cout << "Loan ID: " << loan.getLoanId() << "\n";
+        cout << "User ID: " << loan.getUserId() << "\n";
+        cout << "Resource ID: " << loan.getResourceId() << "\n";
+        cout << "Copy: " << loan.getCopyNumber() << "\n";
+        cout << "Due Date: " << ctime(&dueDate);
+        if (loan.isOverdue())
         {
-            cout << "Loan ID: " << loan.getLoanId() << "\n";
-            cout << "Resource ID: " << loan.getResourceId() << "\n";
-            cout << "Borrow Date: " << loan.getBorrowDate();
-            cout << "Due Date: " << loan.getDueDate();
-            cout << "Renewals: " << loan.getRenewalCount() << "/" << Loan::getMaxRenewals() << "\n";
-            if (loan.isOverdue())
-            {
-                cout << "*** OVERDUE ***\n";
-            }
-            cout << "---\n";
-            found = true;
+            cout << "*** OVERDUE ***\n";
         }
+        cout << "---\n";
     }
 
-    if (!found)
+    if (loans.empty())
     {
         cout << "No active loans found.\n";
     }
@@ -513,92 +511,177 @@ void LibrarySystem::makeReservation()
     cout << "Enter Resource ID to reserve: ";
     cin >> resourceId;
 
-    Resource *resource = findResource(resourceId);
-    if (!resource)
+    ServiceResult result = service.makeReservation(currentUserId, resourceId);
+    if (!result.ok())
     {
-        cout << "Resource not found!\n";
+        cout << LibraryService::statusMessage(result.status) << "\n";
         return;
     }
 
-    if (resource->getAvailable())
-    {
-        cout << "Resource is available. You can borrow it directly!\n";
-        return;
-    }
-
-    string reservationId = generateId("RES");
-    time_t now = time(nullptr);
+    cout << "Reservation made successfully!\n";
+    cout << "Reservation ID: " << result.id << "\n";
+}
 
-    Reservation newReservation(reservationId, currentUserId, resourceId, now);
-    reservations.push_back(newReservation);
+void LibrarySystem::cancelReservation()
+{
+    string reservationId;
+    cout << "Enter Reservation ID to cancel: ";
+    cin >> reservationId;
 
-    cout << "Reservation made successfully!\n";
-    cout << "Reservation ID: " << reservationId << "\n";
+    ServiceResult result = service.cancelReservation(currentUserId, reservationId);
+    if (result.ok())
+        cout << "Reservation canceled successfully!\n";
+    else
+        cout << LibraryService::statusMessage(result.status) << "\n";
 }
 
 void LibrarySystem::viewMyReservations()
 {
     cout << "\n=== My Reservations ===\n";
-    bool found = false;
+    vector<Reservation> reservations = service.pendingReservationsFor(currentUserId);
 
     for (const auto &reservation : reservations)
     {
-        if (reservation.getUserId() == currentUserId && reservation.isPending())
-        {
-            cout << "Reservation ID: " << reservation.getReservationId() << "\n";
-            cout << "Resource ID: " << reservation.getResourceId() << "\n";
-            cout << "Reservation Date: " << reservation.getReservationDate();
-            cout << "Status: Pending\n";
-            cout << "---\n";
-            found = true;
-        }
+        cout << "Reservation ID: " << reservation.getReservationId() << "\n";
+        cout << "Resource ID: " << reservation.getResourceId() << "\n";
+        cout << "Reservation Date: " << reservation.getReservationDate();
+        cout << "Status: Pending\n";
+        cout << "---\n";
     }
 
-    if (!found)
+    if (reservations.empty())
     {
         cout << "No pending reservations found.\n";
     }
 }
 
+void LibrarySystem::fulfillReservation()
+{
+    vector<Reservation> pending = service.allPendingReservations();
+    cout << "\n=== Pending Reservations ===\n";
+    for (const auto &reservation : pending)
+    {
+        cout << reservation.getReservationId() << ": " << reservation.getResourceId()
+             << " for " << reservation.getUserId() << "\n";
+    }
+    if (pending.empty())
+    {
+        cout << "No pending reservations found.\n";
+        return;
+    }
+
+    string reservationId;
+    cout << "Enter Reservation ID to fulfill: ";
+    cin >> reservationId;
+
+    ServiceResult result = service.fulfillReservation(currentUserId, reservationId);
+    if (result.ok())
+        cout << "Reservation fulfilled. The user has been notified.\n";
+    else
+        cout << LibraryService::statusMessage(result.status) << "\n";
+}
+
 void LibrarySystem::viewMyNotifications()
 {
     cout << "\n=== My Notifications ===\n";
-    bool found = false;
+    vector<Notification> notifications = service.notificationsFor(currentUserId);
 
-    for (auto &notification : notifications)
+    for (const auto &notification : notifications)
     {
-        if (notification.getUserId() == currentUserId)
-        {
-            cout << "ID: " << notification.getNotificationId() << "\n";
-            cout << "Message: " << notification.getMessage() << "\n";
-            cout << "Sent: " << notification.getSentDate();
-            cout << "Status: " << (notification.isRead() ? "Read" : "Unread") << "\n";
+        cout << "ID: " << notification.getNotificationId() << "\n";
+        cout << "Message: " << notification.getMessage() << "\n";
+        cout << "Sent: " << notification.getSentDate();
+        cout << "Status: " << (notification.isRead() ? "Read" : "Unread") << "\n";
 
-            if (!notification.isRead())
+        if (!notification.isRead())
+        {
+            cout << "Mark as read? (y/n): ";
+            char choice;
+            cin >> choice;
+            if (choice == 'y' || choice == 'Y')
             {
-                cout << "Mark as read? (y/n): ";
-                char choice;
-                cin >> choice;
-                if (choice == 'y' || choice == 'Y')
-                {
-                    notification.markRead();
-                }
+                markNotificationRead(notification.getNotificationId());
             }
-
-            cout << "---\n";
-            found = true;
         }
+
+        cout << "---\n";
     }
 
-    if (!found)
+    if (notifications.empty())
     {
         cout << "No notifications found.\n";
     }
 }
 
+void LibrarySystem::markNotificationRead(const string &notificationId)
+{
+    ServiceResult result = service.markNotificationRead(currentUserId, notificationId);
+    if (!result.ok())
+        cout << LibraryService::statusMessage(result.status) << "\n";
+}
+
+void LibrarySystem::sendNotification()
+{
+    string userId, message;
+    cout << "Enter recipient User ID: ";
+    cin >> userId;
+
+    User user;
+    if (!service.getUser(userId, user))
+    {
+        cout << "User not found!\n";
+        return;
+    }
+
+    cout << "Enter message: ";
+    cin.ignore();
+    getline(cin, message);
+
+    ServiceResult result = service.sendNotification(currentUserId, userId, message);
+    if (result.ok())
+        cout << "Notification sent successfully!\n";
+    else
+        cout << "Error: " << LibraryService::statusMessage(result.status) << "\n";
+}
+
+void LibrarySystem::createEvent()
+{
+    string title, description, location, date;
+
+    cout << "Enter title: ";
+    cin.ignore();
+    getline(cin, title);
+
+    cout << "Enter description: ";
+    getline(cin, description);
+
+    cout << "Enter date (YYYY-MM-DD HH:MM): ";
+    getline(cin, date);
+
+    cout << "Enter location: ";
+    getline(cin, location);
+
+    tm parsed = {};
+    istringstream dateStream(date);
+    dateStream >> get_time(&parsed, "%Y-%m-%d %H:%M");
+    if (dateStream.fail())
+    {
+        cout << "Invalid date format!\n";
+        return;
+    }
+    parsed.tm_isdst = -1;
+
+    ServiceResult result = service.createEvent(currentUserId, title, description, mktime(&parsed), location);
+    if (result.ok())
+        cout << "Event created successfully! ID: " << result.id << "\n";
+    else
+        cout << LibraryService::statusMessage(result.status) << "\n";
+}
+
 void LibrarySystem::viewEvents()
 {
     cout << "\n=== Library Events ===\n";
+    vector<LibraryEvent> events = service.allEvents();
     if (events.empty())
     {
         cout << "No events scheduled.\n";
@@ -616,27 +699,59 @@ void LibrarySystem::viewEvents()
     }
 }
 
+void LibrarySystem::checkOverdueLoans()
+{
+    vector<Loan> overdue;
+    ServiceStatus status = service.checkOverdueLoans(currentUserId, overdue);
+    if (status != ServiceStatus::Ok)
+    {
+        cout << LibraryService::statusMessage(status) << "\n";
+        return;
+    }
+
+    cout << "\n=== Overdue Loans (" << getCurrentTimestamp() << ") ===\n";
+    for (const auto &loan : overdue)
+    {
+        cout << loan.getLoanId() << ": " << loan.getResourceId() << " borrowed by " << loan.getUserId() << "\n";
+    }
+    cout << overdue.size() << " overdue loan(s). Borrowers have been notified.\n";
+}
+
 bool LibrarySystem::isAdmin()
 {
-    User *user = findUser(currentUserId);
-    return user && (user->getUserRole() == UserRole::LibraryAdmin ||
-                    user->getUserRole() == UserRole::LibraryEmployee);
+    return service.isAdmin(currentUserId);
+}
+
+string LibrarySystem::getCurrentTimestamp()
+{
+    time_t now = time(nullptr);
+    ostringstream oss;
+    oss << put_time(localtime(&now), "%Y-%m-%d %H:%M:%S");
+    return oss.str();
 }
 
 void LibrarySystem::saveData()
 {
-    if (Persistence::saveToFile(DATA_FILE, users, resources, loans, reservations, notifications, events))
+    if (service.close())
     {
         cout << "Data saved successfully.\n";
     }
 }
 
-void LibrarySystem::loadData()
+void LibrarySystem::viewSnapshotStats()
 {
-    if (Persistence::loadFromFile(DATA_FILE, users, resources, loans, reservations, notifications, events))
-    {
-        cout << "Data loaded successfully.\n";
-    }
+    SnapshotMetrics stats = service.snapshotMetrics();
+    cout << "\n=== Snapshot Statistics ===\n";
+    cout << "Completed: " << stats.completed << "\n";
+    cout << "Failed: " << stats.failed << "\n";
+    cout << "Changes since last snapshot: " << service.pendingMutations() << "\n";
+    cout << fixed << setprecision(3);
+    cout << "Last capture: " << stats.lastCaptureSeconds * 1000 << " ms\n";
+    cout << "Last write: " << stats.lastWriteSeconds * 1000 << " ms\n";
+    cout << "Longest write: " << stats.maxWriteSeconds * 1000 << " ms\n";
+    if (stats.completed + stats.failed > 0)
+        cout << "Average write: " << stats.totalWriteSeconds * 1000 / (stats.completed + stats.failed) << " ms\n";
+    cout.unsetf(ios::fixed);
 }
 
 void LibrarySystem::run()
@@ -726,17 +841,35 @@ void LibrarySystem::run()
                     makeReservation();
                 }
                 break;
+            case 6:
+                if (isAdmin())
+                {
+                    fulfillReservation();
+                }
+                else
+                {
+                    cancelReservation();
+                }
+                break;
             case 7:
                 if (!isAdmin())
                 {
                     viewMyLoans();
                 }
+                else
+                {
+                    sendNotification();
+                }
                 break;
             case 8:
                 if (!isAdmin())
                 {
                     viewMyReservations();
                 }
+                else
+                {
+                    createEvent();
+                }
                 break;
             case 9:
                 if (!isAdmin())
@@ -753,6 +886,30 @@ void LibrarySystem::run()
                 {
                     displayAllResources();
                 }
+                else
+                {
+                    checkOverdueLoans();
+                }
+                break;
+            case 11:
+                if (isAdmin())
+                {
+                    viewSnapshotStats();
+                }
+                else
+                {
+                    filterResources();
+                }
+                break;
+            case 12:
+                if (isAdmin())
+                {
+                    filterResources();
+                }
+                else
+                {
+                    cout << "Invalid option!\n";
+                }
                 break;
             case 0:
                 logout();
@@ -762,6 +919,10 @@ void LibrarySystem::run()
             }
         }
 
+        // Everything logged by this operation becomes durable in one fsync
+        if (!service.commit())
+            cout << LibraryService::statusMessage(ServiceStatus::StorageError) << "\n";
+
         cout << "\nPress Enter to continue...";
         cin.ignore();
         cin.get();
@@ -771,11 +932,11 @@ void LibrarySystem::run()
 #endif
 
 // Main function
-int main()
+int main(int argc, char *argv[])
 {
     try
     {
-        LibrarySystem library;
+        LibrarySystem library(argc > 1 ? argv[1] : "library_data.json");
         library.run();
     }
     catch (const exception &e)
@@ -785,4 +946,4 @@ int main()
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -5,21 +5,21 @@
 int Loan::maxRenewals = 2;
 int Loan::loanPeriod = 1209600;
 
-Loan::Loan(const string &loanId, const string &userId, const string &resourceId, time_t borrowDate, time_t dueDate)
-    : loanId(loanId), userId(userId), resourceId(resourceId), borrowDate(borrowDate), dueDate(dueDate), returnDate(0), renewalCount(0), isReturned(false) 
+Loan::Loan(const string &loanId, const string &userId, const string &resourceId, time_t borrowDate, time_t dueDate, int copyNumber)
+    : loanId(loanId), user(IdInterner::none), resource(IdInterner::none), borrowDate(borrowDate), dueDate(dueDate), returnDate(0), copyNumber(copyNumber), renewalCount(0), isReturned(false) 
 {
     if (!loanId.empty() && !isValidLoanId(loanId)) {
         cerr << "Warning: Invalid loan ID provided. Using empty string." << endl;
         this->loanId = "";
     }
-    if (!userId.empty() && !isValidId(userId)) {
+    if (!userId.empty() && !isValidId(userId))
         cerr << "Warning: Invalid user ID provided. Using empty string." << endl;
-        this->userId = "";
-    }
-    if (!resourceId.empty() && !isValidId(resourceId)) {
+    else
+        user = IdInterner::global().intern(userId);
+    if (!resourceId.empty() && !isValidId(resourceId))
         cerr << "Warning: Invalid resource ID provided. Using empty string." << endl;
-        this->resourceId = "";
-    }
+    else
+        resource = IdInterner::global().intern(resourceId);
     if (borrowDate != 0 && !isValidDate(borrowDate)) {
         cerr << "Warning: Invalid borrow date provided. Using 0." << endl;
         this->borrowDate = 0;
@@ -32,6 +32,10 @@ Loan::Loan(const string &loanId, const string &userId, const string &resourceId,
         cerr << "Warning: Due date must be after borrow date. Setting due date to borrow date + loan period." << endl;
         this->dueDate = borrowDate + loanPeriod;
     }
+    if (copyNumber < 1) {
+        cerr << "Warning: Invalid copy number provided. Using 1." << endl;
+        this->copyNumber = 1;
+    }
 }
 
 const string &Loan::getLoanId() const
@@ -41,12 +45,22 @@ const string &Loan::getLoanId() const
 
 const string &Loan::getUserId() const
 {
-    return userId;
+    return IdInterner::global().name(user);
 }
 
 const string &Loan::getResourceId() const
 {
-    return resourceId;
+    return IdInterner::global().name(resource);
+}
+
+IdInterner::Handle Loan::getUserHandle() const
+{
+    return user;
+}
+
+IdInterner::Handle Loan::getResourceHandle() const
+{
+    return resource;
 }
 
 time_t Loan::getBorrowDate() const
@@ -69,6 +83,11 @@ bool Loan::getIsReturned() const
     return isReturned;
 }
 
+int Loan::getCopyNumber() const
+{
+    return copyNumber;
+}
+
 int Loan::getRenewalCount() const
 {
     return renewalCount;
@@ -109,7 +128,7 @@ bool Loan::renew()
         cerr << "Error: Cannot renew overdue loan." << endl;
         return false;
     }
-    if (loanId.empty() || userId.empty() || resourceId.empty()) {
+    if (loanId.empty() || user == IdInterner::none || resource == IdInterner::none) {
         cerr << "Error: Cannot renew loan with missing information." << endl;
         return false;
     }
@@ -124,7 +143,7 @@ void Loan::markReturned()
         cerr << "Warning: Loan already marked as returned." << endl;
         return;
     }
-    if (loanId.empty() || userId.empty() || resourceId.empty()) {
+    if (loanId.empty() || user == IdInterner::none || resource == IdInterner::none) {
         cerr << "Error: Cannot return loan with missing information." << endl;
         return;
     }
@@ -209,16 +228,22 @@ json Loan::toJson() const
 {
     return json{
         {"loanId", loanId},
-        {"userId", userId},
-        {"resourceId", resourceId},
+        {"userId", getUserId()},
+        {"resourceId", getResourceId()},
         {"borrowDate", borrowDate},
         {"dueDate", dueDate},
         {"returnDate", returnDate},
         {"isReturned", isReturned},
-        {"renewalCount", renewalCount}};
+        {"renewalCount", renewalCount},
+        {"copyNumber", copyNumber}};
 }
 
 Loan Loan::fromJson(const json &j)
+{
+    return fromJson(j, Loan::maxRenewals);
+}
+
+Loan Loan::fromJson(const json &j, int maxRenewals)
 {
     try {
         Loan loan(
@@ -226,7 +251,8 @@ Loan Loan::fromJson(const json &j)
             j.at("userId").get<string>(),
             j.at("resourceId").get<string>(),
             j.at("borrowDate").get<time_t>(),
-            j.at("dueDate").get<time_t>());
+            j.at("dueDate").get<time_t>(),
+            j.value("copyNumber", 1));
         loan.returnDate = j.at("returnDate").get<time_t>();
         loan.isReturned = j.at("isReturned").get<bool>();
         loan.renewalCount = j.at("renewalCount").get<int>();
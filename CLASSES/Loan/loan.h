@@ -3,6 +3,7 @@
 #include <string>
 #include <ctime>
 #include "Json/json.hpp"
+#include "Registry/idinterner.h"
 using namespace std;
 using json = nlohmann::json;
 
@@ -10,11 +11,12 @@ class Loan
 {
 private:
     string loanId;
-    string userId;
-    string resourceId;
+    IdInterner::Handle user;     // interned userId
+    IdInterner::Handle resource; // interned resourceId
     time_t borrowDate;
     time_t dueDate;
     time_t returnDate; // 0 means no return yet
+    int copyNumber;    // which copy of the resource, from 1
     bool isReturned;
     int renewalCount;
     static int maxRenewals;
@@ -26,15 +28,18 @@ private:
     bool isValidDate(time_t date) const;
 
 public:
-    Loan(const string & = "", const string & = "", const string & = "", time_t = 0, time_t = 0);
+    Loan(const string & = "", const string & = "", const string & = "", time_t = 0, time_t = 0, int = 1);
     ~Loan() = default;
 
     const string &getLoanId() const;
     const string &getUserId() const;
     const string &getResourceId() const;
+    IdInterner::Handle getUserHandle() const;
+    IdInterner::Handle getResourceHandle() const;
     time_t getBorrowDate() const;
     time_t getDueDate() const;
     time_t getReturnDate() const;
+    int getCopyNumber() const;
     bool getIsReturned() const;
     int getRenewalCount() const;
     static int getMaxRenewals();
@@ -49,6 +54,9 @@ public:
     // Json
     json toJson() const;
     static Loan fromJson(const json &);
+    // Clamps renewals to maxRenewals instead of the current setting, for
+    // loaders that have read a config but not applied it yet
+    static Loan fromJson(const json &, int maxRenewals);
 };
 
 #endif
\ No newline at end of file
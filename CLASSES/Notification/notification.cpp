@@ -1,12 +1,13 @@
 #include "notification.h"
 
 Notification::Notification(const string &notificationId, const string &userId, const string &message, time_t sentDate, bool readFlag)
-    : notificationId(notificationId), userId(userId), message(message), sentDate(sentDate), readFlag(readFlag)
+    : notificationId(notificationId), user(IdInterner::none), message(message), sentDate(sentDate), readFlag(readFlag)
 {
     validateNotificationId(notificationId);
     validateUserId(userId);
     validateMessage(message);
     validateSentDate(sentDate);
+    user = IdInterner::global().intern(userId);
 }
 
 void Notification::validateNotificationId(const string &id) const
@@ -79,7 +80,12 @@ const string &Notification::getNotificationId() const
 
 const string &Notification::getUserId() const
 {
-    return userId;
+    return IdInterner::global().name(user);
+}
+
+IdInterner::Handle Notification::getUserHandle() const
+{
+    return user;
 }
 
 const string &Notification::getMessage() const
@@ -109,7 +115,7 @@ json Notification::toJson() const
     {
         return json{
             {"notificationId", notificationId},
-            {"userId", userId},
+            {"userId", getUserId()},
             {"message", message},
             {"sentDate", sentDate},
             {"readFlag", readFlag}};
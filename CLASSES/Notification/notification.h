@@ -5,6 +5,7 @@
 #include <ctime>
 #include <stdexcept>
 #include "Json/json.hpp"
+#include "Registry/idinterner.h"
 
 using namespace std;
 using json = nlohmann::json;
@@ -13,7 +14,7 @@ class Notification
 {
 private:
     string notificationId;
-    string userId;
+    IdInterner::Handle user; // interned userId
     string message;
     time_t sentDate;
     bool readFlag;
@@ -32,6 +33,7 @@ public:
     // Getters
     const string &getNotificationId() const;
     const string &getUserId() const;
+    IdInterner::Handle getUserHandle() const;
     const string &getMessage() const;
     time_t getSentDate() const;
     bool isRead() const;
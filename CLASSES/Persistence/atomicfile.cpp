@@ -0,0 +1,111 @@
+#include "atomicfile.h"
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+string AtomicFile::tempPath(const string &target)
+{
+    return target + ".tmp";
+}
+
+// Generation 1 keeps the historical ".backup" name
+string AtomicFile::backupPath(const string &target, size_t generation)
+{
+    string path = target + ".backup";
+    if (generation > 1)
+        path += "." + to_string(generation);
+    return path;
+}
+
+bool AtomicFile::syncFile(const string &path)
+{
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+    if (fd < 0)
+        return false;
+    bool ok = _commit(fd) == 0;
+    _close(fd);
+    return ok;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    bool ok = fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#endif
+}
+
+bool AtomicFile::syncDirectory(const string &directory)
+{
+#ifdef _WIN32
+    // NTFS journals renames; directories cannot be flushed through the CRT
+    (void)directory;
+    return true;
+#else
+    int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+        return false;
+    bool ok = fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#endif
+}
+
+// Shifts backup N-1 -> N ... 1 -> 2 by renaming, then links the live file as
+// generation 1. No file contents are copied unless hard links are unsupported.
+void AtomicFile::rotateBackups(const string &target, size_t generations)
+{
+    error_code ec;
+    if (generations == 0 || !fs::exists(target, ec))
+        return;
+
+    fs::remove(backupPath(target, generations), ec);
+    for (size_t g = generations; g > 1; --g)
+    {
+        if (fs::exists(backupPath(target, g - 1), ec))
+            fs::rename(backupPath(target, g - 1), backupPath(target, g), ec);
+    }
+
+    fs::remove(backupPath(target, 1), ec);
+    fs::create_hard_link(target, backupPath(target, 1), ec);
+    if (ec)
+    {
+        // Backup failed, but don't stop the save operation
+        fs::copy_file(target, backupPath(target, 1), fs::copy_options::overwrite_existing, ec);
+    }
+}
+
+bool AtomicFile::commit(const string &tempPath, const string &target, size_t generations)
+{
+    if (!syncFile(tempPath))
+    {
+        cerr << "Error: Cannot sync " << tempPath << endl;
+        return false;
+    }
+
+    rotateBackups(target, generations);
+
+    error_code ec;
+    fs::rename(tempPath, target, ec);
+    if (ec)
+    {
+        cerr << "Error: Cannot rename " << tempPath << " to " << target << ": " << ec.message() << endl;
+        return false;
+    }
+
+    // Make the rename itself durable
+    fs::path parent = fs::path(target).parent_path();
+    if (!syncDirectory(parent.string()))
+        cerr << "Warning: Cannot sync directory of " << target << endl;
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef ATOMICFILE_H
+#define ATOMICFILE_H
+
+#include <string>
+#include <cstddef>
+using namespace std;
+
+// Crash-safe file replacement: the new contents are written to a temp file,
+// synced, then renamed over the target so readers only ever see a complete
+// old or new file. Older versions are kept as rotated backup generations.
+class AtomicFile
+{
+private:
+    // Helper methods
+    static string backupPath(const string &target, size_t generation);
+    static void rotateBackups(const string &target, size_t generations);
+
+public:
+    static string tempPath(const string &target);
+
+    // Flushes file contents (or a directory entry) to stable storage
+    static bool syncFile(const string &path);
+    static bool syncDirectory(const string &directory);
+
+    // Syncs tempPath, rotates backups of target and renames tempPath over it
+    static bool commit(const string &tempPath, const string &target, size_t generations);
+};
+
+#endif
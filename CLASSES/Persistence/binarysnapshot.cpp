@@ -0,0 +1,256 @@
+#include "binarysnapshot.h"
+#include <stdexcept>
+#include <cstring>
+
+const uint16_t BinarySnapshot::VERSION = 1;
+
+namespace
+{
+    const char MAGIC[4] = {'L', 'M', 'S', 'B'};
+
+    void putLE(ostream &out, uint64_t value, int bytes)
+    {
+        char buf[8];
+        for (int i = 0; i < bytes; ++i)
+            buf[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+        out.write(buf, bytes);
+    }
+
+    uint64_t getLE(istream &in, int bytes)
+    {
+        unsigned char buf[8];
+        if (!in.read(reinterpret_cast<char *>(buf), bytes))
+            throw runtime_error("Truncated snapshot");
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i)
+            value |= static_cast<uint64_t>(buf[i]) << (8 * i);
+        return value;
+    }
+
+    void putBE(ostream &out, uint64_t value, int bytes)
+    {
+        for (int i = bytes - 1; i >= 0; --i)
+            out.put(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+bool BinarySnapshot::formatForPath(const std::string &filepath, Format &format)
+{
+    size_t dotPos = filepath.find_last_of('.');
+    if (dotPos == std::string::npos)
+        return false;
+    std::string extension = filepath.substr(dotPos);
+    if (extension == ".cbor" || extension == ".CBOR")
+    {
+        format = Cbor;
+        return true;
+    }
+    if (extension == ".msgpack" || extension == ".MSGPACK")
+    {
+        format = MsgPack;
+        return true;
+    }
+    return false;
+}
+
+json::input_format_t BinarySnapshot::inputFormat(Format format)
+{
+    return format == Cbor ? json::input_format_t::cbor : json::input_format_t::msgpack;
+}
+
+// Writer
+BinarySnapshot::Writer::Writer(ostream &out, Format format, uint32_t sectionCount)
+    : out(out), format(format), inSection(false)
+{
+    out.write(MAGIC, sizeof(MAGIC));
+    putLE(out, VERSION, 2);
+    putLE(out, format, 1);
+    putLE(out, 0, 1);
+    putLE(out, sectionCount, 4);
+}
+
+// Container headers are written by hand so entities can be streamed one at a
+// time; only major types map (5), text (3) and array (4) are needed.
+void BinarySnapshot::Writer::writeHeader(uint8_t major, uint64_t value)
+{
+    if (format == Cbor)
+    {
+        uint8_t type = static_cast<uint8_t>(major << 5);
+        if (value < 24)
+            out.put(static_cast<char>(type | value));
+        else if (value <= 0xff)
+        {
+            out.put(static_cast<char>(type | 24));
+            putBE(out, value, 1);
+        }
+        else if (value <= 0xffff)
+        {
+            out.put(static_cast<char>(type | 25));
+            putBE(out, value, 2);
+        }
+        else if (value <= 0xffffffff)
+        {
+            out.put(static_cast<char>(type | 26));
+            putBE(out, value, 4);
+        }
+        else
+        {
+            out.put(static_cast<char>(type | 27));
+            putBE(out, value, 8);
+        }
+        return;
+    }
+
+    // MessagePack
+    if (major == 5)
+    {
+        out.put(static_cast<char>(0x80 | value)); // fixmap, sections hold one key
+    }
+    else if (major == 3)
+    {
+        if (value < 32)
+            out.put(static_cast<char>(0xa0 | value));
+        else if (value <= 0xff)
+        {
+            out.put(static_cast<char>(0xd9));
+            putBE(out, value, 1);
+        }
+        else if (value <= 0xffff)
+        {
+            out.put(static_cast<char>(0xda));
+            putBE(out, value, 2);
+        }
+        else
+        {
+            out.put(static_cast<char>(0xdb));
+            putBE(out, value, 4);
+        }
+    }
+    else
+    {
+        if (value < 16)
+            out.put(static_cast<char>(0x90 | value));
+        else if (value <= 0xffff)
+        {
+            out.put(static_cast<char>(0xdc));
+            putBE(out, value, 2);
+        }
+        else
+        {
+            out.put(static_cast<char>(0xdd));
+            putBE(out, value, 4);
+        }
+    }
+}
+
+void BinarySnapshot::Writer::writeKey(const std::string &key)
+{
+    writeHeader(3, key.size());
+    out.write(key.data(), key.size());
+}
+
+void BinarySnapshot::Writer::writeValue(const json &value)
+{
+    if (format == Cbor)
+        json::to_cbor(value, out);
+    else
+        json::to_msgpack(value, out);
+}
+
+void BinarySnapshot::Writer::beginPayload(const std::string &name, uint32_t count)
+{
+    if (inSection)
+        throw logic_error("Snapshot section '" + name + "' opened inside another section");
+    if (name.empty() || name.size() > 255)
+        throw invalid_argument("Invalid snapshot section name");
+
+    putLE(out, name.size(), 1);
+    out.write(name.data(), name.size());
+    putLE(out, count, 4);
+    lengthPos = out.tellp();
+    putLE(out, 0, 8); // patched by endPayload
+    payloadStart = out.tellp();
+    inSection = true;
+
+    writeHeader(5, 1);
+    writeKey(name);
+}
+
+void BinarySnapshot::Writer::endPayload()
+{
+    streampos end = out.tellp();
+    out.seekp(lengthPos);
+    putLE(out, static_cast<uint64_t>(end - payloadStart), 8);
+    out.seekp(end);
+    inSection = false;
+    if (!out)
+        throw runtime_error("Failed to write snapshot section");
+}
+
+void BinarySnapshot::Writer::section(const std::string &name, const json &value)
+{
+    beginPayload(name, 1);
+    writeValue(value);
+    endPayload();
+}
+
+void BinarySnapshot::Writer::beginSection(const std::string &name, uint32_t count)
+{
+    beginPayload(name, count);
+    writeHeader(4, count);
+}
+
+void BinarySnapshot::Writer::element(const json &value)
+{
+    writeValue(value);
+}
+
+void BinarySnapshot::Writer::endSection()
+{
+    endPayload();
+}
+
+// Reader
+vector<BinarySnapshot::Section> BinarySnapshot::readIndex(istream &in, Format &format)
+{
+    char magic[4];
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+        throw runtime_error("Not a binary snapshot (bad magic)");
+
+    uint16_t version = static_cast<uint16_t>(getLE(in, 2));
+    if (version != VERSION)
+        throw runtime_error("Unsupported snapshot version " + to_string(version));
+
+    uint8_t formatByte = static_cast<uint8_t>(getLE(in, 1));
+    if (formatByte != Cbor && formatByte != MsgPack)
+        throw runtime_error("Unknown snapshot format " + to_string(formatByte));
+    format = static_cast<Format>(formatByte);
+    getLE(in, 1); // reserved
+
+    uint32_t sectionCount = static_cast<uint32_t>(getLE(in, 4));
+    vector<Section> sections;
+    for (uint32_t i = 0; i < sectionCount; ++i)
+    {
+        Section section;
+        size_t nameLength = static_cast<size_t>(getLE(in, 1));
+        section.name.resize(nameLength);
+        if (!in.read(&section.name[0], nameLength))
+            throw runtime_error("Truncated snapshot");
+        section.count = static_cast<uint32_t>(getLE(in, 4));
+        section.length = getLE(in, 8);
+        section.offset = static_cast<uint64_t>(in.tellg());
+        if (!in.seekg(static_cast<streamoff>(section.length), ios::cur))
+            throw runtime_error("Truncated snapshot");
+        sections.push_back(std::move(section));
+    }
+    return sections;
+}
+
+void BinarySnapshot::readPayload(istream &in, const Section &section, vector<uint8_t> &payload)
+{
+    payload.resize(section.length);
+    in.clear();
+    in.seekg(static_cast<streamoff>(section.offset));
+    if (!in.read(reinterpret_cast<char *>(payload.data()), section.length))
+        throw runtime_error("Truncated snapshot section '" + section.name + "'");
+}
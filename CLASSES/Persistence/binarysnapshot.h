@@ -0,0 +1,78 @@
+#ifndef BINARYSNAPSHOT_H
+#define BINARYSNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <cstdint>
+#include "Json/json.hpp"
+using namespace std;
+using json = nlohmann::json;
+
+// Binary snapshot container (.cbor / .msgpack).
+// Layout: "LMSB" magic, u16 version, u8 format, u8 reserved, u32 section count,
+// then for each section: u8 name length, name, u32 record count, u64 payload
+// length, payload. Every payload is a self-contained CBOR/MessagePack document
+// {"<section>": ...}, so a section can be skipped or parsed on its own.
+// Integers in the container are little-endian.
+class BinarySnapshot
+{
+public:
+    enum Format : uint8_t
+    {
+        Cbor = 1,
+        MsgPack = 2
+    };
+
+    struct Section
+    {
+        std::string name;
+        uint32_t count = 0;
+        uint64_t offset = 0; // payload position in the file
+        uint64_t length = 0;
+    };
+
+    static const uint16_t VERSION;
+
+    // Streams sections into an output stream opened in binary mode
+    class Writer
+    {
+    private:
+        ostream &out;
+        Format format;
+        streampos lengthPos;
+        streampos payloadStart;
+        bool inSection;
+
+        // Helper methods
+        void beginPayload(const std::string &name, uint32_t count);
+        void endPayload();
+        void writeHeader(uint8_t major, uint64_t value);
+        void writeKey(const std::string &key);
+        void writeValue(const json &value);
+
+    public:
+        // Constructor/Destructor
+        Writer(ostream &out, Format format, uint32_t sectionCount);
+        ~Writer() = default;
+
+        // Single-value section, e.g. config
+        void section(const std::string &name, const json &value);
+
+        // Array section of exactly count elements
+        void beginSection(const std::string &name, uint32_t count);
+        void element(const json &value);
+        void endSection();
+    };
+
+    // Picks the format from the file extension; false for non-binary paths
+    static bool formatForPath(const std::string &filepath, Format &format);
+    static json::input_format_t inputFormat(Format format);
+
+    // Reads the header and section table, leaving payloads unread
+    static vector<Section> readIndex(istream &in, Format &format);
+    static void readPayload(istream &in, const Section &section, vector<uint8_t> &payload);
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "jsonwriter.h"
+
+JsonWriter::JsonWriter(ostream &out, bool pretty) : out(out), pretty(pretty)
+{
+}
+
+void JsonWriter::newline()
+{
+    if (!pretty)
+        return;
+    out << '\n';
+    for (size_t i = 0; i < firstInScope.size(); ++i)
+        out << "  ";
+}
+
+void JsonWriter::separator()
+{
+    if (firstInScope.empty())
+        return;
+    if (!firstInScope.back())
+        out << ',';
+    firstInScope.back() = false;
+    newline();
+}
+
+void JsonWriter::writeValue(const json &value)
+{
+    if (!pretty)
+    {
+        // The stream serializer writes directly, without an intermediate string
+        out << value;
+        return;
+    }
+
+    // Re-indent the entity to its nesting depth. Newlines never occur inside
+    // serialized strings (they are escaped), so every '\n' is structural.
+    string indent(firstInScope.size() * 2, ' ');
+    string text = value.dump(2);
+    size_t start = 0;
+    size_t nl;
+    while ((nl = text.find('\n', start)) != string::npos)
+    {
+        out.write(text.data() + start, nl + 1 - start);
+        out << indent;
+        start = nl + 1;
+    }
+    out.write(text.data() + start, text.size() - start);
+}
+
+void JsonWriter::beginObject()
+{
+    separator();
+    out << '{';
+    firstInScope.push_back(true);
+}
+
+void JsonWriter::endObject()
+{
+    bool empty = firstInScope.back();
+    firstInScope.pop_back();
+    if (!empty)
+        newline();
+    out << '}';
+}
+
+void JsonWriter::beginArray(const std::string &key)
+{
+    separator();
+    out << json(key) << (pretty ? ": [" : ":[");
+    firstInScope.push_back(true);
+}
+
+void JsonWriter::endArray()
+{
+    bool empty = firstInScope.back();
+    firstInScope.pop_back();
+    if (!empty)
+        newline();
+    out << ']';
+}
+
+void JsonWriter::field(const std::string &key, const json &value)
+{
+    separator();
+    out << json(key) << (pretty ? ": " : ":");
+    writeValue(value);
+}
+
+void JsonWriter::element(const json &value)
+{
+    separator();
+    writeValue(value);
+}
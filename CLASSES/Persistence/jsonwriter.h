@@ -0,0 +1,43 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Json/json.hpp"
+using namespace std;
+using json = nlohmann::json;
+
+// Streaming Json writer. Entities are written one at a time straight to the
+// output stream, so no document-sized DOM or string is ever built.
+// Compact output is the default; pretty mode matches json::dump(2) and is
+// meant for debugging.
+class JsonWriter
+{
+private:
+    ostream &out;
+    bool pretty;
+    vector<bool> firstInScope; // one entry per open object/array
+
+    // Helper methods
+    void separator();
+    void newline();
+    void writeValue(const json &value);
+
+public:
+    // Constructor/Destructor
+    JsonWriter(ostream &out, bool pretty = false);
+    ~JsonWriter() = default;
+
+    void beginObject();
+    void endObject();
+    void beginArray(const std::string &key);
+    void endArray();
+
+    // Writes "key": value inside the current object
+    void field(const std::string &key, const json &value);
+    // Writes one element of the current array
+    void element(const json &value);
+};
+
+#endif
@@ -1,8 +1,17 @@
 #include "persistence.h"
 #include "Json/json.hpp"
+#include "saxloader.h"
+#include "jsonwriter.h"
+#include "atomicfile.h"
+#include "sectioneditor.h"
+#include "Concurrency/threadpool.h"
+#include "Registry/idallocator.h"
 #include <fstream>
 #include <filesystem>
 #include <iostream>
+#include <algorithm>
+#include <map>
+#include <mutex>
 
 using json = nlohmann::json;
 namespace fs = std::filesystem;
@@ -36,48 +45,101 @@ void Persistence::validateFileExtension(const string &filepath)
         throw invalid_argument("File must have an extension");
     }
     string extension = filepath.substr(dotPos);
-    if (extension != ".json" && extension != ".JSON")
+    BinarySnapshot::Format format;
+    if (extension != ".json" && extension != ".JSON" && !isStorePath(filepath) &&
+        !BinarySnapshot::formatForPath(filepath, format))
     {
-        throw invalid_argument("File must have .json extension");
+        throw invalid_argument("File must have .json, .cbor, .msgpack or .lsm extension");
     }
 }
 
-bool Persistence::isValidJsonFile(const string &filepath)
+json Persistence::configJson()
 {
-    ifstream ifs(filepath);
-    if (!ifs.is_open())
-        return false;
+    return {{"maxRenewals", Loan::getMaxRenewals()},
+            {"loanPeriodDays", Loan::getLoanPeriod() / (24 * 60 * 60)},
+            {"nextIds", IdAllocator::global().toJson()}};
+}
 
-    try
+namespace
+{
+    size_t chunkCount(size_t records, size_t chunkSize)
     {
-        json j;
-        ifs >> j;
-        return true;
+        return records == 0 ? 1 : (records + chunkSize - 1) / chunkSize;
     }
-    catch (const json::exception &)
+
+    // Splits a section into self-contained chunks so readers can parse them in parallel
+    template <typename Item, typename ToJson>
+    void writeChunks(BinarySnapshot::Writer &writer, const string &name, const vector<Item> &items, size_t chunkSize, ToJson toJson)
     {
-        return false;
+        size_t i = 0;
+        do
+        {
+            size_t n = min(chunkSize, items.size() - i);
+            writer.beginSection(name, static_cast<uint32_t>(n));
+            for (size_t end = i + n; i < end; ++i)
+                writer.element(toJson(items[i]));
+            writer.endSection();
+        } while (i < items.size());
     }
-}
 
-void Persistence::createBackup(const string &filepath)
-{
-    if (fs::exists(filepath))
+    // Records decoded by one loader task, merged into the result in task order
+    struct LoadedChunk
     {
-        string backupPath = filepath + ".backup";
-        try
+        vector<User> users;
+        vector<unique_ptr<Resource>> resources;
+        vector<Loan> loans;
+        vector<Reservation> reservations;
+        vector<Notification> notifications;
+        vector<LibraryEvent> events;
+    };
+
+    template <typename Item>
+    void appendMoved(vector<Item> &target, vector<Item> &source)
+    {
+        target.insert(target.end(), make_move_iterator(source.begin()), make_move_iterator(source.end()));
+        source.clear();
+    }
+
+    void mergeChunks(vector<LoadedChunk> &chunks,
+                     vector<User> &users,
+                     vector<unique_ptr<Resource>> &resources,
+                     vector<Loan> &loans,
+                     vector<Reservation> &reservations,
+                     vector<Notification> &notifications,
+                     vector<LibraryEvent> &events)
+    {
+        size_t totals[6] = {};
+        for (const auto &chunk : chunks)
         {
-            fs::copy_file(filepath, backupPath, fs::copy_options::overwrite_existing);
+            totals[0] += chunk.users.size();
+            totals[1] += chunk.resources.size();
+            totals[2] += chunk.loans.size();
+            totals[3] += chunk.reservations.size();
+            totals[4] += chunk.notifications.size();
+            totals[5] += chunk.events.size();
         }
-        catch (const fs::filesystem_error &)
+        users.reserve(users.size() + totals[0]);
+        resources.reserve(resources.size() + totals[1]);
+        loans.reserve(loans.size() + totals[2]);
+        reservations.reserve(reservations.size() + totals[3]);
+        notifications.reserve(notifications.size() + totals[4]);
+        events.reserve(events.size() + totals[5]);
+
+        for (auto &chunk : chunks)
         {
-            // Backup failed, but don't stop the save operation
+            appendMoved(users, chunk.users);
+            appendMoved(resources, chunk.resources);
+            appendMoved(loans, chunk.loans);
+            appendMoved(reservations, chunk.reservations);
+            appendMoved(notifications, chunk.notifications);
+            appendMoved(events, chunk.events);
         }
     }
 }
 
-bool Persistence::saveToFile(
-    const string &filepath,
+void Persistence::writeSnapshot(
+    ostream &out,
+    BinarySnapshot::Format format,
     const vector<User> &users,
     const vector<unique_ptr<Resource>> &resources,
     const vector<Loan> &loans,
@@ -85,280 +147,914 @@ bool Persistence::saveToFile(
     const vector<Notification> &notifications,
     const vector<LibraryEvent> &events)
 {
+    size_t sectionCount = 1 + chunkCount(users.size(), SECTION_CHUNK) + chunkCount(resources.size(), SECTION_CHUNK) +
+                          chunkCount(loans.size(), SECTION_CHUNK) + chunkCount(reservations.size(), SECTION_CHUNK) +
+                          chunkCount(notifications.size(), SECTION_CHUNK) + chunkCount(events.size(), SECTION_CHUNK);
+    BinarySnapshot::Writer writer(out, format, static_cast<uint32_t>(sectionCount));
+
+    // Config goes first so it is applied before loans are read
+    writer.section("config", configJson());
+
+    // Users
     try
     {
-        validateFilepath(filepath);
-        validateFileExtension(filepath);
+        writeChunks(writer, "users", users, SECTION_CHUNK, [](const User &u) { return u.toJson(); });
+    }
+    catch (const exception &e)
+    {
+        throw runtime_error("Failed to serialize users: " + string(e.what()));
+    }
 
-        // Create backup of existing file
-        createBackup(filepath);
+    // Resources
+    try
+    {
+        writeChunks(writer, "resources", resources, SECTION_CHUNK, [](const unique_ptr<Resource> &r)
+                    {
+                        if (r == nullptr)
+                        {
+                            throw runtime_error("Null resource pointer found");
+                        }
+                        return r->toJson(); });
+    }
+    catch (const exception &e)
+    {
+        throw runtime_error("Failed to serialize resources: " + string(e.what()));
+    }
 
-        // Ensure directory exists
-        fs::path filePath(filepath);
-        if (filePath.has_parent_path())
-        {
-            fs::create_directories(filePath.parent_path());
-        }
+    // Loans
+    try
+    {
+        writeChunks(writer, "loans", loans, SECTION_CHUNK, [](const Loan &l) { return l.toJson(); });
+    }
+    catch (const exception &e)
+    {
+        throw runtime_error("Failed to serialize loans: " + string(e.what()));
+    }
 
-        json j;
+    // Reservations
+    try
+    {
+        writeChunks(writer, "reservations", reservations, SECTION_CHUNK, [](const Reservation &r) { return r.toJson(); });
+    }
+    catch (const exception &e)
+    {
+        throw runtime_error("Failed to serialize reservations: " + string(e.what()));
+    }
 
-        // Config
-        j["config"] = {
-            {"maxRenewals", Loan::getMaxRenewals()},
-            {"loanPeriodDays", Loan::getLoanPeriod() / (24 * 60 * 60)}};
+    // Notifications
+    try
+    {
+        writeChunks(writer, "notifications", notifications, SECTION_CHUNK, [](const Notification &n) { return n.toJson(); });
+    }
+    catch (const exception &e)
+    {
+        throw runtime_error("Failed to serialize notifications: " + string(e.what()));
+    }
 
-        // Users
-        try
-        {
-            for (const auto &u : users)
-                j["users"].push_back(u.toJson());
-        }
-        catch (const exception &e)
+    // Events
+    try
+    {
+        writeChunks(writer, "events", events, SECTION_CHUNK, [](const LibraryEvent &e) { return e.toJson(); });
+    }
+    catch (const exception &ex)
+    {
+        throw runtime_error("Failed to serialize events: " + string(ex.what()));
+    }
+}
+
+// Config is applied first; every other section chunk is parsed on the thread
+// pool by its own SaxLoader and the results are merged in file order
+void Persistence::readSnapshot(
+    const string &filepath,
+    istream &in,
+    vector<User> &users,
+    vector<unique_ptr<Resource>> &resources,
+    vector<Loan> &loans,
+    vector<Reservation> &reservations,
+    vector<Notification> &notifications,
+    vector<LibraryEvent> &events,
+    json &config)
+{
+    BinarySnapshot::Format format;
+    vector<BinarySnapshot::Section> sections = BinarySnapshot::readIndex(in, format);
+    json::input_format_t inputFormat = BinarySnapshot::inputFormat(format);
+
+    vector<uint8_t> payload;
+    for (const auto &section : sections)
+    {
+        if (section.name != "config")
+            continue;
+        BinarySnapshot::readPayload(in, section, payload);
+        SaxLoader loader(users, resources, loans, reservations, notifications, events);
+        if (!loader.load(payload.data(), payload.size(), inputFormat))
         {
-            throw runtime_error("Failed to serialize users: " + string(e.what()));
+            throw runtime_error("Invalid snapshot section 'config' in " + filepath + ": " + loader.getError());
         }
+        config = loader.getConfig();
+    }
 
-        // Resources
-        try
-        {
-            for (const auto &r : resources)
+    vector<LoadedChunk> chunks(sections.size());
+    vector<future<void>> pending;
+    ThreadPool pool; // declared last so it is joined before chunks go away
+    for (size_t i = 0; i < sections.size(); ++i)
+    {
+        if (sections[i].name == "config")
+            continue;
+        pending.push_back(pool.submit([&filepath, &sections, &chunks, &config, inputFormat, i]()
+                                      {
+            const BinarySnapshot::Section &section = sections[i];
+            LoadedChunk &chunk = chunks[i];
+            ifstream input(filepath, ios::binary);
+            if (!input.is_open())
             {
-                if (r == nullptr)
-                {
-                    throw runtime_error("Null resource pointer found");
-                }
-                j["resources"].push_back(r->toJson());
+                throw runtime_error("Cannot open file for reading: " + filepath);
             }
-        }
-        catch (const exception &e)
-        {
-            throw runtime_error("Failed to serialize resources: " + string(e.what()));
-        }
 
-        // Loans
-        try
-        {
-            for (const auto &l : loans)
-                j["loans"].push_back(l.toJson());
-        }
-        catch (const exception &e)
-        {
-            throw runtime_error("Failed to serialize loans: " + string(e.what()));
-        }
+            vector<uint8_t> data;
+            BinarySnapshot::readPayload(input, section, data);
+            SaxLoader loader(chunk.users, chunk.resources, chunk.loans, chunk.reservations,
+                             chunk.notifications, chunk.events);
+            loader.setConfig(config);
+            loader.reserve(section.name, section.count);
+            if (!loader.load(data.data(), data.size(), inputFormat))
+            {
+                throw runtime_error("Invalid snapshot section '" + section.name + "' in " + filepath + ": " + loader.getError());
+            } }));
+    }
 
-        // Reservations
-        try
-        {
-            for (const auto &r : reservations)
-                j["reservations"].push_back(r.toJson());
-        }
-        catch (const exception &e)
-        {
-            throw runtime_error("Failed to serialize reservations: " + string(e.what()));
-        }
+    // get() rethrows the first failure in file order
+    for (auto &task : pending)
+        task.get();
+    mergeChunks(chunks, users, resources, loans, reservations, notifications, events);
+}
 
-        // Notifications
-        try
-        {
-            for (const auto &n : notifications)
-                j["notifications"].push_back(n.toJson());
-        }
-        catch (const exception &e)
-        {
-            throw runtime_error("Failed to serialize notifications: " + string(e.what()));
-        }
+string Persistence::deltaPath(const string &filepath)
+{
+    return filepath + ".delta";
+}
 
-        // Events
-        try
-        {
-            for (const auto &e : events)
-                j["events"].push_back(e.toJson());
-        }
-        catch (const exception &ex)
+// Replays {"s": section, "v": record} upserts and {"s": section, "d": id}
+// removals over the freshly loaded base snapshot. The latest config record
+// wins and sets the renewal limit for the loans after it.
+size_t Persistence::applyDelta(
+    const string &filepath,
+    vector<User> &users,
+    vector<unique_ptr<Resource>> &resources,
+    vector<Loan> &loans,
+    vector<Reservation> &reservations,
+    vector<Notification> &notifications,
+    vector<LibraryEvent> &events,
+    json &config)
+{
+    SectionEditor editor(users, resources, loans, reservations, notifications, events);
+    return WriteAheadLog::replay(deltaPath(filepath), [&](const json &record)
+                                 {
+        const string section = record.value("s", "");
+        if (record.contains("d"))
         {
-            throw runtime_error("Failed to serialize events: " + string(ex.what()));
+            editor.erase(section, record["d"].get<string>());
+            return;
         }
 
-        ofstream ofs(filepath);
-        if (!ofs.is_open())
+        const json &value = record.at("v");
+        if (section == "config")
         {
-            throw runtime_error("Cannot open file for writing: " + filepath);
+            SaxLoader::checkConfig(value);
+            config = value;
         }
+        else if (section == "users")
+            editor.upsert(User::fromJson(value));
+        else if (section == "resources")
+            editor.upsert(Resource::fromJson(value));
+        else if (section == "loans")
+            editor.upsert(Loan::fromJson(value, SaxLoader::renewalLimit(config)));
+        else if (section == "reservations")
+            editor.upsert(Reservation::fromJson(value));
+        else if (section == "notifications")
+            editor.upsert(Notification::fromJson(value));
+        else if (section == "events")
+            editor.upsert(LibraryEvent::fromJson(value)); });
+}
 
-        ofs << j.dump(2);
-        if (ofs.fail())
-        {
-            throw runtime_error("Failed to write to file: " + filepath);
-        }
+void Persistence::finishLoad(
+    const string &filepath,
+    vector<User> &users,
+    vector<unique_ptr<Resource>> &resources,
+    vector<Loan> &loans,
+    vector<Reservation> &reservations,
+    vector<Notification> &notifications,
+    vector<LibraryEvent> &events,
+    LoanIndex *activeLoans,
+    json &config)
+{
+    if (applyDelta(filepath, users, resources, loans, reservations, notifications, events, config) > 0 && activeLoans)
+        activeLoans->build(loans);
+}
 
-        return true;
+// Appends the given entities and removals to the delta file
+void Persistence::appendDelta(
+    const string &filepath,
+    const vector<User> &users,
+    const vector<unique_ptr<Resource>> &resources,
+    const vector<Loan> &loans,
+    const vector<Reservation> &reservations,
+    const vector<Notification> &notifications,
+    const vector<LibraryEvent> &events,
+    const vector<pair<string, string>> &removed)
+{
+    WriteAheadLog delta;
+    if (!delta.open(deltaPath(filepath)))
+    {
+        throw runtime_error("Cannot open delta file: " + deltaPath(filepath));
     }
-    catch (const exception &e)
+
+    // Removals go first so a record removed and re-added ends up present
+    for (const auto &entry : removed)
+        delta.append({{"s", entry.first}, {"d", entry.second}});
+
+    delta.append({{"s", "config"}, {"v", configJson()}});
+    for (const auto &u : users)
+        delta.append({{"s", "users"}, {"v", u.toJson()}});
+    for (const auto &r : resources)
+        delta.append({{"s", "resources"}, {"v", r->toJson()}});
+    for (const auto &l : loans)
+        delta.append({{"s", "loans"}, {"v", l.toJson()}});
+    for (const auto &r : reservations)
+        delta.append({{"s", "reservations"}, {"v", r.toJson()}});
+    for (const auto &n : notifications)
+        delta.append({{"s", "notifications"}, {"v", n.toJson()}});
+    for (const auto &e : events)
+        delta.append({{"s", "events"}, {"v", e.toJson()}});
+
+    if (!delta.commit())
     {
-        cerr << "Save error: " << e.what() << endl;
-        return false;
+        throw runtime_error("Failed to write delta file: " + deltaPath(filepath));
     }
 }
 
-bool Persistence::loadFromFile(
+// Writes a full base snapshot and drops the delta it covers
+void Persistence::replaceBase(
     const string &filepath,
+    const vector<User> &users,
+    const vector<unique_ptr<Resource>> &resources,
+    const vector<Loan> &loans,
+    const vector<Reservation> &reservations,
+    const vector<Notification> &notifications,
+    const vector<LibraryEvent> &events,
+    uintmax_t deltaSize)
+{
+    if (!saveToFile(filepath, users, resources, loans, reservations, notifications, events))
+    {
+        throw runtime_error("Failed to write " + filepath);
+    }
+
+    // The new base covers the delta. A crash before the delta is gone
+    // leaves it to be replayed over the newer base, rolling records
+    // back; the service's log archive, replayed after it and only
+    // removed once this save returns, brings them forward again.
+    if (deltaSize > 0)
+    {
+        error_code ec;
+        fs::remove(deltaPath(filepath), ec);
+        AtomicFile::syncDirectory(fs::path(filepath).parent_path().string());
+    }
+}
+
+// Applies removals, then upserts copies of the changed entities by ID
+void Persistence::mergeChanges(
     vector<User> &users,
     vector<unique_ptr<Resource>> &resources,
     vector<Loan> &loans,
     vector<Reservation> &reservations,
     vector<Notification> &notifications,
-    vector<LibraryEvent> &events)
+    vector<LibraryEvent> &events,
+    const vector<User> &changedUsers,
+    const vector<unique_ptr<Resource>> &changedResources,
+    const vector<Loan> &changedLoans,
+    const vector<Reservation> &changedReservations,
+    const vector<Notification> &changedNotifications,
+    const vector<LibraryEvent> &changedEvents,
+    const vector<pair<string, string>> &removed)
+{
+    SectionEditor editor(users, resources, loans, reservations, notifications, events);
+    for (const auto &entry : removed)
+        editor.erase(entry.first, entry.second);
+
+    for (const auto &u : changedUsers)
+        editor.upsert(u);
+    for (const auto &r : changedResources)
+        editor.upsert(r->clone());
+    for (const auto &l : changedLoans)
+        editor.upsert(l);
+    for (const auto &r : changedReservations)
+        editor.upsert(r);
+    for (const auto &n : changedNotifications)
+        editor.upsert(n);
+    for (const auto &e : changedEvents)
+        editor.upsert(e);
+}
+
+bool Persistence::saveChanges(
+    const string &filepath,
+    const vector<User> &users,
+    const vector<unique_ptr<Resource>> &resources,
+    const vector<Loan> &loans,
+    const vector<Reservation> &reservations,
+    const vector<Notification> &notifications,
+    const vector<LibraryEvent> &events,
+    const vector<pair<string, string>> &removed,
+    bool complete)
 {
     try
     {
         validateFilepath(filepath);
         validateFileExtension(filepath);
 
-        if (!fs::exists(filepath))
+        error_code ec;
+        if (isStorePath(filepath) && !complete && fs::exists(filepath, ec))
         {
-            throw runtime_error("File does not exist: " + filepath);
+            saveStoreChanges(filepath, users, resources, loans, reservations, notifications, events, removed);
+            return true;
         }
 
-        if (!isValidJsonFile(filepath))
+        uintmax_t baseSize = fs::exists(filepath, ec) && !isStorePath(filepath) ? fs::file_size(filepath, ec) : 0;
+        uintmax_t deltaSize = fs::exists(deltaPath(filepath), ec) ? fs::file_size(deltaPath(filepath), ec) : 0;
+        if (!complete && baseSize > 0 && deltaSize * 2 <= baseSize)
         {
-            throw runtime_error("Invalid JSON file: " + filepath);
+            appendDelta(filepath, users, resources, loans, reservations, notifications, events, removed);
+            return true;
         }
 
-        ifstream ifs(filepath);
-        if (!ifs.is_open())
+        // A new base: the saved data read back with the changes applied.
+        // A base that cannot be read throws here and is left as it is.
+        vector<User> allUsers;
+        vector<unique_ptr<Resource>> allResources;
+        vector<Loan> allLoans;
+        vector<Reservation> allReservations;
+        vector<Notification> allNotifications;
+        vector<LibraryEvent> allEvents;
+        if (!complete && baseSize > 0)
         {
-            throw runtime_error("Cannot open file for reading: " + filepath);
+            json config;
+            readData(filepath, allUsers, allResources, allLoans, allReservations, allNotifications, allEvents, nullptr, config);
         }
+        mergeChanges(allUsers, allResources, allLoans, allReservations, allNotifications, allEvents,
+                     users, resources, loans, reservations, notifications, events, removed);
+        replaceBase(filepath, allUsers, allResources, allLoans, allReservations, allNotifications, allEvents, deltaSize);
+        return true;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Save error: " << e.what() << endl;
+        return false;
+    }
+}
 
-        json j;
-        try
-        {
-            ifs >> j;
-        }
-        catch (const json::exception &e)
-        {
-            throw runtime_error("JSON parsing error: " + string(e.what()));
-        }
+bool Persistence::isStorePath(const string &filepath)
+{
+    size_t dotPos = filepath.find_last_of('.');
+    if (dotPos == string::npos)
+        return false;
+    string extension = filepath.substr(dotPos);
+    return extension == ".lsm" || extension == ".LSM";
+}
+
+namespace
+{
+    // Stores kept open by saves and loads, by absolute directory
+    mutex storesMutex;
+    map<string, shared_ptr<LsmStore>> openStores;
+
+    string storeKey(const string &directory)
+    {
+        return fs::absolute(directory).lexically_normal().string();
+    }
+}
+
+shared_ptr<LsmStore> Persistence::openStore(const string &directory)
+{
+    lock_guard<mutex> lock(storesMutex);
+    string key = storeKey(directory);
+    auto found = openStores.find(key);
+    if (found != openStores.end())
+        return found->second;
+
+    auto store = make_shared<LsmStore>();
+    if (!store->open(directory))
+    {
+        throw runtime_error("Cannot open store: " + directory);
+    }
+    openStores[key] = store;
+    return store;
+}
+
+void Persistence::closeStore(const string &filepath)
+{
+    if (!isStorePath(filepath))
+        return;
+
+    shared_ptr<LsmStore> store;
+    {
+        lock_guard<mutex> lock(storesMutex);
+        auto found = openStores.find(storeKey(filepath));
+        if (found == openStores.end())
+            return;
+        store = found->second;
+        openStores.erase(found);
+    }
+    store->close();
+}
+
+// Brings one key range of the store in line with records (key, value).
+// Walks the stored range and the sorted records together, so only
+// changed, new and removed entities are written. Throws if a write fails.
+void Persistence::syncSection(LsmStore &store, const string &prefix, vector<pair<string, string>> &records)
+{
+    sort(records.begin(), records.end());
+
+    auto put = [&store](const pair<string, string> &record)
+    {
+        if (!store.put(record.first, record.second))
+            throw runtime_error("Failed to write " + record.first + " to store");
+    };
+
+    vector<string> stale;
+    size_t next = 0;
+    bool read = store.scan(prefix, [&](const string &key, const string &value)
+               {
+                   while (next < records.size() && records[next].first < key)
+                       put(records[next++]);
+                   if (next < records.size() && records[next].first == key)
+                   {
+                       if (records[next].second != value)
+                           put(records[next]);
+                       ++next;
+                   }
+                   else
+                   {
+                       stale.push_back(key);
+                   } });
+    if (!read)
+    {
+        throw runtime_error("Cannot read " + prefix + " from store");
+    }
+    for (; next < records.size(); next++)
+        put(records[next]);
+    for (const auto &key : stale)
+    {
+        if (!store.remove(key))
+            throw runtime_error("Failed to remove " + key + " from store");
+    }
+}
+
+void Persistence::saveToStore(
+    const string &directory,
+    const vector<User> &users,
+    const vector<unique_ptr<Resource>> &resources,
+    const vector<Loan> &loans,
+    const vector<Reservation> &reservations,
+    const vector<Notification> &notifications,
+    const vector<LibraryEvent> &events)
+{
+    auto store = openStore(directory);
 
-        // Clear existing data
-        users.clear();
-        resources.clear();
-        loans.clear();
-        reservations.clear();
-        notifications.clear();
-        events.clear();
+    if (!store->put("config", configJson().dump()))
+    {
+        throw runtime_error("Failed to write config to store: " + directory);
+    }
+
+    // Keys are "<section>/<id>" so each section is one contiguous range
+    vector<pair<string, string>> records;
+
+    for (const auto &u : users)
+        records.emplace_back("users/" + u.getUserId(), u.toJson().dump());
+    syncSection(*store, "users/", records);
 
-        // Config
-        if (j.contains("config"))
+    records.clear();
+    for (const auto &r : resources)
+    {
+        if (r == nullptr)
         {
-            auto cfg = j["config"];
-            if (cfg.contains("maxRenewals"))
-            {
-                int maxRenewals = cfg["maxRenewals"].get<int>();
-                if (maxRenewals < 0 || maxRenewals > 10)
-                {
-                    throw invalid_argument("Invalid maxRenewals value");
-                }
-                Loan::setMaxRenewals(maxRenewals);
-            }
-            if (cfg.contains("loanPeriodDays"))
-            {
-                int loanPeriod = cfg["loanPeriodDays"].get<int>();
-                if (loanPeriod < 1 || loanPeriod > 365)
-                {
-                    throw invalid_argument("Invalid loanPeriodDays value");
-                }
-                Loan::setLoanPeriod(loanPeriod);
-            }
+            throw runtime_error("Null resource pointer found");
         }
+        records.emplace_back("resources/" + r->getResourceId(), r->toJson().dump());
+    }
+    syncSection(*store, "resources/", records);
+
+    records.clear();
+    for (const auto &l : loans)
+        records.emplace_back("loans/" + l.getLoanId(), l.toJson().dump());
+    syncSection(*store, "loans/", records);
+
+    records.clear();
+    for (const auto &r : reservations)
+        records.emplace_back("reservations/" + r.getReservationId(), r.toJson().dump());
+    syncSection(*store, "reservations/", records);
+
+    records.clear();
+    for (const auto &n : notifications)
+        records.emplace_back("notifications/" + n.getNotificationId(), n.toJson().dump());
+    syncSection(*store, "notifications/", records);
 
-        // Users
-        if (j.contains("users"))
+    records.clear();
+    for (const auto &e : events)
+        records.emplace_back("events/" + e.getEventId(), e.toJson().dump());
+    syncSection(*store, "events/", records);
+
+    if (!store->sync())
+    {
+        throw runtime_error("Failed to sync store: " + directory);
+    }
+}
+
+// Writes only the given entities and removed keys, for a store that already
+// holds the previous save. Removals go first, as in the delta file.
+void Persistence::saveStoreChanges(
+    const string &directory,
+    const vector<User> &users,
+    const vector<unique_ptr<Resource>> &resources,
+    const vector<Loan> &loans,
+    const vector<Reservation> &reservations,
+    const vector<Notification> &notifications,
+    const vector<LibraryEvent> &events,
+    const vector<pair<string, string>> &removed)
+{
+    auto store = openStore(directory);
+
+    auto put = [&](const string &key, const json &value)
+    {
+        if (!store->put(key, value.dump()))
+            throw runtime_error("Failed to write " + key + " to store: " + directory);
+    };
+
+    for (const auto &entry : removed)
+    {
+        string key = entry.first + "/" + entry.second;
+        if (!store->remove(key))
+            throw runtime_error("Failed to remove " + key + " from store: " + directory);
+    }
+
+    put("config", configJson());
+    for (const auto &u : users)
+        put("users/" + u.getUserId(), u.toJson());
+    for (const auto &r : resources)
+        put("resources/" + r->getResourceId(), r->toJson());
+    for (const auto &l : loans)
+        put("loans/" + l.getLoanId(), l.toJson());
+    for (const auto &r : reservations)
+        put("reservations/" + r.getReservationId(), r.toJson());
+    for (const auto &n : notifications)
+        put("notifications/" + n.getNotificationId(), n.toJson());
+    for (const auto &e : events)
+        put("events/" + e.getEventId(), e.toJson());
+
+    if (!store->sync())
+    {
+        throw runtime_error("Failed to sync store: " + directory);
+    }
+}
+
+void Persistence::loadFromStore(
+    const string &directory,
+    vector<User> &users,
+    vector<unique_ptr<Resource>> &resources,
+    vector<Loan> &loans,
+    vector<Reservation> &reservations,
+    vector<Notification> &notifications,
+    vector<LibraryEvent> &events,
+    LoanIndex *activeLoans,
+    json &config)
+{
+    auto store = openStore(directory);
+
+    string value;
+    bool found;
+    if (!store->get("config", value, found))
+    {
+        throw runtime_error("Cannot read config from store: " + directory);
+    }
+    json loadedConfig;
+    if (found)
+    {
+        loadedConfig = json::parse(value);
+        SaxLoader::checkConfig(loadedConfig);
+    }
+    int maxRenewals = SaxLoader::renewalLimit(loadedConfig);
+
+    // Sections go into fresh containers, so a table that cannot be read
+    // leaves the current data untouched
+    auto readSection = [&](const string &prefix, const function<void(const string &)> &add)
+    {
+        if (!store->scan(prefix, [&](const string &, const string &v)
+                        { add(v); }))
+            throw runtime_error("Cannot read " + prefix + " from store: " + directory);
+    };
+
+    vector<User> loadedUsers;
+    vector<unique_ptr<Resource>> loadedResources;
+    vector<Loan> loadedLoans;
+    vector<Reservation> loadedReservations;
+    vector<Notification> loadedNotifications;
+    vector<LibraryEvent> loadedEvents;
+    readSection("users/", [&](const string &v)
+                { loadedUsers.push_back(User::fromJson(json::parse(v))); });
+    readSection("resources/", [&](const string &v)
+                { loadedResources.push_back(Resource::fromJson(json::parse(v))); });
+    readSection("loans/", [&](const string &v)
+                { loadedLoans.push_back(Loan::fromJson(json::parse(v), maxRenewals)); });
+    readSection("reservations/", [&](const string &v)
+                { loadedReservations.push_back(Reservation::fromJson(json::parse(v))); });
+    readSection("notifications/", [&](const string &v)
+                { loadedNotifications.push_back(Notification::fromJson(json::parse(v))); });
+    readSection("events/", [&](const string &v)
+                { loadedEvents.push_back(LibraryEvent::fromJson(json::parse(v))); });
+
+    config = std::move(loadedConfig);
+    users.swap(loadedUsers);
+    resources.swap(loadedResources);
+    loans.swap(loadedLoans);
+    reservations.swap(loadedReservations);
+    notifications.swap(loadedNotifications);
+    events.swap(loadedEvents);
+    if (activeLoans)
+        activeLoans->build(loans);
+}
+
+void Persistence::writeJson(
+    ostream &out,
+    bool pretty,
+    const vector<User> &users,
+    const vector<unique_ptr<Resource>> &resources,
+    const vector<Loan> &loans,
+    const vector<Reservation> &reservations,
+    const vector<Notification> &notifications,
+    const vector<LibraryEvent> &events)
+{
+    // Sections are written in the same (sorted) key order json::dump uses;
+    // config comes first so the loader has its renewal limit before reading loans
+    JsonWriter writer(out, pretty);
+    writer.beginObject();
+
+    // Config
+    writer.field("config", configJson());
+
+    // Events
+    try
+    {
+        writer.beginArray("events");
+        for (const auto &e : events)
+            writer.element(e.toJson());
+        writer.endArray();
+    }
+    catch (const exception &ex)
+    {
+        throw runtime_error("Failed to serialize events: " + string(ex.what()));
+    }
+
+    // Loans
+    try
+    {
+        writer.beginArray("loans");
+        for (const auto &l : loans)
+            writer.element(l.toJson());
+        writer.endArray();
+    }
+    catch (const exception &e)
+    {
+        throw runtime_error("Failed to serialize loans: " + string(e.what()));
+    }
+
+    // Notifications
+    try
+    {
+        writer.beginArray("notifications");
+        for (const auto &n : notifications)
+            writer.element(n.toJson());
+        writer.endArray();
+    }
+    catch (const exception &e)
+    {
+        throw runtime_error("Failed to serialize notifications: " + string(e.what()));
+    }
+
+    // Reservations
+    try
+    {
+        writer.beginArray("reservations");
+        for (const auto &r : reservations)
+            writer.element(r.toJson());
+        writer.endArray();
+    }
+    catch (const exception &e)
+    {
+        throw runtime_error("Failed to serialize reservations: " + string(e.what()));
+    }
+
+    // Resources
+    try
+    {
+        writer.beginArray("resources");
+        for (const auto &r : resources)
         {
-            try
+            if (r == nullptr)
             {
-                for (const auto &uj : j["users"])
-                    users.push_back(User::fromJson(uj));
-            }
-            catch (const exception &e)
-            {
-                throw runtime_error("Failed to load users: " + string(e.what()));
+                throw runtime_error("Null resource pointer found");
             }
+            writer.element(r->toJson());
         }
+        writer.endArray();
+    }
+    catch (const exception &e)
+    {
+        throw runtime_error("Failed to serialize resources: " + string(e.what()));
+    }
+
+    // Users
+    try
+    {
+        writer.beginArray("users");
+        for (const auto &u : users)
+            writer.element(u.toJson());
+        writer.endArray();
+    }
+    catch (const exception &e)
+    {
+        throw runtime_error("Failed to serialize users: " + string(e.what()));
+    }
+
+    writer.endObject();
+}
+
+bool Persistence::saveToFile(
+    const string &filepath,
+    const vector<User> &users,
+    const vector<unique_ptr<Resource>> &resources,
+    const vector<Loan> &loans,
+    const vector<Reservation> &reservations,
+    const vector<Notification> &notifications,
+    const vector<LibraryEvent> &events,
+    bool pretty)
+{
+    try
+    {
+        validateFilepath(filepath);
+        validateFileExtension(filepath);
 
-        // Resources
-        if (j.contains("resources"))
+        if (isStorePath(filepath))
         {
-            try
-            {
-                for (const auto &rj : j["resources"])
-                    resources.push_back(Resource::fromJson(rj));
-            }
-            catch (const exception &e)
-            {
-                throw runtime_error("Failed to load resources: " + string(e.what()));
-            }
+            saveToStore(filepath, users, resources, loans, reservations, notifications, events);
+            return true;
         }
 
-        // Loans
-        if (j.contains("loans"))
+        // Ensure directory exists
+        fs::path filePath(filepath);
+        if (filePath.has_parent_path())
         {
-            try
-            {
-                for (const auto &lj : j["loans"])
-                    loans.push_back(Loan::fromJson(lj));
-            }
-            catch (const exception &e)
-            {
-                throw runtime_error("Failed to load loans: " + string(e.what()));
-            }
+            fs::create_directories(filePath.parent_path());
         }
 
-        // Reservations
-        if (j.contains("reservations"))
+        // The new snapshot is written next to the live file and renamed over it
+        // once it is durable, so a crash never leaves a half-written file behind
+        string tempPath = AtomicFile::tempPath(filepath);
+        try
         {
-            try
-            {
-                for (const auto &rj : j["reservations"])
-                    reservations.push_back(Reservation::fromJson(rj));
-            }
-            catch (const exception &e)
+            // Stream each section straight to a buffered file instead of building a DOM
+            vector<char> buffer(1 << 20);
+            ofstream ofs;
+            ofs.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+            ofs.open(tempPath, ios::binary | ios::trunc);
+            if (!ofs.is_open())
             {
-                throw runtime_error("Failed to load reservations: " + string(e.what()));
+                throw runtime_error("Cannot open file for writing: " + tempPath);
             }
-        }
 
-        // Notifications
-        if (j.contains("notifications"))
-        {
-            try
+            BinarySnapshot::Format format;
+            if (BinarySnapshot::formatForPath(filepath, format))
+                writeSnapshot(ofs, format, users, resources, loans, reservations, notifications, events);
+            else
+                writeJson(ofs, pretty, users, resources, loans, reservations, notifications, events);
+
+            ofs.close();
+            if (ofs.fail())
             {
-                for (const auto &nj : j["notifications"])
-                    notifications.push_back(Notification::fromJson(nj));
+                throw runtime_error("Failed to write to file: " + tempPath);
             }
-            catch (const exception &e)
+
+            if (!AtomicFile::commit(tempPath, filepath, BACKUP_GENERATIONS))
             {
-                throw runtime_error("Failed to load notifications: " + string(e.what()));
+                throw runtime_error("Failed to replace " + filepath);
             }
         }
-
-        // Events
-        if (j.contains("events"))
+        catch (const exception &)
         {
-            try
-            {
-                for (const auto &ej : j["events"])
-                    events.push_back(LibraryEvent::fromJson(ej));
-            }
-            catch (const exception &e)
-            {
-                throw runtime_error("Failed to load events: " + string(e.what()));
-            }
+            error_code ec;
+            fs::remove(tempPath, ec);
+            throw;
         }
 
         return true;
     }
     catch (const exception &e)
+    {
+        cerr << "Save error: " << e.what() << endl;
+        return false;
+    }
+}
+
+void Persistence::readData(
+    const string &filepath,
+    vector<User> &users,
+    vector<unique_ptr<Resource>> &resources,
+    vector<Loan> &loans,
+    vector<Reservation> &reservations,
+    vector<Notification> &notifications,
+    vector<LibraryEvent> &events,
+    LoanIndex *activeLoans,
+    json &config)
+{
+    if (!fs::exists(filepath))
+    {
+        throw runtime_error("File does not exist: " + filepath);
+    }
+
+    if (isStorePath(filepath))
+    {
+        loadFromStore(filepath, users, resources, loans, reservations, notifications, events, activeLoans, config);
+        return;
+    }
+
+    ifstream ifs(filepath, ios::binary);
+    if (!ifs.is_open())
+    {
+        throw runtime_error("Cannot open file for reading: " + filepath);
+    }
+
+    // Entities are built while the file streams in. They go into fresh
+    // containers so a malformed file leaves the current data untouched.
+    vector<User> loadedUsers;
+    vector<unique_ptr<Resource>> loadedResources;
+    vector<Loan> loadedLoans;
+    vector<Reservation> loadedReservations;
+    vector<Notification> loadedNotifications;
+    vector<LibraryEvent> loadedEvents;
+    LoanIndex loadedActiveLoans;
+
+    SaxLoader loader(loadedUsers, loadedResources, loadedLoans, loadedReservations,
+                     loadedNotifications, loadedEvents, activeLoans ? &loadedActiveLoans : nullptr);
+    json loadedConfig;
+    BinarySnapshot::Format format;
+    if (BinarySnapshot::formatForPath(filepath, format))
+    {
+        readSnapshot(filepath, ifs, loadedUsers, loadedResources, loadedLoans, loadedReservations,
+                     loadedNotifications, loadedEvents, loadedConfig);
+        if (activeLoans)
+            loadedActiveLoans.build(loadedLoans);
+    }
+    else if (!loader.load(ifs))
+    {
+        throw runtime_error("Invalid JSON file " + filepath + ": " + loader.getError());
+    }
+    else
+    {
+        loadedConfig = loader.getConfig();
+    }
+
+    users.swap(loadedUsers);
+    resources.swap(loadedResources);
+    loans.swap(loadedLoans);
+    reservations.swap(loadedReservations);
+    notifications.swap(loadedNotifications);
+    events.swap(loadedEvents);
+    if (activeLoans)
+        *activeLoans = std::move(loadedActiveLoans);
+    config = std::move(loadedConfig);
+
+    finishLoad(filepath, users, resources, loans, reservations, notifications, events, activeLoans, config);
+}
+
+bool Persistence::loadFromFile(
+    const string &filepath,
+    vector<User> &users,
+    vector<unique_ptr<Resource>> &resources,
+    vector<Loan> &loans,
+    vector<Reservation> &reservations,
+    vector<Notification> &notifications,
+    vector<LibraryEvent> &events,
+    LoanIndex *activeLoans)
+{
+    try
+    {
+        validateFilepath(filepath);
+        validateFileExtension(filepath);
+
+        json config;
+        readData(filepath, users, resources, loans, reservations, notifications, events, activeLoans, config);
+
+        // Only data that loaded completely changes the settings
+        SaxLoader::applyConfig(config);
+        return true;
+    }
+    catch (const exception &e)
     {
         cerr << "Load error: " << e.what() << endl;
         return false;
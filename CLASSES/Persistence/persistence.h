@@ -11,19 +11,170 @@
 #include "Reservation/reservation.h"
 #include "Notification/notification.h"
 #include "LibraryEvent/libraryevent.h"
+#include "Registry/loanindex.h"
+#include "Storage/lsmstore.h"
+#include "binarysnapshot.h"
+#include "wal.h"
 using namespace std;
 
+class SaxLoader;
+
 class Persistence
 {
 private:
     // Validation helpers
     static void validateFilepath(const string &filepath);
     static void validateFileExtension(const string &filepath);
-    static bool isValidJsonFile(const string &filepath);
-    static void createBackup(const string &filepath);
+
+    // Loan settings and ID counters, saved with every snapshot and delta
+    static json configJson();
+
+    // Records per independently parsed chunk when loading binary snapshots
+    static const size_t SECTION_CHUNK = 8192;
+
+    // Previous snapshots kept as <file>.backup, <file>.backup.2, ...
+    static const size_t BACKUP_GENERATIONS = 3;
+
+    // Json backend, the default for file paths
+    static void writeJson(
+        ostream &out,
+        bool pretty,
+        const vector<User> &users,
+        const vector<unique_ptr<Resource>> &resources,
+        const vector<Loan> &loans,
+        const vector<Reservation> &reservations,
+        const vector<Notification> &notifications,
+        const vector<LibraryEvent> &events);
+
+    // Binary snapshot backend, used for paths ending in .cbor or .msgpack
+    static void writeSnapshot(
+        ostream &out,
+        BinarySnapshot::Format format,
+        const vector<User> &users,
+        const vector<unique_ptr<Resource>> &resources,
+        const vector<Loan> &loans,
+        const vector<Reservation> &reservations,
+        const vector<Notification> &notifications,
+        const vector<LibraryEvent> &events);
+    // The config section is returned in config, not applied
+    static void readSnapshot(
+        const string &filepath,
+        istream &in,
+        vector<User> &users,
+        vector<unique_ptr<Resource>> &resources,
+        vector<Loan> &loans,
+        vector<Reservation> &reservations,
+        vector<Notification> &notifications,
+        vector<LibraryEvent> &events,
+        json &config);
+
+    // Delta log of changed records, kept next to file-based snapshots.
+    // Config records are returned in config, not applied
+    static string deltaPath(const string &filepath);
+    static size_t applyDelta(
+        const string &filepath,
+        vector<User> &users,
+        vector<unique_ptr<Resource>> &resources,
+        vector<Loan> &loans,
+        vector<Reservation> &reservations,
+        vector<Notification> &notifications,
+        vector<LibraryEvent> &events,
+        json &config);
+    static void finishLoad(
+        const string &filepath,
+        vector<User> &users,
+        vector<unique_ptr<Resource>> &resources,
+        vector<Loan> &loans,
+        vector<Reservation> &reservations,
+        vector<Notification> &notifications,
+        vector<LibraryEvent> &events,
+        LoanIndex *activeLoans,
+        json &config);
+    static void appendDelta(
+        const string &filepath,
+        const vector<User> &users,
+        const vector<unique_ptr<Resource>> &resources,
+        const vector<Loan> &loans,
+        const vector<Reservation> &reservations,
+        const vector<Notification> &notifications,
+        const vector<LibraryEvent> &events,
+        const vector<pair<string, string>> &removed);
+    static void replaceBase(
+        const string &filepath,
+        const vector<User> &users,
+        const vector<unique_ptr<Resource>> &resources,
+        const vector<Loan> &loans,
+        const vector<Reservation> &reservations,
+        const vector<Notification> &notifications,
+        const vector<LibraryEvent> &events,
+        uintmax_t deltaSize);
+    static void mergeChanges(
+        vector<User> &users,
+        vector<unique_ptr<Resource>> &resources,
+        vector<Loan> &loans,
+        vector<Reservation> &reservations,
+        vector<Notification> &notifications,
+        vector<LibraryEvent> &events,
+        const vector<User> &changedUsers,
+        const vector<unique_ptr<Resource>> &changedResources,
+        const vector<Loan> &changedLoans,
+        const vector<Reservation> &changedReservations,
+        const vector<Notification> &changedNotifications,
+        const vector<LibraryEvent> &changedEvents,
+        const vector<pair<string, string>> &removed);
+
+    // LSM store backend, used for paths ending in .lsm
+    static bool isStorePath(const string &filepath);
+    // The store in directory, opened on first use and kept open until
+    // closeStore(), so saves write into a live memtable and the store's own
+    // thread merges its tables. Throws if it cannot be opened
+    static shared_ptr<LsmStore> openStore(const string &directory);
+    static void syncSection(LsmStore &store, const string &prefix, vector<pair<string, string>> &records);
+    static void saveToStore(
+        const string &directory,
+        const vector<User> &users,
+        const vector<unique_ptr<Resource>> &resources,
+        const vector<Loan> &loans,
+        const vector<Reservation> &reservations,
+        const vector<Notification> &notifications,
+        const vector<LibraryEvent> &events);
+    static void saveStoreChanges(
+        const string &directory,
+        const vector<User> &users,
+        const vector<unique_ptr<Resource>> &resources,
+        const vector<Loan> &loans,
+        const vector<Reservation> &reservations,
+        const vector<Notification> &notifications,
+        const vector<LibraryEvent> &events,
+        const vector<pair<string, string>> &removed);
+    // Returns the store's config section in config, not applied
+    static void loadFromStore(
+        const string &directory,
+        vector<User> &users,
+        vector<unique_ptr<Resource>> &resources,
+        vector<Loan> &loans,
+        vector<Reservation> &reservations,
+        vector<Notification> &notifications,
+        vector<LibraryEvent> &events,
+        LoanIndex *activeLoans,
+        json &config);
+
+    // Reads a snapshot in any format, plus its delta, into the given
+    // containers. Throws on failure; the config is returned, not applied
+    static void readData(
+        const string &filepath,
+        vector<User> &users,
+        vector<unique_ptr<Resource>> &resources,
+        vector<Loan> &loans,
+        vector<Reservation> &reservations,
+        vector<Notification> &notifications,
+        vector<LibraryEvent> &events,
+        LoanIndex *activeLoans,
+        json &config);
 
 public:
-    // Save all data to a Json file
+    // Save all data to a Json file, a binary snapshot (.cbor/.msgpack) or an LSM store directory (.lsm).
+    // Json is written compact unless pretty is set (debugging only)
     static bool saveToFile(
         const string &filepath,
         const vector<User> &users,
@@ -31,9 +182,34 @@ public:
         const vector<Loan> &loans,
         const vector<Reservation> &reservations,
         const vector<Notification> &notifications,
-        const vector<LibraryEvent> &events);
+        const vector<LibraryEvent> &events,
+        bool pretty = false);
+
+    // Save the given changed entities and removed (section, id) pairs on top
+    // of what the file already holds, without needing the rest of the data:
+    // they are appended to the delta or put into the store, and when the
+    // delta outgrows half the base, the base is read back from disk, the
+    // changes applied and a new base written. With complete set the
+    // changes are the whole data set and replace the file outright. Safe to
+    // call from a background thread; it reads only the given entities and
+    // the loan/ID settings.
+    static bool saveChanges(
+        const string &filepath,
+        const vector<User> &users,
+        const vector<unique_ptr<Resource>> &resources,
+        const vector<Loan> &loans,
+        const vector<Reservation> &reservations,
+        const vector<Notification> &notifications,
+        const vector<LibraryEvent> &events,
+        const vector<pair<string, string>> &removed,
+        bool complete = false);
+
+    // Flushes and closes the LSM store that saves and loads of filepath kept
+    // open; does nothing for other paths. Loads still read the whole store
+    // into memory, so the store is the durable copy, not the working set
+    static void closeStore(const string &filepath);
 
-    // Load all data from a Json file
+    // Load all data from a Json file, a binary snapshot or an LSM store directory, optionally indexing active loans as they are read
     static bool loadFromFile(
         const string &filepath,
         vector<User> &users,
@@ -41,7 +217,8 @@ public:
         vector<Loan> &loans,
         vector<Reservation> &reservations,
         vector<Notification> &notifications,
-        vector<LibraryEvent> &events);
+        vector<LibraryEvent> &events,
+        LoanIndex *activeLoans = nullptr);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,326 @@
+#include "saxloader.h"
+#include "Registry/idallocator.h"
+#include <stdexcept>
+
+SaxLoader::SaxLoader(vector<User> &users,
+                     vector<unique_ptr<Resource>> &resources,
+                     vector<Loan> &loans,
+                     vector<Reservation> &reservations,
+                     vector<Notification> &notifications,
+                     vector<LibraryEvent> &events,
+                     LoanIndex *activeLoans)
+    : users(users), resources(resources), loans(loans), reservations(reservations),
+      notifications(notifications), events(events), activeLoans(activeLoans)
+{
+}
+
+bool SaxLoader::load(istream &input, nlohmann::json::input_format_t format)
+{
+    errorMessage.clear();
+    bool ok = json::sax_parse(input, this, format);
+    if (!ok && errorMessage.empty())
+        errorMessage = "Unexpected end of input";
+    return ok;
+}
+
+bool SaxLoader::load(const uint8_t *data, size_t size, nlohmann::json::input_format_t format)
+{
+    errorMessage.clear();
+    bool ok = json::sax_parse(data, data + size, this, format);
+    if (!ok && errorMessage.empty())
+        errorMessage = "Unexpected end of input";
+    return ok;
+}
+
+void SaxLoader::reserve(const std::string &sectionName, size_t count)
+{
+    if (sectionName == "users")
+        users.reserve(users.size() + count);
+    else if (sectionName == "resources")
+        resources.reserve(resources.size() + count);
+    else if (sectionName == "loans")
+        loans.reserve(loans.size() + count);
+    else if (sectionName == "reservations")
+        reservations.reserve(reservations.size() + count);
+    else if (sectionName == "notifications")
+        notifications.reserve(notifications.size() + count);
+    else if (sectionName == "events")
+        events.reserve(events.size() + count);
+}
+
+const std::string &SaxLoader::getError() const
+{
+    return errorMessage;
+}
+
+const json &SaxLoader::getConfig() const
+{
+    return config;
+}
+
+void SaxLoader::setConfig(const json &config)
+{
+    checkConfig(config);
+    this->config = config;
+}
+
+bool SaxLoader::fail(const std::string &message)
+{
+    errorMessage = message;
+    return false;
+}
+
+bool SaxLoader::capturing() const
+{
+    return !building.empty();
+}
+
+// Entities start one level below a section: either the section value itself
+// (the config object) or an element of a section array.
+bool SaxLoader::openContainer(json value)
+{
+    if (!capturing())
+    {
+        bool entityLevel = (frames.size() == 1 && !section.empty()) ||
+                           (frames.size() == 2 && frames[1] == 'a');
+        if (!entityLevel)
+        {
+            if (frames.empty() && value.is_object())
+            {
+                frames.push_back('o');
+                return true;
+            }
+            if (frames.size() == 1 && value.is_array())
+            {
+                frames.push_back('a');
+                return true;
+            }
+            return fail("Unexpected structure in section '" + section + "'");
+        }
+        if (frames.size() == 1 && value.is_array())
+        {
+            frames.push_back('a'); // section array
+            return true;
+        }
+
+        current = std::move(value);
+        building.push_back(&current);
+        return true;
+    }
+
+    json *parent = building.back();
+    if (parent->is_object())
+    {
+        json &slot = (*parent)[pendingKey];
+        slot = std::move(value);
+        building.push_back(&slot);
+    }
+    else
+    {
+        parent->push_back(std::move(value));
+        building.push_back(&parent->back());
+    }
+    return true;
+}
+
+bool SaxLoader::closeContainer()
+{
+    if (capturing())
+    {
+        building.pop_back();
+        return capturing() || finishEntity();
+    }
+
+    if (frames.empty())
+        return fail("Unbalanced Json");
+    frames.pop_back();
+    if (frames.size() == 1)
+        section.clear();
+    return true;
+}
+
+bool SaxLoader::addValue(json value)
+{
+    if (!capturing())
+    {
+        if (frames.size() == 1)
+        {
+            section.clear(); // scalar section values are ignored
+            return true;
+        }
+        return fail("Unexpected value in section '" + section + "'");
+    }
+
+    json *parent = building.back();
+    if (parent->is_object())
+        (*parent)[pendingKey] = std::move(value);
+    else
+        parent->push_back(std::move(value));
+    return true;
+}
+
+void SaxLoader::checkConfig(const json &config)
+{
+    if (config.is_null())
+        return;
+    if (!config.is_object())
+    {
+        throw invalid_argument("Config is not an object");
+    }
+    if (config.contains("maxRenewals"))
+    {
+        int maxRenewals = config["maxRenewals"].get<int>();
+        if (maxRenewals < 0 || maxRenewals > 10)
+        {
+            throw invalid_argument("Invalid maxRenewals value");
+        }
+    }
+    if (config.contains("loanPeriodDays"))
+    {
+        int loanPeriod = config["loanPeriodDays"].get<int>();
+        if (loanPeriod < 1 || loanPeriod > 365)
+        {
+            throw invalid_argument("Invalid loanPeriodDays value");
+        }
+    }
+    if (config.contains("nextIds"))
+    {
+        const json &nextIds = config["nextIds"];
+        bool valid = nextIds.is_object();
+        for (const auto &next : nextIds)
+            valid = valid && next.is_number_unsigned();
+        if (!valid)
+        {
+            throw invalid_argument("Invalid nextIds value");
+        }
+    }
+}
+
+void SaxLoader::applyConfig(const json &config)
+{
+    checkConfig(config);
+    if (config.is_null())
+        return;
+    if (config.contains("maxRenewals"))
+        Loan::setMaxRenewals(config["maxRenewals"].get<int>());
+    if (config.contains("loanPeriodDays"))
+        Loan::setLoanPeriod(config["loanPeriodDays"].get<int>());
+    if (config.contains("nextIds"))
+        IdAllocator::global().fromJson(config["nextIds"]);
+}
+
+// Loans are clamped to the renewal limit of the file being read, which is
+// not the current setting until the caller applies the config
+int SaxLoader::renewalLimit(const json &config)
+{
+    if (config.is_object() && config.contains("maxRenewals"))
+        return config["maxRenewals"].get<int>();
+    return Loan::getMaxRenewals();
+}
+
+bool SaxLoader::finishEntity()
+{
+    try
+    {
+        if (section == "config")
+        {
+            checkConfig(current);
+            config = std::move(current);
+            section.clear();
+        }
+        else if (section == "users")
+            users.push_back(User::fromJson(current));
+        else if (section == "resources")
+            resources.push_back(Resource::fromJson(current));
+        else if (section == "loans")
+        {
+            loans.push_back(Loan::fromJson(current, renewalLimit(config)));
+            if (activeLoans)
+                activeLoans->add(loans.back(), loans.size() - 1);
+        }
+        else if (section == "reservations")
+            reservations.push_back(Reservation::fromJson(current));
+        else if (section == "notifications")
+            notifications.push_back(Notification::fromJson(current));
+        else if (section == "events")
+            events.push_back(LibraryEvent::fromJson(current));
+        // Unknown sections are skipped
+    }
+    catch (const exception &e)
+    {
+        return fail("Failed to load " + section + ": " + e.what());
+    }
+
+    current = json();
+    return true;
+}
+
+// SAX events
+bool SaxLoader::null()
+{
+    return addValue(nullptr);
+}
+
+bool SaxLoader::boolean(bool val)
+{
+    return addValue(val);
+}
+
+bool SaxLoader::number_integer(number_integer_t val)
+{
+    return addValue(val);
+}
+
+bool SaxLoader::number_unsigned(number_unsigned_t val)
+{
+    return addValue(val);
+}
+
+bool SaxLoader::number_float(number_float_t val, const string_t &)
+{
+    return addValue(val);
+}
+
+bool SaxLoader::string(string_t &val)
+{
+    return addValue(std::move(val));
+}
+
+bool SaxLoader::binary(binary_t &val)
+{
+    return addValue(json::binary(std::move(val)));
+}
+
+bool SaxLoader::start_object(std::size_t)
+{
+    return openContainer(json::object());
+}
+
+bool SaxLoader::key(string_t &val)
+{
+    if (capturing())
+        pendingKey = std::move(val);
+    else if (frames.size() == 1)
+        section = std::move(val);
+    return true;
+}
+
+bool SaxLoader::end_object()
+{
+    return closeContainer();
+}
+
+bool SaxLoader::start_array(std::size_t)
+{
+    return openContainer(json::array());
+}
+
+bool SaxLoader::end_array()
+{
+    return closeContainer();
+}
+
+bool SaxLoader::parse_error(std::size_t position, const std::string &, const nlohmann::detail::exception &ex)
+{
+    return fail("JSON parsing error at byte " + std::to_string(position) + ": " + ex.what());
+}
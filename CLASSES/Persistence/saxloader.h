@@ -0,0 +1,99 @@
+#ifndef SAXLOADER_H
+#define SAXLOADER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <istream>
+#include "Json/json.hpp"
+#include "User/user.h"
+#include "Resource/resource.h"
+#include "Loan/loan.h"
+#include "Reservation/reservation.h"
+#include "Notification/notification.h"
+#include "LibraryEvent/libraryevent.h"
+#include "Registry/loanindex.h"
+
+using namespace std;
+using json = nlohmann::json;
+
+// Single-pass streaming loader for the library data file.
+// Only the entity currently being read is held as Json; it is turned into
+// its User, Resource, Loan ... as soon as its closing brace arrives, so
+// memory stays proportional to one entity instead of the whole file.
+// The config section is only validated and kept; the caller applies it once
+// the whole load has succeeded, so a bad file leaves the settings alone.
+// Note: the member named string() hides std::string inside this class.
+class SaxLoader : public nlohmann::json_sax<json>
+{
+private:
+    vector<User> &users;
+    vector<unique_ptr<Resource>> &resources;
+    vector<Loan> &loans;
+    vector<Reservation> &reservations;
+    vector<Notification> &notifications;
+    vector<LibraryEvent> &events;
+    LoanIndex *activeLoans;
+
+    std::vector<char> frames;     // containers open outside the captured entity
+    std::string section;          // key of the current top-level section
+    json current;                 // entity being captured
+    std::vector<json *> building; // open containers inside the captured entity
+    std::string pendingKey;
+    std::string errorMessage;
+    json config; // validated config section, not applied yet
+
+    // Helper methods
+    bool capturing() const;
+    bool openContainer(json value);
+    bool closeContainer();
+    bool addValue(json value);
+    bool finishEntity();
+    bool fail(const std::string &message);
+
+public:
+    // Constructor/Destructor
+    SaxLoader(vector<User> &users,
+              vector<unique_ptr<Resource>> &resources,
+              vector<Loan> &loans,
+              vector<Reservation> &reservations,
+              vector<Notification> &notifications,
+              vector<LibraryEvent> &events,
+              LoanIndex *activeLoans = nullptr);
+    ~SaxLoader() = default;
+
+    // Parses the stream in the given format; returns false with getError() set
+    bool load(istream &input, nlohmann::json::input_format_t format = nlohmann::json::input_format_t::json);
+    bool load(const uint8_t *data, size_t size, nlohmann::json::input_format_t format);
+    // Pre-sizes the target vector when the record count is known up front
+    void reserve(const std::string &sectionName, size_t count);
+    const std::string &getError() const;
+
+    // Config read by load(), or given to a loader that reads a single section
+    const json &getConfig() const;
+    void setConfig(const json &config);
+
+    // Throws on out-of-range values
+    static void checkConfig(const json &config);
+    // The renewal limit a config section sets, or the current one
+    static int renewalLimit(const json &config);
+    // Validates the whole config object, then applies it
+    static void applyConfig(const json &config);
+
+    // SAX events
+    bool null() override;
+    bool boolean(bool val) override;
+    bool number_integer(number_integer_t val) override;
+    bool number_unsigned(number_unsigned_t val) override;
+    bool number_float(number_float_t val, const string_t &s) override;
+    bool string(string_t &val) override;
+    bool binary(binary_t &val) override;
+    bool start_object(std::size_t elements) override;
+    bool key(string_t &val) override;
+    bool end_object() override;
+    bool start_array(std::size_t elements) override;
+    bool end_array() override;
+    bool parse_error(std::size_t position, const std::string &last_token, const nlohmann::detail::exception &ex) override;
+};
+
+#endif
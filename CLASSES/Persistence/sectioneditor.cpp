@@ -0,0 +1,134 @@
+#include "sectioneditor.h"
+
+namespace
+{
+    const string &idOf(const User &u)
+    {
+        return u.getUserId();
+    }
+
+    const string &idOf(const unique_ptr<Resource> &r)
+    {
+        return r->getResourceId();
+    }
+
+    const string &idOf(const Loan &l)
+    {
+        return l.getLoanId();
+    }
+
+    const string &idOf(const Reservation &r)
+    {
+        return r.getReservationId();
+    }
+
+    const string &idOf(const Notification &n)
+    {
+        return n.getNotificationId();
+    }
+
+    const string &idOf(const LibraryEvent &e)
+    {
+        return e.getEventId();
+    }
+}
+
+template <typename Item>
+size_t SectionEditor::Section<Item>::find(const string &id)
+{
+    if (index.empty())
+    {
+        for (size_t i = 0; i < items.size(); ++i)
+            index[idOf(items[i])] = i;
+    }
+    auto it = index.find(id);
+    return it != index.end() ? it->second : string::npos;
+}
+
+template <typename Item>
+void SectionEditor::Section<Item>::upsert(Item item)
+{
+    string id = idOf(item);
+    size_t pos = find(id);
+    if (pos != string::npos)
+    {
+        items[pos] = std::move(item);
+        return;
+    }
+    items.push_back(std::move(item));
+    index[id] = items.size() - 1;
+}
+
+template <typename Item>
+void SectionEditor::Section<Item>::erase(const string &id)
+{
+    size_t pos = find(id);
+    if (pos == string::npos)
+        return;
+    size_t last = items.size() - 1;
+    if (pos != last)
+    {
+        items[pos] = std::move(items[last]);
+        index[idOf(items[pos])] = pos;
+    }
+    items.pop_back();
+    index.erase(id);
+}
+
+SectionEditor::SectionEditor(
+    vector<User> &users,
+    vector<unique_ptr<Resource>> &resources,
+    vector<Loan> &loans,
+    vector<Reservation> &reservations,
+    vector<Notification> &notifications,
+    vector<LibraryEvent> &events)
+    : users(users), resources(resources), loans(loans), reservations(reservations), notifications(notifications),
+      events(events)
+{
+}
+
+void SectionEditor::upsert(User user)
+{
+    users.upsert(std::move(user));
+}
+
+void SectionEditor::upsert(unique_ptr<Resource> resource)
+{
+    resources.upsert(std::move(resource));
+}
+
+void SectionEditor::upsert(Loan loan)
+{
+    loans.upsert(std::move(loan));
+}
+
+void SectionEditor::upsert(Reservation reservation)
+{
+    reservations.upsert(std::move(reservation));
+}
+
+void SectionEditor::upsert(Notification notification)
+{
+    notifications.upsert(std::move(notification));
+}
+
+void SectionEditor::upsert(LibraryEvent event)
+{
+    events.upsert(std::move(event));
+}
+
+void SectionEditor::erase(const string &section, const string &id)
+{
+    if (section == "users")
+        users.erase(id);
+    else if (section == "resources")
+        resources.erase(id);
+    else if (section == "loans")
+        loans.erase(id);
+    else if (section == "reservations")
+        reservations.erase(id);
+    else if (section == "notifications")
+        notifications.erase(id);
+    else if (section == "events")
+        events.erase(id);
+}
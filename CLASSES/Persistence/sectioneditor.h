@@ -0,0 +1,63 @@
+#ifndef SECTIONEDITOR_H
+#define SECTIONEDITOR_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "User/user.h"
+#include "Resource/resource.h"
+#include "Loan/loan.h"
+#include "Reservation/reservation.h"
+#include "Notification/notification.h"
+#include "LibraryEvent/libraryevent.h"
+using namespace std;
+
+// Upserts and removals by ID over the six entity sections of a data set,
+// used to replay a delta, merge saved changes into a base and layer
+// snapshot captures. Each section's ID -> position map is built on first
+// use. A removal moves the last element into the gap, so order is not kept.
+class SectionEditor
+{
+private:
+    template <typename Item>
+    struct Section
+    {
+        vector<Item> &items;
+        unordered_map<string, size_t> index;
+
+        explicit Section(vector<Item> &items) : items(items) {}
+        size_t find(const string &id);
+        void upsert(Item item);
+        void erase(const string &id);
+    };
+
+    Section<User> users;
+    Section<unique_ptr<Resource>> resources;
+    Section<Loan> loans;
+    Section<Reservation> reservations;
+    Section<Notification> notifications;
+    Section<LibraryEvent> events;
+
+public:
+    SectionEditor(
+        vector<User> &users,
+        vector<unique_ptr<Resource>> &resources,
+        vector<Loan> &loans,
+        vector<Reservation> &reservations,
+        vector<Notification> &notifications,
+        vector<LibraryEvent> &events);
+
+    // Replaces the entity with the same ID, or appends it
+    void upsert(User user);
+    void upsert(unique_ptr<Resource> resource);
+    void upsert(Loan loan);
+    void upsert(Reservation reservation);
+    void upsert(Notification notification);
+    void upsert(LibraryEvent event);
+
+    // Unknown sections and IDs are ignored
+    void erase(const string &section, const string &id);
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "snapshotter.h"
+#include "persistence.h"
+#include "sectioneditor.h"
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+bool SnapshotState::empty() const
+{
+    return !complete && users.empty() && resources.empty() && loans.empty() && reservations.empty() &&
+           notifications.empty() && events.empty() && removed.empty();
+}
+
+Snapshotter::Snapshotter()
+    : interval(chrono::minutes(5)), dirtyLimit(1000), stopping(false), limitReached(false)
+{
+}
+
+Snapshotter::~Snapshotter()
+{
+    stop();
+}
+
+void Snapshotter::start(const string &filepath, const string &archivePath, chrono::seconds interval, size_t dirtyLimit,
+                        Capture capture)
+{
+    stop();
+    this->filepath = filepath;
+    this->archivePath = archivePath;
+    this->capture = std::move(capture);
+    configure(interval, dirtyLimit);
+    stopping = false;
+    limitReached = false;
+    worker = thread(&Snapshotter::workerLoop, this);
+}
+
+void Snapshotter::stop()
+{
+    {
+        lock_guard<mutex> lock(stateMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable())
+        worker.join();
+}
+
+void Snapshotter::configure(chrono::seconds interval, size_t dirtyLimit)
+{
+    lock_guard<mutex> lock(stateMutex);
+    this->interval = interval;
+    this->dirtyLimit = (dirtyLimit == 0) ? 1 : dirtyLimit;
+}
+
+void Snapshotter::changed(size_t dirtyCount)
+{
+    // Only the change that reaches the limit pays for the wake-up
+    if (dirtyCount != dirtyLimit.load(memory_order_relaxed))
+        return;
+    {
+        lock_guard<mutex> lock(stateMutex);
+        limitReached = true;
+    }
+    wake.notify_all();
+}
+
+SnapshotMetrics Snapshotter::metrics() const
+{
+    lock_guard<mutex> lock(stateMutex);
+    return stats;
+}
+
+void Snapshotter::workerLoop()
+{
+    while (true)
+    {
+        {
+            unique_lock<mutex> lock(stateMutex);
+            wake.wait_for(lock, interval, [this]()
+                          { return stopping || limitReached; });
+            if (stopping)
+                return;
+            limitReached = false;
+        }
+        saveNow();
+    }
+}
+
+bool Snapshotter::saveNow()
+{
+    lock_guard<mutex> saving(saveMutex);
+    if (!capture)
+        return false;
+
+    auto started = chrono::steady_clock::now();
+    unique_ptr<SnapshotState> state = capture();
+    double captureSeconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    if (unsaved)
+    {
+        layer(*unsaved, *state);
+        state = std::move(unsaved);
+    }
+    if (state->empty())
+        return true;
+
+    started = chrono::steady_clock::now();
+    bool ok = Persistence::saveChanges(filepath, state->users, state->resources, state->loans,
+                                       state->reservations, state->notifications, state->events,
+                                       state->removed, state->complete);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    // The data file now covers every archived log record
+    if (ok)
+    {
+        error_code ec;
+        fs::remove(archivePath, ec);
+    }
+    else
+    {
+        unsaved = std::move(state);
+    }
+
+    lock_guard<mutex> lock(stateMutex);
+    if (ok)
+        ++stats.completed;
+    else
+        ++stats.failed;
+    stats.lastCaptureSeconds = captureSeconds;
+    stats.lastWriteSeconds = seconds;
+    stats.maxWriteSeconds = max(stats.maxWriteSeconds, seconds);
+    stats.totalWriteSeconds += seconds;
+    return ok;
+}
+
+// Applies a newer capture on top of an older one. Removals go first, so an
+// entity removed and added again stays, and are kept for the save; changed
+// entities replace their old copies by ID.
+void Snapshotter::layer(SnapshotState &older, SnapshotState &newer)
+{
+    if (newer.complete)
+    {
+        swap(older, newer);
+        return;
+    }
+
+    SectionEditor editor(older.users, older.resources, older.loans, older.reservations, older.notifications,
+                         older.events);
+    for (const auto &entry : newer.removed)
+    {
+        editor.erase(entry.first, entry.second);
+        older.removed.push_back(entry);
+    }
+
+    for (auto &u : newer.users)
+        editor.upsert(std::move(u));
+    for (auto &r : newer.resources)
+        editor.upsert(std::move(r));
+    for (auto &l : newer.loans)
+        editor.upsert(std::move(l));
+    for (auto &r : newer.reservations)
+        editor.upsert(std::move(r));
+    for (auto &n : newer.notifications)
+        editor.upsert(std::move(n));
+    for (auto &e : newer.events)
+        editor.upsert(std::move(e));
+}
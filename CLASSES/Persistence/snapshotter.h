@@ -0,0 +1,104 @@
+#ifndef SNAPSHOTTER_H
+#define SNAPSHOTTER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include "User/user.h"
+#include "Resource/resource.h"
+#include "Loan/loan.h"
+#include "Reservation/reservation.h"
+#include "Notification/notification.h"
+#include "LibraryEvent/libraryevent.h"
+using namespace std;
+
+// Copies of the entities changed since the previous capture, plus the
+// (section, id) pairs removed since then, taken where the collections are
+// consistent. A complete state holds the whole data set instead.
+struct SnapshotState
+{
+    bool complete = false;
+    vector<User> users;
+    vector<unique_ptr<Resource>> resources;
+    vector<Loan> loans;
+    vector<Reservation> reservations;
+    vector<Notification> notifications;
+    vector<LibraryEvent> events;
+    vector<pair<string, string>> removed;
+
+    bool empty() const;
+};
+
+struct SnapshotMetrics
+{
+    size_t completed = 0;
+    size_t failed = 0;
+    double lastCaptureSeconds = 0; // time the owner's capture held its locks
+    double lastWriteSeconds = 0;   // time spent saving the capture
+    double maxWriteSeconds = 0;
+    double totalWriteSeconds = 0;
+};
+
+// Writes snapshots through Persistence on a background thread.
+// The thread wakes when the interval elapses or the owner reports that
+// dirtyLimit changes piled up, calls the owner's capture for copies of what
+// changed and saves them on top of the data file. The owner keeps no copy
+// of its state for this and never waits for a save; requests only wait
+// while the capture holds its locks. A capture that fails to save is kept
+// and saved together with the next one.
+class Snapshotter
+{
+public:
+    using Capture = function<unique_ptr<SnapshotState>()>;
+
+private:
+    string filepath;
+    string archivePath; // write-ahead log records covered by the unsaved captures
+    Capture capture;
+    chrono::steady_clock::duration interval;
+    atomic<size_t> dirtyLimit;
+
+    thread worker;
+    mutable mutex stateMutex;
+    condition_variable wake;
+    bool stopping;
+    bool limitReached;
+    SnapshotMetrics stats;
+
+    mutex saveMutex;                 // one capture and save at a time
+    unique_ptr<SnapshotState> unsaved; // captures whose save failed, guarded by saveMutex
+
+    // Helper methods
+    void workerLoop();
+    static void layer(SnapshotState &older, SnapshotState &newer);
+
+public:
+    // Constructor/Destructor
+    Snapshotter();
+    ~Snapshotter();
+
+    Snapshotter(const Snapshotter &) = delete;
+    Snapshotter &operator=(const Snapshotter &) = delete;
+
+    void start(const string &filepath, const string &archivePath, chrono::seconds interval, size_t dirtyLimit,
+               Capture capture);
+    // Waits for the snapshot in flight, then stops the thread
+    void stop();
+    void configure(chrono::seconds interval, size_t dirtyLimit);
+
+    // Called by the owner after each change; wakes the thread once
+    // dirtyCount reaches the limit
+    void changed(size_t dirtyCount);
+    // Captures and saves on the calling thread, e.g. at shutdown after stop().
+    // Removes the log archive once everything captured so far is saved.
+    bool saveNow();
+    SnapshotMetrics metrics() const;
+};
+
+#endif
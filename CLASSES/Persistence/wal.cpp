@@ -0,0 +1,371 @@
+#include "wal.h"
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+#include <array>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+WriteAheadLog::WriteAheadLog()
+    : file(nullptr), committedSize(0), pendingCount(0), appended(0), durable(0), writing(false)
+{
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    close();
+}
+
+uint32_t WriteAheadLog::crc32(const char *data, size_t length)
+{
+    // Logs are written from several threads; a local static is built once, safely
+    static const array<uint32_t, 256> table = []()
+    {
+        array<uint32_t, 256> entries{};
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            entries[i] = c;
+        }
+        return entries;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; i++)
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void WriteAheadLog::putUint32(string &out, uint32_t value)
+{
+    // Little-endian so logs are portable between machines
+    for (int i = 0; i < 4; i++)
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+uint32_t WriteAheadLog::getUint32(const unsigned char *in)
+{
+    return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8) |
+           (static_cast<uint32_t>(in[2]) << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+bool WriteAheadLog::syncFile(FILE *f)
+{
+    if (fflush(f) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+bool WriteAheadLog::open(const string &filepath)
+{
+    close();
+    lock_guard<mutex> lock(stateMutex);
+    path = filepath;
+    pending.clear();
+    pendingCount = 0;
+    durable = appended;
+
+    if (!cutTornTail(filepath))
+    {
+        cerr << "Warning: Cannot repair write-ahead log: " << filepath << endl;
+        return false;
+    }
+    file = fopen(filepath.c_str(), "ab");
+    if (!file)
+    {
+        cerr << "Warning: Cannot open write-ahead log: " << filepath << endl;
+        return false;
+    }
+    error_code ec;
+    committedSize = fs::file_size(filepath, ec);
+    if (ec)
+        committedSize = 0;
+    return true;
+}
+
+void WriteAheadLog::close()
+{
+    commit();
+    unique_lock<mutex> lock(stateMutex);
+    written.wait(lock, [this]()
+                 { return !writing; });
+    if (file)
+    {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+bool WriteAheadLog::isOpen() const
+{
+    lock_guard<mutex> lock(stateMutex);
+    return file != nullptr;
+}
+
+bool WriteAheadLog::append(const json &record)
+{
+    string frame;
+    try
+    {
+        string payload = record.dump();
+        putUint32(frame, static_cast<uint32_t>(payload.size()));
+        putUint32(frame, crc32(payload.data(), payload.size()));
+        frame += payload;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error: Cannot encode log record: " << e.what() << endl;
+        return false;
+    }
+
+    lock_guard<mutex> lock(stateMutex);
+    if (path.empty())
+        return false;
+    pending += frame;
+    ++pendingCount;
+    ++appended;
+    return true;
+}
+
+bool WriteAheadLog::commit()
+{
+    unique_lock<mutex> lock(stateMutex);
+    const uint64_t target = appended;
+    while (durable < target)
+    {
+        if (writing)
+        {
+            written.wait(lock);
+            continue;
+        }
+
+        // Take everything pending, including records other callers appended
+        writing = true;
+        string batch;
+        batch.swap(pending);
+        size_t batchCount = pendingCount;
+        pendingCount = 0;
+        uint64_t batchEnd = appended;
+
+        lock.unlock();
+        bool ok = writeBatch(batch);
+        lock.lock();
+
+        writing = false;
+        if (ok)
+        {
+            durable = batchEnd;
+        }
+        else
+        {
+            pending.insert(0, batch);
+            pendingCount += batchCount;
+        }
+        written.notify_all();
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+// Runs without the lock; writing keeps everyone else off the file
+bool WriteAheadLog::writeBatch(const string &batch)
+{
+    if (!file)
+    {
+        file = fopen(path.c_str(), "ab");
+        if (!file)
+        {
+            cerr << "Error: Cannot reopen write-ahead log: " << path << endl;
+            return false;
+        }
+    }
+
+    if (fwrite(batch.data(), 1, batch.size(), file) != batch.size() || !syncFile(file))
+    {
+        cerr << "Error: Failed to commit write-ahead log: " << path << endl;
+        discardUncommitted();
+        return false;
+    }
+    committedSize += batch.size();
+    return true;
+}
+
+// A failed write can leave part of a record in the file, or in the stream
+// buffer. Replay would stop at it and drop every record written after, so
+// the file is cut back to the last committed record and reopened.
+void WriteAheadLog::discardUncommitted()
+{
+    fclose(file);
+    error_code ec;
+    fs::resize_file(path, committedSize, ec);
+    file = fopen(path.c_str(), "ab");
+    if (ec || !file)
+        cerr << "Error: Cannot restore write-ahead log: " << path << endl;
+}
+
+// Empties the file; callers hold stateMutex while nobody is writing
+bool WriteAheadLog::truncate()
+{
+    // Reopening in write mode truncates the file
+    FILE *truncated = file ? freopen(path.c_str(), "wb", file) : fopen(path.c_str(), "wb");
+    if (!truncated)
+    {
+        file = nullptr;
+        cerr << "Error: Failed to reset write-ahead log: " << path << endl;
+        return false;
+    }
+    file = truncated;
+    committedSize = 0;
+    return syncFile(file);
+}
+
+bool WriteAheadLog::reset()
+{
+    unique_lock<mutex> lock(stateMutex);
+    written.wait(lock, [this]()
+                 { return !writing; });
+    if (path.empty())
+        return false;
+
+    pending.clear();
+    pendingCount = 0;
+    durable = appended;
+    return truncate();
+}
+
+bool WriteAheadLog::rotate(const string &archivePath)
+{
+    unique_lock<mutex> lock(stateMutex);
+    written.wait(lock, [this]()
+                 { return !writing; });
+    if (!file)
+        return false;
+
+    error_code ec;
+    if (!fs::exists(archivePath, ec))
+    {
+        fclose(file);
+        file = nullptr;
+        fs::rename(path, archivePath, ec);
+        if (ec)
+            cerr << "Error: Failed to archive write-ahead log: " << path << endl;
+        file = fopen(path.c_str(), "ab");
+        if (!file)
+            cerr << "Warning: Cannot open write-ahead log: " << path << endl;
+        // If the rename failed the records are still in this file
+        error_code sizeError;
+        committedSize = ec ? fs::file_size(path, sizeError) : 0;
+        if (sizeError)
+            committedSize = 0;
+        return file && !ec;
+    }
+
+    // An earlier archive is still waiting for its snapshot, so extend it
+    FILE *archive = cutTornTail(archivePath) ? fopen(archivePath.c_str(), "ab") : nullptr;
+    FILE *current = fopen(path.c_str(), "rb");
+    bool ok = archive && current;
+    char buffer[64 * 1024];
+    size_t n;
+    while (ok && (n = fread(buffer, 1, sizeof(buffer), current)) > 0)
+        ok = fwrite(buffer, 1, n, archive) == n;
+    ok = ok && syncFile(archive);
+    if (current)
+        fclose(current);
+    if (archive)
+        fclose(archive);
+    if (!ok)
+    {
+        cerr << "Error: Failed to archive write-ahead log: " << path << endl;
+        return false;
+    }
+    return truncate();
+}
+
+size_t WriteAheadLog::pendingRecords() const
+{
+    lock_guard<mutex> lock(stateMutex);
+    return pendingCount;
+}
+
+uint64_t WriteAheadLog::readRecords(const string &filepath, const function<void(const json &)> *apply,
+                                    size_t &applied, size_t &skipped)
+{
+    ifstream ifs(filepath, ios::binary);
+    if (!ifs.is_open())
+        return 0;
+
+    uint64_t goodOffset = 0;
+    string payload;
+    unsigned char header[8];
+
+    while (ifs.read(reinterpret_cast<char *>(header), sizeof(header)))
+    {
+        uint32_t length = getUint32(header);
+        uint32_t checksum = getUint32(header + 4);
+        if (length > MAX_RECORD_SIZE)
+            break;
+
+        payload.resize(length);
+        if (!ifs.read(&payload[0], length))
+            break;
+        if (crc32(payload.data(), length) != checksum)
+            break;
+
+        if (apply)
+        {
+            try
+            {
+                (*apply)(json::parse(payload));
+                ++applied;
+            }
+            catch (const exception &e)
+            {
+                cerr << "Warning: Skipping unreadable log record: " << e.what() << endl;
+                ++skipped;
+            }
+        }
+
+        goodOffset += sizeof(header) + length;
+    }
+    return goodOffset;
+}
+
+bool WriteAheadLog::cutTornTail(const string &filepath)
+{
+    error_code ec;
+    uintmax_t size = fs::file_size(filepath, ec);
+    if (ec)
+        return !fs::exists(filepath, ec);
+
+    size_t applied = 0, skipped = 0;
+    uint64_t goodOffset = readRecords(filepath, nullptr, applied, skipped);
+    if (size <= goodOffset)
+        return true;
+
+    cerr << "Warning: Discarding corrupt write-ahead log tail." << endl;
+    fs::resize_file(filepath, goodOffset, ec);
+    return !ec;
+}
+
+size_t WriteAheadLog::replay(const string &filepath, const function<void(const json &)> &apply,
+                             size_t *skipped)
+{
+    size_t applied = 0, skippedCount = 0;
+    readRecords(filepath, &apply, applied, skippedCount);
+    if (skipped)
+        *skipped = skippedCount;
+    return applied;
+}
@@ -0,0 +1,95 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include "Json/json.hpp"
+
+using namespace std;
+using json = nlohmann::json;
+
+// Append-only write-ahead log of mutations.
+// Each record is framed as [length:u32][crc32:u32][payload], with the payload
+// being compact Json. Replay stops at a torn or corrupt tail and leaves the
+// file alone; it is cut off only when the log is opened for appending.
+// Safe to use from several threads. append() only buffers; commit() is a
+// group commit: one caller takes everything pending, writes and fsyncs it
+// without holding the lock, and callers that commit meanwhile wait for that
+// write (or start the next one) instead of each doing their own fsync.
+// A commit that fails keeps its records pending and cuts the file back to
+// the last committed record, so the next commit writes them again.
+class WriteAheadLog
+{
+private:
+    string path;
+    FILE *file;             // touched only by the writing caller, or under stateMutex while nobody writes
+    uint64_t committedSize; // bytes of whole, synced records in the file
+
+    mutable mutex stateMutex; // guards the fields below, never held during a commit's I/O
+    condition_variable written;
+    string pending; // encoded records waiting for the next commit
+    size_t pendingCount;
+    uint64_t appended; // sequence number of the last buffered record
+    uint64_t durable;  // sequence number of the last record known to be on disk
+    bool writing;      // a commit is writing outside the lock
+
+    static const uint32_t MAX_RECORD_SIZE = 64 * 1024 * 1024;
+
+    // Helper methods
+    static void putUint32(string &out, uint32_t value);
+    static uint32_t getUint32(const unsigned char *in);
+    static bool syncFile(FILE *f);
+    bool writeBatch(const string &batch);
+    void discardUncommitted();
+    bool truncate();
+    // Reads intact records from the start of the file, passing each to apply
+    // when given, and returns the offset just past the last one
+    static uint64_t readRecords(const string &filepath, const function<void(const json &)> *apply,
+                                size_t &applied, size_t &skipped);
+    // Cuts whatever follows the last intact record, so appends continue from it
+    static bool cutTornTail(const string &filepath);
+
+public:
+    // Constructor/Destructor
+    WriteAheadLog();
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+    static uint32_t crc32(const char *data, size_t length);
+
+    // Opens (or creates) the log for appending, cutting off a torn tail
+    bool open(const string &filepath);
+    void close();
+    bool isOpen() const;
+
+    // Buffers one record; it is durable only after the next commit().
+    // Returns false if the log is not open or the record cannot be encoded.
+    bool append(const json &record);
+    // Makes every record appended before the call durable. Returns false on
+    // I/O failure, leaving the records pending.
+    bool commit();
+    // Discards the log contents, called once a snapshot covers them
+    bool reset();
+    // Moves everything written so far into archivePath (appending if it
+    // already exists) and continues with an empty file. Used when a snapshot
+    // is taken while new records keep arriving; records still pending are
+    // written to the new file by the next commit.
+    bool rotate(const string &archivePath);
+
+    size_t pendingRecords() const;
+
+    // Replays every intact record in order and returns how many applied.
+    // Records apply threw on are counted in skipped. Read-only: replay stops
+    // at a corrupt or truncated tail and leaves the file as it is.
+    static size_t replay(const string &filepath, const function<void(const json &)> &apply,
+                         size_t *skipped = nullptr);
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include "catalogcolumns.h"
+#include "stringpool.h"
+#include "TextSearch/textsearch.h"
+#include "Resource/book.h"
+#include "Resource/article.h"
+#include "Resource/thesis.h"
+#include <algorithm>
+
+const uint32_t CatalogColumns::noMatch = UINT32_MAX;
+
+uint32_t CatalogColumns::internKey(const string &value)
+{
+    return StringPool::global().intern(value).folded().id();
+}
+
+uint32_t CatalogColumns::symbolKey(const string &value)
+{
+    if (value.empty())
+        return 0;
+
+    // Interning a value also interns its lowercase form
+    Symbol symbol = StringPool::global().find(TextSearch::toLower(value));
+    return symbol.empty() ? noMatch : symbol.id();
+}
+
+// Atomics cannot live in a vector, so the column grows by copying into a
+// larger array. Only add and reserve call this, under exclusive access.
+void CatalogColumns::reserveAvailable(size_t capacity)
+{
+    if (capacity <= availableCapacity)
+        return;
+    capacity = max(capacity, availableCapacity * 2);
+    unique_ptr<atomic<uint8_t>[]> grown(new atomic<uint8_t>[capacity]);
+    for (size_t i = 0; i < capacity; i++)
+        grown[i].store(i < availableCapacity ? available[i].load(memory_order_relaxed) : 0, memory_order_relaxed);
+    available = std::move(grown);
+    availableCapacity = capacity;
+}
+
+void CatalogColumns::add(Registry::Handle handle, const Resource &resource)
+{
+    if (handle >= kind.size())
+    {
+        size_t size = static_cast<size_t>(handle) + 1;
+        kind.resize(size, ResourceKind::None);
+        year.resize(size, 0);
+        reserveAvailable(size);
+        category.resize(size, 0);
+        author.resize(size, 0);
+        row.resize(size, 0);
+    }
+
+    year[handle] = resource.getPublicationYear();
+    available[handle].store(resource.getAvailable() ? 1 : 0, memory_order_relaxed);
+    category[handle] = internKey(resource.getCategory());
+    author[handle] = internKey(resource.getAuthor());
+
+    if (const Book *book = dynamic_cast<const Book *>(&resource))
+    {
+        kind[handle] = ResourceKind::Book;
+        row[handle] = static_cast<uint32_t>(bookColumns.handle.size());
+        bookColumns.handle.push_back(handle);
+        bookColumns.pages.push_back(book->getNumberOfPages());
+        bookColumns.publisher.push_back(internKey(book->getPublisher()));
+    }
+    else if (const Article *article = dynamic_cast<const Article *>(&resource))
+    {
+        kind[handle] = ResourceKind::Article;
+        row[handle] = static_cast<uint32_t>(articleColumns.handle.size());
+        articleColumns.handle.push_back(handle);
+        articleColumns.magazine.push_back(internKey(article->getMagazine()));
+        articleColumns.volume.push_back(article->getVolume());
+        articleColumns.issue.push_back(article->getIssue());
+    }
+    else if (const Thesis *thesis = dynamic_cast<const Thesis *>(&resource))
+    {
+        kind[handle] = ResourceKind::Thesis;
+        row[handle] = static_cast<uint32_t>(thesisColumns.handle.size());
+        thesisColumns.handle.push_back(handle);
+        thesisColumns.university.push_back(internKey(thesis->getUniversity()));
+        thesisColumns.department.push_back(internKey(thesis->getDepartment()));
+        thesisColumns.thesisType.push_back(static_cast<uint8_t>(thesis->getThesisType()));
+        thesisColumns.pages.push_back(thesis->getPageCount());
+    }
+    else
+    {
+        kind[handle] = ResourceKind::None;
+    }
+}
+
+void CatalogColumns::remove(Registry::Handle handle)
+{
+    if (handle < kind.size())
+        kind[handle] = ResourceKind::None;
+}
+
+void CatalogColumns::setAvailable(Registry::Handle handle, bool isAvailable)
+{
+    if (handle < kind.size())
+        available[handle].store(isAvailable ? 1 : 0, memory_order_relaxed);
+}
+
+void CatalogColumns::clear()
+{
+    kind.clear();
+    year.clear();
+    available.reset();
+    availableCapacity = 0;
+    category.clear();
+    author.clear();
+    row.clear();
+    bookColumns = BookColumns();
+    articleColumns = ArticleColumns();
+    thesisColumns = ThesisColumns();
+}
+
+void CatalogColumns::reserve(size_t expected)
+{
+    kind.reserve(expected);
+    year.reserve(expected);
+    reserveAvailable(expected);
+    category.reserve(expected);
+    author.reserve(expected);
+    row.reserve(expected);
+}
+
+void CatalogColumns::select(const CatalogFilter &filter, vector<Registry::Handle> &result) const
+{
+    result.clear();
+    size_t n = kind.size();
+    const uint8_t wantKind = static_cast<uint8_t>(filter.kind);
+    const uint8_t anyKind = (filter.kind == ResourceKind::None) ? 1 : 0;
+    const uint8_t anyCategory = (filter.category == 0) ? 1 : 0;
+    const uint8_t anyAuthor = (filter.author == 0) ? 1 : 0;
+
+    // First pass is branch-free over plain arrays so the compiler can
+    // vectorize it; the second collects the few survivors and checks
+    // availability, which checkouts may be changing meanwhile.
+    vector<uint8_t> keep(n);
+    const uint8_t *kinds = reinterpret_cast<const uint8_t *>(kind.data());
+    for (size_t i = 0; i < n; i++)
+    {
+        keep[i] = static_cast<uint8_t>(
+            (kinds[i] != 0) &
+            (anyKind | (kinds[i] == wantKind)) &
+            (year[i] >= filter.minYear) &
+            (year[i] <= filter.maxYear) &
+            (anyCategory | (category[i] == filter.category)) &
+            (anyAuthor | (author[i] == filter.author)));
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (keep[i] && (!filter.availableOnly || available[i].load(memory_order_relaxed)))
+            result.push_back(static_cast<Registry::Handle>(i));
+    }
+}
+
+size_t CatalogColumns::count(const CatalogFilter &filter) const
+{
+    vector<Registry::Handle> result;
+    select(filter, result);
+    return result.size();
+}
+
+const CatalogColumns::BookColumns &CatalogColumns::books() const
+{
+    return bookColumns;
+}
+
+const CatalogColumns::ArticleColumns &CatalogColumns::articles() const
+{
+    return articleColumns;
+}
+
+const CatalogColumns::ThesisColumns &CatalogColumns::theses() const
+{
+    return thesisColumns;
+}
+
+ResourceKind CatalogColumns::kindOf(Registry::Handle handle) const
+{
+    return (handle < kind.size()) ? kind[handle] : ResourceKind::None;
+}
+
+uint32_t CatalogColumns::rowOf(Registry::Handle handle) const
+{
+    return (handle < row.size()) ? row[handle] : 0;
+}
@@ -0,0 +1,118 @@
+#ifndef CATALOGCOLUMNS_H
+#define CATALOGCOLUMNS_H
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <climits>
+#include <memory>
+#include <atomic>
+#include "registry.h"
+#include "Resource/resource.h"
+using namespace std;
+
+enum class ResourceKind : uint8_t
+{
+    None, // removed handle, or any kind in a filter
+    Book,
+    Article,
+    Thesis
+};
+
+// Conditions for CatalogColumns::select; the defaults match everything
+struct CatalogFilter
+{
+    ResourceKind kind = ResourceKind::None;
+    int minYear = INT_MIN;
+    int maxYear = INT_MAX;
+    bool availableOnly = false;
+    uint32_t category = 0; // symbol key from CatalogColumns::symbolKey, 0 = any
+    uint32_t author = 0;
+};
+
+// Struct-of-arrays copy of the fields catalog filters look at, indexed by
+// resource handle. Scans walk a few contiguous arrays instead of chasing
+// resource pointers and virtual calls. String fields are stored as the id of
+// their lowercased pool symbol, so comparing them is an integer compare.
+// Fields only some kinds have live in per-kind side tables, reached
+// through the row column.
+// Adding and removing rows needs exclusive access. setAvailable may run
+// alongside select, as checkouts publish under a shared lock.
+class CatalogColumns
+{
+public:
+    struct BookColumns
+    {
+        vector<Registry::Handle> handle;
+        vector<int32_t> pages;
+        vector<uint32_t> publisher;
+    };
+
+    struct ArticleColumns
+    {
+        vector<Registry::Handle> handle;
+        vector<uint32_t> magazine;
+        vector<int32_t> volume;
+        vector<int32_t> issue;
+    };
+
+    struct ThesisColumns
+    {
+        vector<Registry::Handle> handle;
+        vector<uint32_t> university;
+        vector<uint32_t> department;
+        vector<uint8_t> thesisType;
+        vector<int32_t> pages;
+    };
+
+    static const uint32_t noMatch; // key of a value no resource has
+
+private:
+    // Per handle
+    vector<ResourceKind> kind;
+    vector<int32_t> year;
+    unique_ptr<atomic<uint8_t>[]> available; // kind.size() of availableCapacity slots in use
+    size_t availableCapacity = 0;
+    vector<uint32_t> category;
+    vector<uint32_t> author;
+    vector<uint32_t> row; // position in the side table of the kind
+
+    // Per kind; rows of removed resources stay until the next clear
+    BookColumns bookColumns;
+    ArticleColumns articleColumns;
+    ThesisColumns thesisColumns;
+
+    // Helper methods
+    static uint32_t internKey(const string &value);
+    void reserveAvailable(size_t capacity);
+
+public:
+    // Constructor/Destructor
+    CatalogColumns() = default;
+    ~CatalogColumns() = default;
+    CatalogColumns(const CatalogColumns &) = delete;
+    CatalogColumns &operator=(const CatalogColumns &) = delete;
+
+    // Maintenance
+    void add(Registry::Handle handle, const Resource &resource);
+    void remove(Registry::Handle handle);
+    void setAvailable(Registry::Handle handle, bool isAvailable);
+    void clear();
+    void reserve(size_t expected);
+
+    // Key to filter a string column on (case-insensitive, whole value).
+    // Returns 0 for an empty value and noMatch if no resource can have it.
+    static uint32_t symbolKey(const string &value);
+
+    // Handles of matching resources, in handle order
+    void select(const CatalogFilter &filter, vector<Registry::Handle> &result) const;
+    size_t count(const CatalogFilter &filter) const;
+
+    // Side tables and the row of a handle in its kind's table
+    const BookColumns &books() const;
+    const ArticleColumns &articles() const;
+    const ThesisColumns &theses() const;
+    ResourceKind kindOf(Registry::Handle handle) const;
+    uint32_t rowOf(Registry::Handle handle) const;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "idallocator.h"
+#include <stdexcept>
+#include <tuple>
+
+const uint64_t IdAllocator::FIRST_ID = 1001;
+
+IdAllocator::IdAllocator(initializer_list<string> prefixes)
+{
+    for (const auto &prefix : prefixes)
+        counters.emplace(piecewise_construct, forward_as_tuple(prefix), forward_as_tuple(FIRST_ID));
+}
+
+IdAllocator &IdAllocator::global()
+{
+    static IdAllocator allocator({"USER", "RES", "LOAN", "RSV", "NOTIF", "EVT"});
+    return allocator;
+}
+
+atomic<uint64_t> &IdAllocator::counter(const string &prefix)
+{
+    auto it = counters.find(prefix);
+    if (it == counters.end())
+        throw invalid_argument("Unknown ID prefix: " + prefix);
+    return it->second;
+}
+
+const atomic<uint64_t> &IdAllocator::counter(const string &prefix) const
+{
+    auto it = counters.find(prefix);
+    if (it == counters.end())
+        throw invalid_argument("Unknown ID prefix: " + prefix);
+    return it->second;
+}
+
+void IdAllocator::raise(atomic<uint64_t> &value, uint64_t atLeast)
+{
+    uint64_t current = value.load();
+    while (current < atLeast && !value.compare_exchange_weak(current, atLeast))
+    {
+    }
+}
+
+string IdAllocator::next(const string &prefix)
+{
+    return prefix + to_string(counter(prefix).fetch_add(1));
+}
+
+IdAllocator::Block IdAllocator::reserve(const string &prefix, uint64_t count)
+{
+    Block block;
+    block.prefix = prefix;
+    block.next = counter(prefix).fetch_add(count);
+    block.end = block.next + count;
+    return block;
+}
+
+uint64_t IdAllocator::peek(const string &prefix) const
+{
+    return counter(prefix).load();
+}
+
+void IdAllocator::observe(const string &prefix, const string &id)
+{
+    if (id.size() <= prefix.size() || id.size() - prefix.size() > 18 || id.compare(0, prefix.size(), prefix) != 0)
+        return;
+
+    uint64_t number = 0;
+    for (size_t i = prefix.size(); i < id.size(); i++)
+    {
+        if (id[i] < '0' || id[i] > '9')
+            return; // not one of ours
+        number = number * 10 + static_cast<uint64_t>(id[i] - '0');
+    }
+    raise(counter(prefix), number + 1);
+}
+
+json IdAllocator::toJson() const
+{
+    json j = json::object();
+    for (const auto &entry : counters)
+        j[entry.first] = entry.second.load();
+    return j;
+}
+
+void IdAllocator::fromJson(const json &j)
+{
+    for (auto it = j.begin(); it != j.end(); ++it)
+    {
+        auto counter = counters.find(it.key());
+        if (counter != counters.end())
+            raise(counter->second, it.value().get<uint64_t>());
+    }
+}
+
+// Block
+bool IdAllocator::Block::empty() const
+{
+    return next >= end;
+}
+
+string IdAllocator::Block::take()
+{
+    if (empty())
+        throw out_of_range("ID block exhausted for prefix " + prefix);
+    return prefix + to_string(next++);
+}
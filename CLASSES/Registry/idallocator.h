@@ -0,0 +1,64 @@
+#ifndef IDALLOCATOR_H
+#define IDALLOCATOR_H
+#include <string>
+#include <map>
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include "Json/json.hpp"
+using namespace std;
+using json = nlohmann::json;
+
+// Hands out IDs of the form <prefix><number>, with one counter per prefix.
+// The prefixes are fixed at construction, so allocating is a single atomic
+// add and never takes a lock. A writer that needs many IDs can reserve a
+// block and hand them out locally.
+// The counters are saved with the snapshot config (see toJson/fromJson) and
+// only ever move forward, so an ID is never handed out twice across restarts.
+class IdAllocator
+{
+public:
+    static const uint64_t FIRST_ID;
+
+    // A contiguous run of reserved IDs owned by one writer
+    struct Block
+    {
+        string prefix;
+        uint64_t next = 0;
+        uint64_t end = 0;
+
+        bool empty() const;
+        string take();
+    };
+
+private:
+    map<string, atomic<uint64_t>> counters; // prefix -> next unused number
+
+    // Helper methods
+    atomic<uint64_t> &counter(const string &prefix);
+    const atomic<uint64_t> &counter(const string &prefix) const;
+    static void raise(atomic<uint64_t> &value, uint64_t atLeast);
+
+public:
+    // Constructor/Destructor
+    IdAllocator(initializer_list<string> prefixes);
+    ~IdAllocator() = default;
+    IdAllocator(const IdAllocator &) = delete;
+    IdAllocator &operator=(const IdAllocator &) = delete;
+
+    // The allocator for the library's entity IDs
+    static IdAllocator &global();
+
+    string next(const string &prefix);
+    Block reserve(const string &prefix, uint64_t count);
+    uint64_t peek(const string &prefix) const;
+
+    // Moves the counter past an ID that already exists (loaded or replayed)
+    void observe(const string &prefix, const string &id);
+
+    // Json (prefix -> next unused number)
+    json toJson() const;
+    void fromJson(const json &j);
+};
+
+#endif
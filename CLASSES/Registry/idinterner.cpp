@@ -0,0 +1,77 @@
+#include "idinterner.h"
+#include <mutex>
+
+const IdInterner::Handle IdInterner::none = 0;
+const IdInterner::Handle IdInterner::npos = UINT32_MAX;
+
+IdInterner::IdInterner() : count(0)
+{
+    chunks[0].reset(new string[FIRST_CHUNK]);
+    handles.emplace(chunks[0][0], none);
+    count.store(1, memory_order_release);
+}
+
+// Chunk c starts at handle FIRST_CHUNK * (2^c - 1)
+void IdInterner::locate(Handle handle, size_t &chunk, size_t &offset)
+{
+    size_t scaled = static_cast<size_t>(handle) / FIRST_CHUNK + 1;
+    chunk = 0;
+    while ((scaled >> (chunk + 1)) != 0)
+        ++chunk;
+    offset = static_cast<size_t>(handle) - FIRST_CHUNK * ((size_t(1) << chunk) - 1);
+}
+
+const string &IdInterner::slot(Handle handle) const
+{
+    size_t chunk, offset;
+    locate(handle, chunk, offset);
+    return chunks[chunk][offset];
+}
+
+IdInterner &IdInterner::global()
+{
+    static IdInterner interner;
+    return interner;
+}
+
+IdInterner::Handle IdInterner::intern(const string &id)
+{
+    {
+        shared_lock<shared_mutex> lock(mutex);
+        auto it = handles.find(id);
+        if (it != handles.end())
+            return it->second;
+    }
+
+    unique_lock<shared_mutex> lock(mutex);
+    auto it = handles.find(id); // another thread may have added it
+    if (it != handles.end())
+        return it->second;
+
+    Handle handle = static_cast<Handle>(count.load(memory_order_relaxed));
+    size_t chunk, offset;
+    locate(handle, chunk, offset);
+    if (!chunks[chunk])
+        chunks[chunk].reset(new string[FIRST_CHUNK << chunk]);
+    chunks[chunk][offset] = id;
+    handles.emplace(chunks[chunk][offset], handle);
+    count.store(static_cast<size_t>(handle) + 1, memory_order_release);
+    return handle;
+}
+
+IdInterner::Handle IdInterner::find(const string &id) const
+{
+    shared_lock<shared_mutex> lock(mutex);
+    auto it = handles.find(id);
+    return (it != handles.end()) ? it->second : npos;
+}
+
+const string &IdInterner::name(Handle handle) const
+{
+    return slot(handle < count.load(memory_order_acquire) ? handle : none);
+}
+
+size_t IdInterner::size() const
+{
+    return count.load(memory_order_acquire);
+}
@@ -0,0 +1,59 @@
+#ifndef IDINTERNER_H
+#define IDINTERNER_H
+#include <string>
+#include <string_view>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <shared_mutex>
+#include <cstdint>
+using namespace std;
+
+// Process-wide table of ID strings, each mapped to a dense 32-bit handle.
+// Entities that refer to other entities keep the handle, so a reference costs
+// four bytes and comparing two references is an integer compare. Handles are
+// never released; the empty ID always has handle 0.
+// Safe to use from several threads (snapshot writers and parallel loads read
+// names while the main thread interns new IDs). name() takes no lock, as
+// every loan, reservation and notification read goes through it.
+class IdInterner
+{
+public:
+    typedef uint32_t Handle;
+    static const Handle none; // the empty ID
+    static const Handle npos; // returned by find for unknown IDs
+
+private:
+    // handle -> ID in append-only chunks that never move: chunk c holds
+    // FIRST_CHUNK << c names. A name is written before count is raised past
+    // its handle, so readers below count need no lock.
+    static const size_t FIRST_CHUNK = 64;
+    static const size_t CHUNKS = 27; // enough for every 32-bit handle
+    unique_ptr<string[]> chunks[CHUNKS];
+    atomic<size_t> count;
+
+    unordered_map<string_view, Handle> handles; // guarded by mutex, as are appends
+    mutable shared_mutex mutex;
+
+    // Helper methods
+    static void locate(Handle handle, size_t &chunk, size_t &offset);
+    const string &slot(Handle handle) const;
+
+public:
+    // Constructor/Destructor
+    IdInterner();
+    ~IdInterner() = default;
+    IdInterner(const IdInterner &) = delete;
+    IdInterner &operator=(const IdInterner &) = delete;
+
+    static IdInterner &global();
+
+    // Returns the handle for id, adding it if it is new
+    Handle intern(const string &id);
+    // Returns npos if id was never interned
+    Handle find(const string &id) const;
+    const string &name(Handle handle) const;
+    size_t size() const;
+};
+
+#endif
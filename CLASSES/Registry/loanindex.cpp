@@ -0,0 +1,98 @@
+#include "loanindex.h"
+#include <algorithm>
+
+uint64_t LoanIndex::pairKey(IdInterner::Handle user, IdInterner::Handle resource)
+{
+    return (static_cast<uint64_t>(user) << 32) | resource;
+}
+
+void LoanIndex::eraseFrom(PositionLists &lists, IdInterner::Handle key, size_t position)
+{
+    auto it = lists.find(key);
+    if (it == lists.end())
+        return;
+
+    vector<size_t> &list = it->second;
+    auto pos = find(list.begin(), list.end(), position);
+    if (pos != list.end())
+        list.erase(pos);
+    if (list.empty())
+        lists.erase(it);
+}
+
+void LoanIndex::add(const Loan &loan, size_t position)
+{
+    if (loan.getIsReturned())
+        return;
+
+    // Only the first active loan of a pair is reachable, as with the old linear scan
+    activeByPair.emplace(pairKey(loan.getUserHandle(), loan.getResourceHandle()), position);
+    activeByUser[loan.getUserHandle()].push_back(position);
+    activeByResource[loan.getResourceHandle()].push_back(position);
+}
+
+void LoanIndex::remove(const Loan &loan, size_t position)
+{
+    auto it = activeByPair.find(pairKey(loan.getUserHandle(), loan.getResourceHandle()));
+    if (it != activeByPair.end() && it->second == position)
+        activeByPair.erase(it);
+    eraseFrom(activeByUser, loan.getUserHandle(), position);
+    eraseFrom(activeByResource, loan.getResourceHandle(), position);
+}
+
+void LoanIndex::build(const vector<Loan> &loans)
+{
+    clear();
+    activeByPair.reserve(loans.size());
+    for (size_t i = 0; i < loans.size(); i++)
+        add(loans[i], i);
+}
+
+void LoanIndex::clear()
+{
+    activeByPair.clear();
+    activeByUser.clear();
+    activeByResource.clear();
+}
+
+// String lookups resolve the IDs once; an ID that was never interned has no loans
+size_t LoanIndex::findActive(const string &userId, const string &resourceId) const
+{
+    const IdInterner &ids = IdInterner::global();
+    return findActive(ids.find(userId), ids.find(resourceId));
+}
+
+const vector<size_t> &LoanIndex::activeForUser(const string &userId) const
+{
+    return activeForUser(IdInterner::global().find(userId));
+}
+
+const vector<size_t> &LoanIndex::activeForResource(const string &resourceId) const
+{
+    return activeForResource(IdInterner::global().find(resourceId));
+}
+
+size_t LoanIndex::findActive(IdInterner::Handle user, IdInterner::Handle resource) const
+{
+    auto it = activeByPair.find(pairKey(user, resource));
+    return (it != activeByPair.end()) ? it->second : Registry::noPosition;
+}
+
+const vector<size_t> &LoanIndex::activeForUser(IdInterner::Handle user) const
+{
+    static const vector<size_t> none;
+    auto it = activeByUser.find(user);
+    return (it != activeByUser.end()) ? it->second : none;
+}
+
+const vector<size_t> &LoanIndex::activeForResource(IdInterner::Handle resource) const
+{
+    static const vector<size_t> none;
+    auto it = activeByResource.find(resource);
+    return (it != activeByResource.end()) ? it->second : none;
+}
+
+size_t LoanIndex::activeCount() const
+{
+    return activeByPair.size();
+}
@@ -0,0 +1,50 @@
+#ifndef LOANINDEX_H
+#define LOANINDEX_H
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "registry.h"
+#include "idinterner.h"
+#include "Loan/loan.h"
+using namespace std;
+
+// Secondary indexes over active (not yet returned) loans, keyed by interned
+// user and resource handles.
+// Positions refer to the loans vector, which is append-only, so they never move.
+// Returned loans are dropped from every index, so lookups do not slow down as
+// loan history grows.
+class LoanIndex
+{
+private:
+    typedef unordered_map<IdInterner::Handle, vector<size_t>> PositionLists;
+
+    unordered_map<uint64_t, size_t> activeByPair; // user + resource handle -> loan position
+    PositionLists activeByUser;
+    PositionLists activeByResource;
+
+    // Helper methods
+    static uint64_t pairKey(IdInterner::Handle user, IdInterner::Handle resource);
+    static void eraseFrom(PositionLists &lists, IdInterner::Handle key, size_t position);
+
+public:
+    // Constructor/Destructor
+    LoanIndex() = default;
+    ~LoanIndex() = default;
+
+    // Maintenance
+    void add(const Loan &loan, size_t position);
+    void remove(const Loan &loan, size_t position);
+    void build(const vector<Loan> &loans);
+    void clear();
+
+    // Lookups (positions into the loans vector)
+    size_t findActive(const string &userId, const string &resourceId) const;
+    const vector<size_t> &activeForUser(const string &userId) const;
+    const vector<size_t> &activeForResource(const string &resourceId) const;
+    size_t findActive(IdInterner::Handle user, IdInterner::Handle resource) const;
+    const vector<size_t> &activeForUser(IdInterner::Handle user) const;
+    const vector<size_t> &activeForResource(IdInterner::Handle resource) const;
+    size_t activeCount() const;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "registry.h"
+
+const Registry::Handle Registry::npos = UINT32_MAX;
+const size_t Registry::noPosition = SIZE_MAX;
+
+Registry::Registry() : count(0), used(0)
+{
+}
+
+// FNV-1a, good enough for short alphanumeric IDs
+uint64_t Registry::hashId(const string &id)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : id)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+size_t Registry::findSlot(const string &id) const
+{
+    if (slots.empty())
+        return noPosition;
+
+    size_t mask = slots.size() - 1;
+    size_t i = hashId(id) & mask;
+    while (slots[i].state != Empty)
+    {
+        if (slots[i].state == Occupied && slots[i].key == id)
+            return i;
+        i = (i + 1) & mask;
+    }
+    return noPosition;
+}
+
+void Registry::rehash(size_t newCapacity)
+{
+    size_t capacity = 16;
+    while (capacity < newCapacity)
+        capacity <<= 1;
+
+    vector<Slot> old;
+    old.swap(slots);
+    slots.resize(capacity);
+    used = count;
+
+    size_t mask = capacity - 1;
+    for (auto &slot : old)
+    {
+        if (slot.state != Occupied)
+            continue;
+        size_t i = hashId(slot.key) & mask;
+        while (slots[i].state != Empty)
+            i = (i + 1) & mask;
+        slots[i].key = std::move(slot.key);
+        slots[i].handle = slot.handle;
+        slots[i].state = Occupied;
+    }
+}
+
+Registry::Handle Registry::add(const string &id, size_t position)
+{
+    if (id.empty() || findSlot(id) != noPosition)
+        return npos;
+
+    // Keep the load factor (tombstones included) under 70%
+    if ((used + 1) * 10 > slots.size() * 7)
+        rehash((count + 1) * 2 * 10 / 7 + 1);
+
+    size_t mask = slots.size() - 1;
+    size_t i = hashId(id) & mask;
+    while (slots[i].state == Occupied)
+        i = (i + 1) & mask;
+
+    if (slots[i].state == Empty)
+        ++used;
+
+    Handle handle = static_cast<Handle>(positions.size());
+    positions.push_back(position);
+
+    slots[i].key = id;
+    slots[i].handle = handle;
+    slots[i].state = Occupied;
+    ++count;
+    return handle;
+}
+
+bool Registry::remove(const string &id)
+{
+    size_t i = findSlot(id);
+    if (i == noPosition)
+        return false;
+
+    // Handles are never reused, so posting lists keyed by handle stay valid
+    positions[slots[i].handle] = noPosition;
+    slots[i].key.clear();
+    slots[i].state = Deleted;
+    --count;
+    return true;
+}
+
+void Registry::clear()
+{
+    slots.clear();
+    positions.clear();
+    count = 0;
+    used = 0;
+}
+
+void Registry::reserve(size_t expected)
+{
+    positions.reserve(expected);
+    size_t needed = expected * 10 / 7 + 1;
+    if (needed > slots.size())
+        rehash(needed);
+}
+
+Registry::Handle Registry::find(const string &id) const
+{
+    size_t i = findSlot(id);
+    return (i != noPosition) ? slots[i].handle : npos;
+}
+
+size_t Registry::lookup(const string &id) const
+{
+    Handle handle = find(id);
+    return (handle != npos) ? positions[handle] : noPosition;
+}
+
+size_t Registry::position(Handle handle) const
+{
+    return (handle < positions.size()) ? positions[handle] : noPosition;
+}
+
+void Registry::relocate(Handle handle, size_t position)
+{
+    if (handle < positions.size() && positions[handle] != noPosition)
+        positions[handle] = position;
+}
+
+size_t Registry::size() const
+{
+    return count;
+}
+
+size_t Registry::handleCount() const
+{
+    return positions.size();
+}
@@ -0,0 +1,65 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+using namespace std;
+
+// Keyed registry mapping entity IDs to stable handles.
+// The table uses open addressing (linear probing) so a lookup is a single
+// hash plus a short probe. Each handle remembers the position of its entity
+// in the owning vector, so entities can be moved without invalidating handles.
+class Registry
+{
+public:
+    typedef uint32_t Handle;
+    static const Handle npos;
+    static const size_t noPosition;
+
+private:
+    enum SlotState : uint8_t
+    {
+        Empty,
+        Occupied,
+        Deleted
+    };
+
+    struct Slot
+    {
+        string key;
+        Handle handle = 0;
+        SlotState state = Empty;
+    };
+
+    vector<Slot> slots;
+    vector<size_t> positions; // handle -> position in the owning vector
+    size_t count;             // occupied slots
+    size_t used;              // occupied + deleted slots
+
+    // Helper methods
+    static uint64_t hashId(const string &id);
+    size_t findSlot(const string &id) const;
+    void rehash(size_t newCapacity);
+
+public:
+    // Constructor/Destructor
+    Registry();
+    ~Registry() = default;
+
+    // Registers id at the given position. Returns npos if id is already registered.
+    Handle add(const string &id, size_t position);
+    bool remove(const string &id);
+    void clear();
+    void reserve(size_t expected);
+
+    // Lookups
+    Handle find(const string &id) const;
+    size_t lookup(const string &id) const;
+    size_t position(Handle handle) const;
+    void relocate(Handle handle, size_t position);
+    size_t size() const;
+    size_t handleCount() const;
+};
+
+#endif
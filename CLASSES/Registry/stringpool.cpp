@@ -0,0 +1,126 @@
+#include "stringpool.h"
+#include "TextSearch/textsearch.h"
+#include <mutex>
+
+// Symbol
+Symbol::Symbol() : entry(nullptr)
+{
+}
+
+Symbol::Symbol(const Entry *entry) : entry(entry)
+{
+}
+
+const string &Symbol::str() const
+{
+    static const string emptyText;
+    return entry ? entry->text : emptyText;
+}
+
+const string &Symbol::lower() const
+{
+    return folded().str();
+}
+
+uint64_t Symbol::hash() const
+{
+    return entry ? entry->hash : 0;
+}
+
+uint32_t Symbol::id() const
+{
+    return entry ? entry->id : 0;
+}
+
+bool Symbol::empty() const
+{
+    return entry == nullptr;
+}
+
+Symbol Symbol::folded() const
+{
+    return Symbol(entry ? entry->folded : nullptr);
+}
+
+bool Symbol::equalsIgnoreCase(const Symbol &other) const
+{
+    return folded() == other.folded();
+}
+
+bool Symbol::operator==(const Symbol &other) const
+{
+    return entry == other.entry;
+}
+
+bool Symbol::operator!=(const Symbol &other) const
+{
+    return entry != other.entry;
+}
+
+// StringPool
+StringPool &StringPool::global()
+{
+    static StringPool pool;
+    return pool;
+}
+
+// FNV-1a, as for registry keys
+uint64_t StringPool::hashText(const string &text)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : text)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Adds text and its lowercase form; called with the mutex held exclusively
+const Symbol::Entry *StringPool::insertLocked(const string &text)
+{
+    auto it = index.find(text);
+    if (it != index.end())
+        return it->second;
+
+    string lower = TextSearch::toLower(text);
+    const Symbol::Entry *folded = (lower == text) ? nullptr : insertLocked(lower);
+
+    entries.emplace_back();
+    Symbol::Entry &entry = entries.back();
+    entry.text = text;
+    entry.hash = hashText(text);
+    entry.id = static_cast<uint32_t>(entries.size()); // 0 is the empty symbol
+    entry.folded = folded ? folded : &entry;
+    index.emplace(entry.text, &entry);
+    return &entry;
+}
+
+Symbol StringPool::intern(const string &text)
+{
+    if (text.empty())
+        return Symbol();
+
+    {
+        shared_lock<shared_mutex> lock(mutex);
+        auto it = index.find(text);
+        if (it != index.end())
+            return Symbol(it->second);
+    }
+
+    unique_lock<shared_mutex> lock(mutex);
+    return Symbol(insertLocked(text));
+}
+
+Symbol StringPool::find(const string &text) const
+{
+    shared_lock<shared_mutex> lock(mutex);
+    auto it = index.find(text);
+    return (it != index.end()) ? Symbol(it->second) : Symbol();
+}
+
+size_t StringPool::size() const
+{
+    shared_lock<shared_mutex> lock(mutex);
+    return entries.size();
+}
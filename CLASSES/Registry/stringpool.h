@@ -0,0 +1,79 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
+#include <shared_mutex>
+#include <cstdint>
+using namespace std;
+
+// Immutable handle to a string stored once in a StringPool.
+// Copying a symbol copies a pointer, two symbols are equal exactly when
+// their text is equal, and the hash and lowercase form are computed once
+// when the text is first interned.
+class Symbol
+{
+    friend class StringPool;
+
+private:
+    struct Entry
+    {
+        string text;
+        uint64_t hash = 0;
+        uint32_t id = 0;
+        const Entry *folded = nullptr; // entry of the lowercase text
+    };
+
+    const Entry *entry; // nullptr for the empty string
+
+    explicit Symbol(const Entry *entry);
+
+public:
+    // Constructor/Destructor
+    Symbol();
+    ~Symbol() = default;
+
+    const string &str() const;
+    const string &lower() const;
+    uint64_t hash() const;
+    uint32_t id() const;
+    bool empty() const;
+
+    // Comparisons are pointer compares
+    Symbol folded() const;
+    bool equalsIgnoreCase(const Symbol &other) const;
+    bool operator==(const Symbol &other) const;
+    bool operator!=(const Symbol &other) const;
+};
+
+// Process-wide pool for heavily repeated resource fields (authors,
+// categories, publishers, ...). Entries are never removed, so symbols stay
+// valid for the life of the program. Safe to use from several threads.
+class StringPool
+{
+private:
+    deque<Symbol::Entry> entries; // deque keeps entries in place as it grows
+    unordered_map<string_view, const Symbol::Entry *> index;
+    mutable shared_mutex mutex;
+
+    // Helper methods
+    static uint64_t hashText(const string &text);
+    const Symbol::Entry *insertLocked(const string &text);
+
+public:
+    // Constructor/Destructor
+    StringPool() = default;
+    ~StringPool() = default;
+    StringPool(const StringPool &) = delete;
+    StringPool &operator=(const StringPool &) = delete;
+
+    static StringPool &global();
+
+    Symbol intern(const string &text);
+    // Returns the empty symbol if text was never interned
+    Symbol find(const string &text) const;
+    size_t size() const;
+};
+
+#endif
@@ -0,0 +1,147 @@
+#include "textindex.h"
+#include <algorithm>
+
+bool TextIndex::isTermChar(unsigned char c)
+{
+    // Bytes of multi-byte UTF-8 sequences are kept inside terms
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+void TextIndex::tokenize(const string &text, vector<string> &terms)
+{
+    string term;
+    for (unsigned char c : text)
+    {
+        if (isTermChar(c))
+        {
+            term += (c >= 'A' && c <= 'Z') ? static_cast<char>(c + 32) : static_cast<char>(c);
+        }
+        else if (!term.empty())
+        {
+            terms.push_back(term);
+            term.clear();
+        }
+    }
+    if (!term.empty())
+        terms.push_back(term);
+}
+
+void TextIndex::collectTerms(const Resource &resource, vector<string> &terms)
+{
+    vector<const string *> fields;
+    resource.getSearchFields(fields);
+    for (const string *field : fields)
+        tokenize(*field, terms);
+
+    sort(terms.begin(), terms.end());
+    terms.erase(unique(terms.begin(), terms.end()), terms.end());
+}
+
+void TextIndex::collectShortGrams(const vector<string> &terms, vector<string> &grams)
+{
+    for (const string &term : terms)
+    {
+        for (size_t start = 0; start < term.length(); start++)
+        {
+            for (size_t length = 1; length <= SHORT_GRAM && start + length <= term.length(); length++)
+                grams.push_back(term.substr(start, length));
+        }
+    }
+
+    sort(grams.begin(), grams.end());
+    grams.erase(unique(grams.begin(), grams.end()), grams.end());
+}
+
+void TextIndex::addHandle(unordered_map<string, vector<Registry::Handle>> &lists, const string &key, Registry::Handle handle)
+{
+    vector<Registry::Handle> &list = lists[key];
+    // New handles are always the largest, so this is normally an append
+    auto pos = lower_bound(list.begin(), list.end(), handle);
+    if (pos == list.end() || *pos != handle)
+        list.insert(pos, handle);
+}
+
+void TextIndex::removeHandle(unordered_map<string, vector<Registry::Handle>> &lists, const string &key, Registry::Handle handle)
+{
+    auto it = lists.find(key);
+    if (it == lists.end())
+        return;
+
+    vector<Registry::Handle> &list = it->second;
+    auto pos = lower_bound(list.begin(), list.end(), handle);
+    if (pos != list.end() && *pos == handle)
+        list.erase(pos);
+    if (list.empty())
+        lists.erase(it);
+}
+
+void TextIndex::add(Registry::Handle handle, const Resource &resource)
+{
+    vector<string> terms, grams;
+    collectTerms(resource, terms);
+    collectShortGrams(terms, grams);
+    for (const string &term : terms)
+        addHandle(postings, term, handle);
+    for (const string &gram : grams)
+        addHandle(shortGrams, gram, handle);
+}
+
+void TextIndex::remove(Registry::Handle handle, const Resource &resource)
+{
+    vector<string> terms, grams;
+    collectTerms(resource, terms);
+    collectShortGrams(terms, grams);
+    for (const string &term : terms)
+        removeHandle(postings, term, handle);
+    for (const string &gram : grams)
+        removeHandle(shortGrams, gram, handle);
+}
+
+void TextIndex::clear()
+{
+    postings.clear();
+    shortGrams.clear();
+}
+
+const vector<Registry::Handle> &TextIndex::lookup(const string &term) const
+{
+    static const vector<Registry::Handle> none;
+    auto it = postings.find(term);
+    return (it != postings.end()) ? it->second : none;
+}
+
+bool TextIndex::candidates(const string &keyword, vector<Registry::Handle> &result, bool &exact) const
+{
+    result.clear();
+
+    // An occurrence of the keyword always contains its longest run of term
+    // characters inside a single term, so only terms containing that run matter.
+    vector<string> runs;
+    tokenize(keyword, runs);
+    if (runs.empty())
+        return false;
+
+    const string *longest = &runs[0];
+    for (const string &run : runs)
+    {
+        if (run.length() > longest->length())
+            longest = &run;
+    }
+
+    if (longest->length() > SHORT_GRAM)
+        return false;
+
+    // A keyword made of a single run can only match inside one term
+    exact = (runs.size() == 1 && runs[0].length() == keyword.length());
+
+    // The gram's list is already sorted and free of duplicates
+    auto it = shortGrams.find(*longest);
+    if (it != shortGrams.end())
+        result = it->second;
+    return true;
+}
+
+size_t TextIndex::termCount() const
+{
+    return postings.size();
+}
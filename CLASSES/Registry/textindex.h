@@ -0,0 +1,55 @@
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "registry.h"
+#include "Resource/resource.h"
+using namespace std;
+
+// Inverted index over the searchable fields of resources.
+// Terms are lowercased runs of letters/digits; each term, and each substring
+// of a term up to SHORT_GRAM bytes long, maps to a posting list of resource
+// handles kept sorted in handle order. Longer substrings are found through
+// the trigram index.
+class TextIndex
+{
+private:
+    unordered_map<string, vector<Registry::Handle>> postings;   // whole terms
+    unordered_map<string, vector<Registry::Handle>> shortGrams; // substrings of terms
+
+    static const size_t SHORT_GRAM = 2;
+
+    // Helper methods
+    static bool isTermChar(unsigned char c);
+    static void collectTerms(const Resource &resource, vector<string> &terms);
+    static void collectShortGrams(const vector<string> &terms, vector<string> &grams);
+    static void addHandle(unordered_map<string, vector<Registry::Handle>> &lists, const string &key, Registry::Handle handle);
+    static void removeHandle(unordered_map<string, vector<Registry::Handle>> &lists, const string &key, Registry::Handle handle);
+
+public:
+    // Constructor/Destructor
+    TextIndex() = default;
+    ~TextIndex() = default;
+
+    // Maintenance
+    void add(Registry::Handle handle, const Resource &resource);
+    void remove(Registry::Handle handle, const Resource &resource);
+    void clear();
+
+    // Splits text into lowercase terms
+    static void tokenize(const string &text, vector<string> &terms);
+
+    // Handles of resources containing the exact term
+    const vector<Registry::Handle> &lookup(const string &term) const;
+
+    // Candidate resources for a substring keyword search. Returns false when
+    // the keyword has no term characters, or a run longer than SHORT_GRAM
+    // (a job for the trigram index), and a full scan is needed. When exact
+    // is set, every candidate is a match and needs no verification.
+    bool candidates(const string &keyword, vector<Registry::Handle> &result, bool &exact) const;
+
+    size_t termCount() const;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "trigramindex.h"
+#include <algorithm>
+
+uint32_t TrigramIndex::pack(unsigned char a, unsigned char b, unsigned char c)
+{
+    // Same ASCII-only folding as Resource::toLower
+    auto fold = [](unsigned char ch) -> uint32_t
+    { return (ch >= 'A' && ch <= 'Z') ? ch + 32 : ch; };
+    return (fold(a) << 16) | (fold(b) << 8) | fold(c);
+}
+
+void TrigramIndex::collectTrigrams(const string &text, vector<uint32_t> &trigrams)
+{
+    for (size_t i = 0; i + 3 <= text.length(); i++)
+        trigrams.push_back(pack(text[i], text[i + 1], text[i + 2]));
+}
+
+void TrigramIndex::collectTrigrams(const Resource &resource, vector<uint32_t> &trigrams)
+{
+    // Trigrams are taken per field, since a match never spans two fields
+    vector<const string *> fields;
+    resource.getSearchFields(fields);
+    for (const string *field : fields)
+        collectTrigrams(*field, trigrams);
+
+    sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+void TrigramIndex::add(Registry::Handle handle, const Resource &resource)
+{
+    vector<uint32_t> trigrams;
+    collectTrigrams(resource, trigrams);
+    for (uint32_t trigram : trigrams)
+    {
+        vector<Registry::Handle> &list = postings[trigram];
+        auto pos = lower_bound(list.begin(), list.end(), handle);
+        if (pos == list.end() || *pos != handle)
+            list.insert(pos, handle);
+    }
+}
+
+void TrigramIndex::remove(Registry::Handle handle, const Resource &resource)
+{
+    vector<uint32_t> trigrams;
+    collectTrigrams(resource, trigrams);
+    for (uint32_t trigram : trigrams)
+    {
+        auto it = postings.find(trigram);
+        if (it == postings.end())
+            continue;
+
+        vector<Registry::Handle> &list = it->second;
+        auto pos = lower_bound(list.begin(), list.end(), handle);
+        if (pos != list.end() && *pos == handle)
+            list.erase(pos);
+        if (list.empty())
+            postings.erase(it);
+    }
+}
+
+void TrigramIndex::clear()
+{
+    postings.clear();
+}
+
+bool TrigramIndex::candidates(const string &keyword, vector<Registry::Handle> &result) const
+{
+    result.clear();
+    if (keyword.length() < 3)
+        return false;
+
+    vector<uint32_t> trigrams;
+    collectTrigrams(keyword, trigrams);
+    sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    // Intersect starting from the rarest trigram to keep intermediate sets small
+    vector<const vector<Registry::Handle> *> lists;
+    for (uint32_t trigram : trigrams)
+    {
+        auto it = postings.find(trigram);
+        if (it == postings.end())
+            return true; // some trigram never occurs, so nothing can match
+        lists.push_back(&it->second);
+    }
+    sort(lists.begin(), lists.end(),
+         [](const vector<Registry::Handle> *a, const vector<Registry::Handle> *b)
+         { return a->size() < b->size(); });
+
+    result = *lists[0];
+    vector<Registry::Handle> next;
+    for (size_t i = 1; i < lists.size() && !result.empty(); i++)
+    {
+        next.clear();
+        set_intersection(result.begin(), result.end(), lists[i]->begin(), lists[i]->end(), back_inserter(next));
+        result.swap(next);
+    }
+    return true;
+}
+
+size_t TrigramIndex::trigramCount() const
+{
+    return postings.size();
+}
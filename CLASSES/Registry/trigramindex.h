@@ -0,0 +1,42 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "registry.h"
+#include "Resource/resource.h"
+using namespace std;
+
+// Trigram index over the lowercased searchable fields of resources.
+// Any resource whose fields contain a keyword must contain every trigram
+// of the keyword, so intersecting the trigram posting lists yields a small
+// candidate set that is then verified with Resource::matchesKeyword.
+class TrigramIndex
+{
+private:
+    unordered_map<uint32_t, vector<Registry::Handle>> postings;
+
+    // Helper methods
+    static uint32_t pack(unsigned char a, unsigned char b, unsigned char c);
+    static void collectTrigrams(const string &text, vector<uint32_t> &trigrams);
+    static void collectTrigrams(const Resource &resource, vector<uint32_t> &trigrams);
+
+public:
+    // Constructor/Destructor
+    TrigramIndex() = default;
+    ~TrigramIndex() = default;
+
+    // Maintenance
+    void add(Registry::Handle handle, const Resource &resource);
+    void remove(Registry::Handle handle, const Resource &resource);
+    void clear();
+
+    // Candidates for a keyword of at least three characters.
+    // Returns false when the keyword is too short to be looked up.
+    bool candidates(const string &keyword, vector<Registry::Handle> &result) const;
+
+    size_t trigramCount() const;
+};
+
+#endif
@@ -2,20 +2,20 @@
 #include <iostream>
 
 Reservation::Reservation(const string &reservationId, const string &userId, const string &resourceId, time_t reservationDate)
-    : reservationId(reservationId), userId(userId), resourceId(resourceId), reservationDate(reservationDate), fulfillmentDate(0), status(ReservationStatus::Pending) 
+    : reservationId(reservationId), user(IdInterner::none), resource(IdInterner::none), reservationDate(reservationDate), fulfillmentDate(0), status(ReservationStatus::Pending) 
 {
     if (!reservationId.empty() && !isValidReservationId(reservationId)) {
         cerr << "Warning: Invalid reservation ID provided. Using empty string." << endl;
         this->reservationId = "";
     }
-    if (!userId.empty() && !isValidId(userId)) {
+    if (!userId.empty() && !isValidId(userId))
         cerr << "Warning: Invalid user ID provided. Using empty string." << endl;
-        this->userId = "";
-    }
-    if (!resourceId.empty() && !isValidId(resourceId)) {
+    else
+        user = IdInterner::global().intern(userId);
+    if (!resourceId.empty() && !isValidId(resourceId))
         cerr << "Warning: Invalid resource ID provided. Using empty string." << endl;
-        this->resourceId = "";
-    }
+    else
+        resource = IdInterner::global().intern(resourceId);
     if (reservationDate != 0 && !isValidDate(reservationDate)) {
         cerr << "Warning: Invalid reservation date provided. Using current time." << endl;
         this->reservationDate = time(nullptr);
@@ -32,12 +32,22 @@ const string &Reservation::getReservationId() const
 
 const string &Reservation::getUserId() const
 {
-    return userId;
+    return IdInterner::global().name(user);
 }
 
 const string &Reservation::getResourceId() const
 {
-    return resourceId;
+    return IdInterner::global().name(resource);
+}
+
+IdInterner::Handle Reservation::getUserHandle() const
+{
+    return user;
+}
+
+IdInterner::Handle Reservation::getResourceHandle() const
+{
+    return resource;
 }
 
 time_t Reservation::getReservationDate() const
@@ -57,7 +67,7 @@ ReservationStatus Reservation::getReservationStatus() const
 
 void Reservation::cancel()
 {
-    if (reservationId.empty() || userId.empty() || resourceId.empty()) {
+    if (reservationId.empty() || user == IdInterner::none || resource == IdInterner::none) {
         cerr << "Error: Cannot cancel reservation with missing information." << endl;
         return;
     }
@@ -73,7 +83,7 @@ void Reservation::cancel()
 
 void Reservation::fulfill()
 {
-    if (reservationId.empty() || userId.empty() || resourceId.empty()) {
+    if (reservationId.empty() || user == IdInterner::none || resource == IdInterner::none) {
         cerr << "Error: Cannot fulfill reservation with missing information." << endl;
         return;
     }
@@ -156,8 +166,8 @@ json Reservation::toJson() const
     }
     return json{
         {"reservationId", reservationId},
-        {"userId", userId},
-        {"resourceId", resourceId},
+        {"userId", getUserId()},
+        {"resourceId", getResourceId()},
         {"reservationDate", reservationDate},
         {"fulfillmentDate", fulfillmentDate},
         {"status", statusStr}};
@@ -3,6 +3,7 @@
 #include <string>
 #include <ctime>
 #include "Json/json.hpp"
+#include "Registry/idinterner.h"
 using json = nlohmann::json;
 using namespace std;
 
@@ -17,8 +18,8 @@ class Reservation
 {
 private:
     string reservationId;
-    string userId;
-    string resourceId;
+    IdInterner::Handle user;     // interned userId
+    IdInterner::Handle resource; // interned resourceId
     time_t reservationDate;
     time_t fulfillmentDate; // 0 means no fulfillment yet
     ReservationStatus status;
@@ -35,6 +36,8 @@ public:
     const string &getReservationId() const;
     const string &getUserId() const;
     const string &getResourceId() const;
+    IdInterner::Handle getUserHandle() const;
+    IdInterner::Handle getResourceHandle() const;
     time_t getReservationDate() const;
     time_t getFulfillmentDate() const;
     ReservationStatus getReservationStatus() const;
@@ -1,4 +1,5 @@
 #include "article.h"
+#include "TextSearch/textsearch.h"
 #include <iostream>
 using namespace std;
 
@@ -21,10 +22,10 @@ void Article::displayInfo() const
     cout << "Author:       " << getAuthor() << "\n";
     cout << "Year:         " << getPublicationYear() << "\n";
     cout << "Category:     " << getCategory() << "\n";
-    cout << "Available:    " << (getAvailable() ? "Yes" : "No") << "\n";
+    cout << "Available:    " << describeAvailability() << "\n";
 
     // Article-specific fields
-    cout << "Magazine:     " << magazine << "\n";
+    cout << "Magazine:     " << magazine.str() << "\n";
     cout << "Volume:       " << volume << "\n";
     cout << "Issue:        " << issue << "\n";
 
@@ -37,6 +38,11 @@ void Article::displayInfo() const
     cout << "----------------------\n";
 }
 
+unique_ptr<Resource> Article::clone() const
+{
+    return make_unique<Article>(*this);
+}
+
 const string &Article::getType() const
 {
     static const string type = "Article";
@@ -72,12 +78,12 @@ bool Article::isValidPageRange(int start, int end) const
 
 void Article::setMagazine(const string &magazine)
 {
-    this->magazine = magazine.empty() ? "Unknown Magazine" : magazine;
+    this->magazine = StringPool::global().intern(magazine.empty() ? "Unknown Magazine" : magazine);
 }
 
 const string &Article::getMagazine() const
 {
-    return magazine;
+    return magazine.str();
 }
 
 void Article::setVolume(int volume)
@@ -188,81 +194,15 @@ bool Article::matchesKeyword(const string &keyword) const
     if (Resource::matchesKeyword(keyword))
         return true;
 
-    string lowerKeyword = "";
-    for (int i = 0; i < keyword.length(); i++)
-    {
-        char c = keyword[i];
-        if (c >= 'A' && c <= 'Z')
-            lowerKeyword += (c + 32);
-        else
-            lowerKeyword += c;
-    }
-
-    string lowerMagazine = "";
-    for (int i = 0; i < magazine.length(); i++)
-    {
-        char c = magazine[i];
-        if (c >= 'A' && c <= 'Z')
-            lowerMagazine += (c + 32);
-        else
-            lowerMagazine += c;
-    }
-
-    string lowerDOI = "";
-    for (int i = 0; i < doi.length(); i++)
-    {
-        char c = doi[i];
-        if (c >= 'A' && c <= 'Z')
-            lowerDOI += (c + 32);
-        else
-            lowerDOI += c;
-    }
-
-    bool foundInMagazine = false;
-    if (lowerMagazine.length() >= lowerKeyword.length())
-    {
-        for (int i = 0; i <= lowerMagazine.length() - lowerKeyword.length(); i++)
-        {
-            bool match = true;
-            for (int j = 0; j < lowerKeyword.length(); j++)
-            {
-                if (lowerMagazine[i + j] != lowerKeyword[j])
-                {
-                    match = false;
-                    break;
-                }
-            }
-            if (match)
-            {
-                foundInMagazine = true;
-                break;
-            }
-        }
-    }
-
-    bool foundInDOI = false;
-    if (lowerDOI.length() >= lowerKeyword.length())
-    {
-        for (int i = 0; i <= lowerDOI.length() - lowerKeyword.length(); i++)
-        {
-            bool match = true;
-            for (int j = 0; j < lowerKeyword.length(); j++)
-            {
-                if (lowerDOI[i + j] != lowerKeyword[j])
-                {
-                    match = false;
-                    break;
-                }
-            }
-            if (match)
-            {
-                foundInDOI = true;
-                break;
-            }
-        }
-    }
+    return (TextSearch::containsIgnoreCase(magazine.str(), keyword) ||
+            TextSearch::containsIgnoreCase(doi, keyword));
+}
 
-    return (foundInMagazine || foundInDOI);
+void Article::getSearchFields(vector<const string *> &fields) const
+{
+    Resource::getSearchFields(fields);
+    fields.push_back(&magazine.str());
+    fields.push_back(&doi);
 }
 
 // Json
@@ -275,7 +215,9 @@ json Article::toJson() const
         {"category", getCategory()},
         {"publicationYear", getPublicationYear()},
         {"isAvailable", getAvailable()},
-        {"magazine", magazine},
+        {"copies", getCopies()},
+        {"copiesOnLoan", getCopiesOnLoan()},
+        {"magazine", magazine.str()},
         {"volume", volume},
         {"issue", issue},
         {"doi", doi},
@@ -301,7 +243,7 @@ Article Article::fromJson(const json &j)
             j.value("startPage", -1),
             j.value("endPage", -1));
 
-        article.setAvailable(j.at("isAvailable").get<bool>());
+        article.readHoldings(j);
         return article;
     }
     catch (const json::exception &e)
@@ -6,7 +6,7 @@ using namespace std;
 class Article : public Resource
 {
 private:
-    string magazine;
+    Symbol magazine; // interned
     int volume;
     int issue;
     string doi;
@@ -21,6 +21,7 @@ public:
     // Methods
     void displayInfo() const override;
     const string &getType() const override;
+    unique_ptr<Resource> clone() const override;
 
     // Validation methods
     bool isValidVolume(int vol) const;
@@ -47,7 +48,8 @@ public:
     string getVolumeIssueInfo() const;
 
     // Override search method for article-specific fields
-    bool matchesKeyword(const string &keyword) const;
+    bool matchesKeyword(const string &keyword) const override;
+    void getSearchFields(vector<const string *> &fields) const override;
 
     // Json
     json toJson() const override;
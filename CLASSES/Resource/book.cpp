@@ -1,5 +1,6 @@
 #include "book.h"
 #include <iostream>
+#include "TextSearch/textsearch.h"
 using namespace std;
 
 Book::Book(const string &title, const string &author, const string &resourceId, const string &category, int publicationYear, const string &publisher, int numberOfPages, const string &isbn, const string &edition)
@@ -20,10 +21,10 @@ void Book::displayInfo() const
     cout << "Author:       " << getAuthor() << "\n";
     cout << "Year:         " << getPublicationYear() << "\n";
     cout << "Category:     " << getCategory() << "\n";
-    cout << "Available:    " << (getAvailable() ? "Yes" : "No") << "\n";
+    cout << "Available:    " << describeAvailability() << "\n";
 
     // Book-specific fields
-    cout << "Publisher:    " << publisher << "\n";
+    cout << "Publisher:    " << publisher.str() << "\n";
     cout << "Pages:        " << numberOfPages << "\n";
 
     if (!isbn.empty() && isbn != "N/A")
@@ -35,6 +36,11 @@ void Book::displayInfo() const
     cout << "----------------------\n";
 }
 
+unique_ptr<Resource> Book::clone() const
+{
+    return make_unique<Book>(*this);
+}
+
 const string &Book::getType() const
 {
     static const string type = "Book";
@@ -95,12 +101,12 @@ int Book::getNumberOfPages() const
 
 void Book::setPublisher(const string &publisher)
 {
-    this->publisher = publisher.empty() ? "Unknown Publisher" : publisher;
+    this->publisher = StringPool::global().intern(publisher.empty() ? "Unknown Publisher" : publisher);
 }
 
 const string &Book::getPublisher() const
 {
-    return publisher;
+    return publisher.str();
 }
 
 void Book::setISBN(const string &isbn)
@@ -152,82 +158,15 @@ bool Book::matchesKeyword(const string &keyword) const
     if (Resource::matchesKeyword(keyword))
         return true;
 
-    string lowerKeyword = "";
-    for (int i = 0; i < keyword.length(); i++)
-    {
-        char c = keyword[i];
-        if (c >= 'A' && c <= 'Z')
-            lowerKeyword += (c + 32);
-        else
-            lowerKeyword += c;
-    }
-
-    string lowerPublisher = "";
-    for (int i = 0; i < publisher.length(); i++)
-    {
-        char c = publisher[i];
-        if (c >= 'A' && c <= 'Z')
-            lowerPublisher += (c + 32);
-        else
-            lowerPublisher += c;
-    }
-
-    string lowerISBN = "";
-    for (int i = 0; i < isbn.length(); i++)
-    {
-        char c = isbn[i];
-        if (c >= 'A' && c <= 'Z')
-            lowerISBN += (c + 32);
-        else
-            lowerISBN += c;
-    }
-
-    bool foundInPublisher = false;
-    bool foundInISBN = false;
-
-    if (lowerPublisher.length() >= lowerKeyword.length())
-    {
-        for (int i = 0; i <= lowerPublisher.length() - lowerKeyword.length(); i++)
-        {
-            bool match = true;
-            for (int j = 0; j < lowerKeyword.length(); j++)
-            {
-                if (lowerPublisher[i + j] != lowerKeyword[j])
-                {
-                    match = false;
-                    break;
-                }
-            }
-            if (match)
-            {
-                foundInPublisher = true;
-                break;
-            }
-        }
-    }
-
-    if (lowerISBN.length() >= lowerKeyword.length())
-    {
-        for (int i = 0; i <= lowerISBN.length() - lowerKeyword.length(); i++)
-        {
-            bool match = true;
-            for (int j = 0; j < lowerKeyword.length(); j++)
-            {
-                if (lowerISBN[i + j] != lowerKeyword[j])
-                {
-                    match = false;
-                    break;
-                }
-            }
-            if (match)
-            {
-                foundInISBN = true;
-                break;
-            }
-        }
-    }
+    return (TextSearch::containsIgnoreCase(publisher.str(), keyword) ||
+            TextSearch::containsIgnoreCase(isbn, keyword));
+}
 
-    return (foundInPublisher || foundInISBN);
+void Book::getSearchFields(vector<const string *> &fields) const
+{
+    Resource::getSearchFields(fields);
+    fields.push_back(&publisher.str());
+    fields.push_back(&isbn);
 }
 
 // Json
@@ -240,8 +179,10 @@ json Book::toJson() const
         {"category", getCategory()},
         {"publicationYear", getPublicationYear()},
         {"isAvailable", getAvailable()},
+        {"copies", getCopies()},
+        {"copiesOnLoan", getCopiesOnLoan()},
         {"numberOfPages", numberOfPages},
-        {"publisher", publisher},
+        {"publisher", publisher.str()},
         {"isbn", isbn},
         {"edition", edition},
         {"type", getType()}};
@@ -262,7 +203,7 @@ Book Book::fromJson(const json &j)
             j.value("isbn", "N/A"),
             j.value("edition", "N/A"));
 
-        book.setAvailable(j.at("isAvailable").get<bool>());
+        book.readHoldings(j);
         return book;
     }
     catch (const json::exception &e)
@@ -8,7 +8,7 @@ class Book : public Resource
 {
 private:
     int numberOfPages;
-    string publisher;
+    Symbol publisher; // interned
     string isbn;
     string edition;
 
@@ -20,6 +20,7 @@ public:
     // Methods
     void displayInfo() const override;
     const string &getType() const override;
+    unique_ptr<Resource> clone() const override;
 
     // Validation methods
     bool isValidPages(int pages) const;
@@ -40,7 +41,8 @@ public:
     string getFormattedInfo() const;
 
     // Override search method for book-specific fields
-    bool matchesKeyword(const string &keyword) const;
+    bool matchesKeyword(const string &keyword) const override;
+    void getSearchFields(vector<const string *> &fields) const override;
 
     // Json
     json toJson() const override;
@@ -1,10 +1,29 @@
 #include "resource.h"
 #include "book.h"
 #include "article.h"
+#include "thesis.h"
+#include "TextSearch/textsearch.h"
 #include <exception>
+#include <memory_resource>
+#include <algorithm>
 
 using namespace std;
 
+namespace
+{
+    // Loads create and teardown destroys resources by the hundred thousand.
+    // The pool serves each size from large chunks, so a bulk load makes a
+    // handful of allocations and a free is a push onto a free list. It is
+    // never destroyed, so resources in static storage can outlive main and
+    // process exit releases the chunks wholesale.
+    pmr::synchronized_pool_resource &resourcePool()
+    {
+        static pmr::synchronized_pool_resource *pool =
+            new pmr::synchronized_pool_resource(pmr::pool_options{0, 1024});
+        return *pool;
+    }
+}
+
 Resource::Resource(const string &title, const string &author, const string &resourceId, const string &category, int publicationYear)
 {
     setTitle(title);
@@ -15,6 +34,35 @@ Resource::Resource(const string &title, const string &author, const string &reso
     setAvailable(true);
 }
 
+Resource::Resource(const Resource &other)
+    : title(other.title), author(other.author), resourceId(other.resourceId), category(other.category),
+      publicationYear(other.publicationYear), copies(other.copies), state(other.state.load())
+{
+}
+
+Resource &Resource::operator=(const Resource &other)
+{
+    title = other.title;
+    author = other.author;
+    resourceId = other.resourceId;
+    category = other.category;
+    publicationYear = other.publicationYear;
+    copies = other.copies;
+    state = other.state.load();
+    return *this;
+}
+
+void *Resource::operator new(size_t size)
+{
+    return resourcePool().allocate(size);
+}
+
+// Virtual destructors pass the size of the most derived type
+void Resource::operator delete(void *ptr, size_t size)
+{
+    resourcePool().deallocate(ptr, size);
+}
+
 // Enhanced validation methods
 bool Resource::isValidResourceId(const string &id) const
 {
@@ -89,15 +137,15 @@ void Resource::setAuthor(const string &author)
 {
     if (!isValidAuthor(author))
     {
-        this->author = "Unknown Author";
+        this->author = StringPool::global().intern("Unknown Author");
         return;
     }
-    this->author = author;
+    this->author = StringPool::global().intern(author);
 }
 
 const string &Resource::getAuthor() const
 {
-    return author;
+    return author.str();
 }
 
 void Resource::setResourceId(const string &resourceId)
@@ -117,12 +165,12 @@ const string &Resource::getResourceId() const
 
 void Resource::setCategory(const string &category)
 {
-    this->category = category.empty() ? "General" : category;
+    this->category = StringPool::global().intern(category.empty() ? "General" : category);
 }
 
 const string &Resource::getCategory() const
 {
-    return category;
+    return category.str();
 }
 
 void Resource::setPublicationYear(int publicationYear)
@@ -144,49 +192,121 @@ int Resource::getPublicationYear() const
 
 void Resource::setAvailable(bool isAvailable)
 {
-    this->isAvailable = isAvailable;
+    setCopiesOnLoan(isAvailable ? 0 : copies);
 }
 
 bool Resource::getAvailable() const
 {
-    return isAvailable;
+    return copiesOnLoanIn(state.load(memory_order_acquire)) < copies;
 }
 
-// Simple helper function to convert string to lowercase
-string Resource::toLower(const string &str) const
+// Only while no checkout can run, e.g. during loading or under an exclusive lock
+void Resource::setCopies(int copies)
+{
+    this->copies = (copies >= 1) ? static_cast<uint32_t>(copies) : 1;
+}
+
+int Resource::getCopies() const
+{
+    return static_cast<int>(copies);
+}
+
+// Keeps the version; used when loading and by code that owns the resource
+void Resource::setCopiesOnLoan(int copiesOnLoan)
 {
-    string result = str;
-    for (int i = 0; i < result.length(); i++)
+    uint64_t onLoan = static_cast<uint64_t>(max(copiesOnLoan, 0));
+    uint64_t current = state.load();
+    while (!state.compare_exchange_weak(current, (current & ~uint64_t(UINT32_MAX)) | onLoan))
     {
-        if (result[i] >= 'A' && result[i] <= 'Z')
-        {
-            result[i] = result[i] + 32;
-        }
     }
-    return result;
+}
+
+int Resource::getCopiesOnLoan() const
+{
+    return static_cast<int>(copiesOnLoanIn(state.load(memory_order_acquire)));
+}
+
+int Resource::getAvailableCopies() const
+{
+    return max(getCopies() - getCopiesOnLoan(), 0);
+}
+
+// "Yes"/"No" for a single copy, otherwise how many copies are on the shelf
+string Resource::describeAvailability() const
+{
+    if (copies == 1)
+        return getAvailable() ? "Yes" : "No";
+    return to_string(getAvailableCopies()) + " of " + to_string(copies) + " copies";
+}
+
+void Resource::readHoldings(const json &j)
+{
+    setCopies(j.value("copies", 1));
+    if (j.contains("copiesOnLoan"))
+        setCopiesOnLoan(j["copiesOnLoan"].get<int>());
+    else
+        setAvailable(j.value("isAvailable", true));
+}
+
+// One more copy on loan and one more in the version, in a single CAS
+bool Resource::checkout(uint64_t &stateWord)
+{
+    uint64_t current = state.load(memory_order_acquire);
+    do
+    {
+        if (copiesOnLoanIn(current) >= copies)
+            return false;
+        stateWord = current + (uint64_t(1) << 32) + 1;
+    } while (!state.compare_exchange_weak(current, stateWord, memory_order_acq_rel, memory_order_acquire));
+    return true;
+}
+
+bool Resource::checkin(uint64_t &stateWord)
+{
+    uint64_t current = state.load(memory_order_acquire);
+    do
+    {
+        if (copiesOnLoanIn(current) == 0)
+            return false;
+        stateWord = current + (uint64_t(1) << 32) - 1;
+    } while (!state.compare_exchange_weak(current, stateWord, memory_order_acq_rel, memory_order_acquire));
+    return true;
+}
+
+uint64_t Resource::getStateWord() const
+{
+    return state.load(memory_order_acquire);
+}
+
+uint32_t Resource::copiesOnLoanIn(uint64_t stateWord)
+{
+    return static_cast<uint32_t>(stateWord);
+}
+
+bool Resource::applyStateWord(uint64_t stateWord)
+{
+    uint64_t current = state.load();
+    do
+    {
+        if ((stateWord >> 32) <= (current >> 32))
+            return false;
+    } while (!state.compare_exchange_weak(current, stateWord));
+    return true;
+}
+
+// Simple helper function to convert string to lowercase
+string Resource::toLower(const string &str) const
+{
+    return TextSearch::toLower(str);
 }
 
 // Simple helper function to check if string contains substring
 bool Resource::contains(const string &str, const string &substr) const
 {
-    if (substr.empty() || str.empty())
+    if (substr.empty() || str.empty() || substr.length() > str.length())
         return false;
 
-    for (int i = 0; i <= str.length() - substr.length(); i++)
-    {
-        bool found = true;
-        for (int j = 0; j < substr.length(); j++)
-        {
-            if (str[i + j] != substr[j])
-            {
-                found = false;
-                break;
-            }
-        }
-        if (found)
-            return true;
-    }
-    return false;
+    return str.find(substr) != string::npos;
 }
 
 // Search and comparison methods
@@ -195,14 +315,17 @@ bool Resource::matchesKeyword(const string &keyword) const
     if (keyword.empty())
         return false;
 
-    string lowerKeyword = toLower(keyword);
-    string lowerTitle = toLower(title);
-    string lowerAuthor = toLower(author);
-    string lowerCategory = toLower(category);
+    return (TextSearch::containsIgnoreCase(title, keyword) ||
+            TextSearch::containsIgnoreCase(author.str(), keyword) ||
+            TextSearch::containsIgnoreCase(category.str(), keyword));
+}
 
-    return (contains(lowerTitle, lowerKeyword) ||
-            contains(lowerAuthor, lowerKeyword) ||
-            contains(lowerCategory, lowerKeyword));
+// Fields covered by matchesKeyword, used to build the search indexes
+void Resource::getSearchFields(vector<const string *> &fields) const
+{
+    fields.push_back(&title);
+    fields.push_back(&author.str());
+    fields.push_back(&category.str());
 }
 
 bool Resource::matchesCategory(const string &cat) const
@@ -210,10 +333,7 @@ bool Resource::matchesCategory(const string &cat) const
     if (cat.empty())
         return true;
 
-    string lowerCat = toLower(cat);
-    string lowerCategory = toLower(category);
-
-    return contains(lowerCategory, lowerCat);
+    return TextSearch::containsIgnoreCase(category.str(), cat);
 }
 
 bool Resource::matchesAuthor(const string &auth) const
@@ -221,10 +341,18 @@ bool Resource::matchesAuthor(const string &auth) const
     if (auth.empty())
         return true;
 
-    string lowerAuth = toLower(auth);
-    string lowerAuthor = toLower(author);
+    return TextSearch::containsIgnoreCase(author.str(), auth);
+}
+
+// Callers filtering many resources intern the query once and use these
+bool Resource::matchesCategory(const Symbol &cat) const
+{
+    return category.equalsIgnoreCase(cat);
+}
 
-    return contains(lowerAuthor, lowerAuth);
+bool Resource::matchesAuthor(const Symbol &auth) const
+{
+    return author.equalsIgnoreCase(auth);
 }
 
 // Operator overloading
@@ -239,6 +367,21 @@ bool Resource::operator!=(const Resource &other) const
 }
 
 // Json
+// Common fields, extended by the derived toJson implementations
+json Resource::toJson() const
+{
+    return json{
+        {"title", title},
+        {"author", author.str()},
+        {"resourceId", resourceId},
+        {"category", category.str()},
+        {"publicationYear", publicationYear},
+        {"isAvailable", getAvailable()},
+        {"copies", getCopies()},
+        {"copiesOnLoan", getCopiesOnLoan()},
+        {"type", getType()}};
+}
+
 unique_ptr<Resource> Resource::fromJson(const json &j)
 {
     try
@@ -251,6 +394,9 @@ unique_ptr<Resource> Resource::fromJson(const json &j)
         if (resourceType == "Article")
             return make_unique<Article>(Article::fromJson(j));
 
+        if (resourceType == "Thesis")
+            return make_unique<Thesis>(Thesis::fromJson(j));
+
         throw runtime_error("Error: Unknown resource type '" + resourceType + "'");
     }
     catch (const json::exception &e)
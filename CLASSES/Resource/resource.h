@@ -1,9 +1,13 @@
 #ifndef RESOURCE_H
 #define RESOURCE_H
 #include <string>
+#include <vector>
 #include <memory>
 #include <stdexcept>
+#include <atomic>
+#include <cstdint>
 #include "Json/json.hpp"
+#include "Registry/stringpool.h"
 using json = nlohmann::json;
 using namespace std;
 
@@ -11,20 +15,30 @@ class Resource
 {
 private:
     string title;
-    string author;
+    Symbol author;   // interned, shared by every resource with the same value
     string resourceId;
-    string category;
+    Symbol category; // interned
     int publicationYear;
-    bool isAvailable;
+    // Holdings: the low half of the state word counts copies on loan, the
+    // high half counts checkouts and checkins so a logged word can be ordered
+    uint32_t copies = 1;
+    atomic<uint64_t> state{0};
 
 public:
     // Constructor
     Resource(const string & = "", const string & = "", const string & = "", const string & = "", int = -1);
+    Resource(const Resource &other);
+    Resource &operator=(const Resource &other);
     virtual ~Resource() = default;
 
+    // Resources are carved out of a shared pool instead of one heap block each
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+
     // Methods
     virtual void displayInfo() const = 0;
     virtual const string &getType() const = 0;
+    virtual unique_ptr<Resource> clone() const = 0;
 
     // Validation methods
     bool isValidResourceId(const string &id) const;
@@ -43,17 +57,42 @@ public:
     const string &getCategory() const;
     void setPublicationYear(int = 0);
     int getPublicationYear() const;
+    // Available while at least one copy is on the shelf. setAvailable puts
+    // every copy on the shelf or every copy on loan.
     void setAvailable(bool = true);
     bool getAvailable() const;
+    void setCopies(int = 1);
+    int getCopies() const;
+    void setCopiesOnLoan(int = 0);
+    int getCopiesOnLoan() const;
+    int getAvailableCopies() const;
+    string describeAvailability() const;
+    // Reads copies and copiesOnLoan, or isAvailable from older files
+    void readHoldings(const json &j);
+
+    // Lock-free loan protocol. checkout takes one copy and fails when none
+    // is left, so of several concurrent callers only as many succeed as
+    // there were copies; checkin puts one back. Both report the state word
+    // they installed.
+    bool checkout(uint64_t &stateWord);
+    bool checkin(uint64_t &stateWord);
+    uint64_t getStateWord() const;
+    static uint32_t copiesOnLoanIn(uint64_t stateWord);
+    // Installs a logged state word unless a newer one is already in place
+    bool applyStateWord(uint64_t stateWord);
 
     // Helper methods
     string toLower(const string &str) const;
     bool contains(const string &str, const string &substr) const;
 
     // Search and comparison methods
-    bool matchesKeyword(const string &keyword) const;
+    virtual bool matchesKeyword(const string &keyword) const;
+    virtual void getSearchFields(vector<const string *> &fields) const;
     bool matchesCategory(const string &cat) const;
     bool matchesAuthor(const string &auth) const;
+    // Whole-value, case-insensitive matches; these are pointer compares
+    bool matchesCategory(const Symbol &cat) const;
+    bool matchesAuthor(const Symbol &auth) const;
 
     // Operator overloading for comparison
     bool operator==(const Resource &other) const;
@@ -1,4 +1,5 @@
 #include "thesis.h"
+#include "TextSearch/textsearch.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
@@ -9,7 +10,7 @@ Thesis::Thesis(const string &title, const string &author, const string &resource
                const string &department, const string &supervisor, ThesisType type,
                const string &degree, int pages, const string &abstractText)
     : Resource(title, author, resourceId, category, publicationYear),
-      university(university), department(department), supervisor(supervisor),
+      university(StringPool::global().intern(university)), department(StringPool::global().intern(department)), supervisor(supervisor),
       thesisType(type), degree(degree), pageCount(pages), abstractText(abstractText)
 {
     // Validation is handled by setters in Resource base class
@@ -22,14 +23,14 @@ void Thesis::displayInfo() const
     cout << "Title: " << getTitle() << endl;
     cout << "Author: " << getAuthor() << endl;
     cout << "Resource ID: " << getResourceId() << endl;
-    cout << "University: " << university << endl;
-    cout << "Department: " << department << endl;
+    cout << "University: " << university.str() << endl;
+    cout << "Department: " << department.str() << endl;
     cout << "Supervisor: " << supervisor << endl;
     cout << "Type: " << getThesisTypeString() << endl;
     cout << "Degree: " << degree << endl;
     cout << "Publication Year: " << getPublicationYear() << endl;
     cout << "Pages: " << pageCount << endl;
-    cout << "Available: " << (getAvailable() ? "Yes" : "No") << endl;
+    cout << "Available: " << describeAvailability() << endl;
     if (hasAbstract())
     {
         cout << "Abstract: " << abstractText.substr(0, 100) << "..." << endl;
@@ -38,6 +39,11 @@ void Thesis::displayInfo() const
 }
 
 // Get resource type
+unique_ptr<Resource> Thesis::clone() const
+{
+    return make_unique<Thesis>(*this);
+}
+
 const string &Thesis::getType() const
 {
     static const string type = "Thesis";
@@ -70,7 +76,7 @@ void Thesis::setUniversity(const string &university)
 {
     if (isValidUniversity(university))
     {
-        this->university = university;
+        this->university = StringPool::global().intern(university);
     }
     else
     {
@@ -80,14 +86,14 @@ void Thesis::setUniversity(const string &university)
 
 const string &Thesis::getUniversity() const
 {
-    return university;
+    return university.str();
 }
 
 void Thesis::setDepartment(const string &department)
 {
     if (isValidDepartment(department))
     {
-        this->department = department;
+        this->department = StringPool::global().intern(department);
     }
     else
     {
@@ -97,7 +103,7 @@ void Thesis::setDepartment(const string &department)
 
 const string &Thesis::getDepartment() const
 {
-    return department;
+    return department.str();
 }
 
 void Thesis::setSupervisor(const string &supervisor)
@@ -186,7 +192,7 @@ string Thesis::getFormattedInfo() const
 {
     stringstream ss;
     ss << getTitle() << " by " << getAuthor()
-       << " (" << getThesisTypeString() << ", " << university << ")";
+       << " (" << getThesisTypeString() << ", " << university.str() << ")";
     return ss.str();
 }
 
@@ -203,21 +209,29 @@ bool Thesis::matchesKeyword(const string &keyword) const
         return true;
     }
 
-    string lowerKeyword = toLower(keyword);
+    return TextSearch::containsIgnoreCase(university.str(), keyword) ||
+           TextSearch::containsIgnoreCase(department.str(), keyword) ||
+           TextSearch::containsIgnoreCase(supervisor, keyword) ||
+           TextSearch::containsIgnoreCase(degree, keyword) ||
+           TextSearch::containsIgnoreCase(abstractText, keyword);
+}
 
-    return contains(toLower(university), lowerKeyword) ||
-           contains(toLower(department), lowerKeyword) ||
-           contains(toLower(supervisor), lowerKeyword) ||
-           contains(toLower(degree), lowerKeyword) ||
-           contains(toLower(abstractText), lowerKeyword);
+void Thesis::getSearchFields(vector<const string *> &fields) const
+{
+    Resource::getSearchFields(fields);
+    fields.push_back(&university.str());
+    fields.push_back(&department.str());
+    fields.push_back(&supervisor);
+    fields.push_back(&degree);
+    fields.push_back(&abstractText);
 }
 
 // JSON serialization
 json Thesis::toJson() const
 {
     json j = Resource::toJson();
-    j["university"] = university;
-    j["department"] = department;
+    j["university"] = university.str();
+    j["department"] = department.str();
     j["supervisor"] = supervisor;
     j["thesisType"] = static_cast<int>(thesisType);
     j["degree"] = degree;
@@ -235,7 +249,7 @@ Thesis Thesis::fromJson(const json &j)
     thesis.setResourceId(j.value("resourceId", ""));
     thesis.setCategory(j.value("category", ""));
     thesis.setPublicationYear(j.value("publicationYear", 0));
-    thesis.setAvailable(j.value("isAvailable", true));
+    thesis.readHoldings(j);
 
     thesis.setUniversity(j.value("university", ""));
     thesis.setDepartment(j.value("department", ""));
@@ -14,8 +14,8 @@ enum class ThesisType
 class Thesis : public Resource
 {
 private:
-    string university;
-    string department;
+    Symbol university; // interned
+    Symbol department; // interned
     string supervisor;
     ThesisType thesisType;
     string degree;
@@ -33,6 +33,7 @@ public:
     // Methods
     void displayInfo() const override;
     const string &getType() const override;
+    unique_ptr<Resource> clone() const override;
 
     // Validation methods
     bool isValidUniversity(const string &uni) const;
@@ -62,7 +63,8 @@ public:
     bool hasAbstract() const;
 
     // Override search method for thesis-specific fields
-    bool matchesKeyword(const string &keyword) const;
+    bool matchesKeyword(const string &keyword) const override;
+    void getSearchFields(vector<const string *> &fields) const override;
 
     // Json
     json toJson() const override;
@@ -0,0 +1,316 @@
+// Load generator for the library server. Each connection registers a user
+// and keeps a fixed number of requests in flight for the given time: reads
+// (user lookups, loan lists, searches) mixed with borrows and returns of
+// random resources. Reports throughput and latency percentiles.
+// The users and loans it creates are saved like any others, so point it
+// only at a server running on a scratch copy of the data file:
+//   cp library_data.json loadtest.json && library_server loadtest.json
+// usage: library_loadgen [--socket PATH | --port N] [--connections N] [--depth N]
+//                        [--seconds N] [--writes PERCENT]
+#include "rpcclient.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <sstream>
+
+using namespace std::chrono;
+using Protocol::FrameWriter;
+using Protocol::Op;
+
+namespace
+{
+    struct LoadOptions
+    {
+        string socketPath = "library.sock";
+        int tcpPort = 0;
+        int connections = 4;
+        int depth = 8; // requests in flight per connection
+        int seconds = 10;
+        int writePercent = 20;
+    };
+
+    struct WorkerStats
+    {
+        vector<uint32_t> latencies; // microseconds
+        size_t ok = 0;
+        size_t refused = 0; // the service said no, e.g. the resource is on loan
+        size_t errors = 0;  // protocol or transport failures
+        bool failed = false;
+    };
+
+    struct Pending
+    {
+        steady_clock::time_point sentAt;
+        Op op;
+        string resourceId;
+    };
+
+    bool connectClient(RpcClient &client, const LoadOptions &options)
+    {
+        return options.tcpPort > 0 ? client.connectTcp(options.tcpPort) : client.connectUnix(options.socketPath);
+    }
+
+    // Resource IDs and search words taken from the catalog
+    bool loadCatalog(RpcClient &client, vector<string> &resourceIds, vector<string> &keywords)
+    {
+        unordered_set<string> seen;
+        uint32_t offset = 0;
+        while (true)
+        {
+            RpcResponse response;
+            if (!client.call(Op::ListResources, [offset](FrameWriter &out)
+                             { out.putU32(offset); out.putU32(Protocol::MAX_LIST_ENTRIES); },
+                             response) ||
+                !response.ok())
+                return false;
+
+            Protocol::FrameReader in = response.fields();
+            uint32_t total = in.getU32();
+            uint32_t count = in.getU32();
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                resourceIds.push_back(in.getString());
+                istringstream title(in.getString());
+                in.getU32();
+                in.getU32();
+                string word;
+                while (title >> word)
+                {
+                    transform(word.begin(), word.end(), word.begin(), ::tolower);
+                    if (word.size() >= 3 && seen.insert(word).second)
+                        keywords.push_back(word);
+                }
+            }
+            offset += count;
+            if (!in.ok() || count == 0 || offset >= total)
+                return in.ok();
+        }
+    }
+
+    void runConnection(const LoadOptions &options, int index, const vector<string> &resourceIds,
+                       const vector<string> &keywords, steady_clock::time_point deadline, WorkerStats &stats)
+    {
+        RpcClient client;
+        RpcResponse response;
+        string userId;
+        if (!connectClient(client, options) ||
+            !client.call(Op::RegisterUser, [index](FrameWriter &out)
+                         {
+                             out.putString("Load Tester");
+                             out.putString("loadgen" + to_string(index) + "@example.com");
+                             out.putU8(0); },
+                         response) ||
+            !response.ok())
+        {
+            stats.failed = true;
+            return;
+        }
+        userId = response.fields().getString();
+
+        mt19937 rng(static_cast<unsigned>(index) * 7919u + 1);
+        unordered_map<uint32_t, Pending> pending;
+        unordered_set<string> held;     // resources this user has borrowed
+        unordered_set<string> changing; // resources with a borrow or return in flight; workers may reorder those
+
+        auto sendOne = [&]()
+        {
+            Pending request{steady_clock::now(), Op::Ping, string()};
+            uint32_t requestId;
+            if (static_cast<int>(rng() % 100) < options.writePercent)
+                request.resourceId = resourceIds[rng() % resourceIds.size()];
+            if (!request.resourceId.empty() && changing.insert(request.resourceId).second)
+            {
+                request.op = held.count(request.resourceId) ? Op::Return : Op::Borrow;
+                requestId = client.queue(request.op, [&](FrameWriter &out)
+                                         {
+                                             out.putString(userId);
+                                             out.putString(request.resourceId); });
+            }
+            else
+            {
+                request.resourceId.clear();
+                switch (rng() % 3)
+                {
+                case 0:
+                    request.op = Op::GetUser;
+                    requestId = client.queue(request.op, [&](FrameWriter &out)
+                                             { out.putString(userId); });
+                    break;
+                case 1:
+                    request.op = Op::ActiveLoans;
+                    requestId = client.queue(request.op, [&](FrameWriter &out)
+                                             { out.putString(userId); });
+                    break;
+                default:
+                    request.op = Op::Search;
+                    requestId = client.queue(request.op, [&](FrameWriter &out)
+                                             {
+                                                 out.putString(keywords.empty() ? string("the") : keywords[rng() % keywords.size()]);
+                                                 out.putU32(10); });
+                    break;
+                }
+            }
+            pending.emplace(requestId, std::move(request));
+        };
+
+        for (int i = 0; i < options.depth; ++i)
+            sendOne();
+
+        while (!pending.empty())
+        {
+            if (!client.receive(response))
+            {
+                stats.errors += pending.size();
+                stats.failed = true;
+                return;
+            }
+            auto found = pending.find(response.requestId);
+            if (found == pending.end())
+            {
+                ++stats.errors;
+                continue;
+            }
+            auto now = steady_clock::now();
+            stats.latencies.push_back(static_cast<uint32_t>(duration_cast<microseconds>(now - found->second.sentAt).count()));
+            if (response.ok())
+                ++stats.ok;
+            else if (response.status >= Protocol::MALFORMED_REQUEST)
+                ++stats.errors;
+            else
+                ++stats.refused;
+            const Pending &answered = found->second;
+            if (answered.op == Op::Borrow || answered.op == Op::Return)
+            {
+                changing.erase(answered.resourceId);
+                if (answered.op == Op::Borrow && response.ok())
+                    held.insert(answered.resourceId);
+                if (answered.op == Op::Return && response.ok())
+                    held.erase(answered.resourceId);
+            }
+            pending.erase(found);
+
+            if (now < deadline)
+                sendOne();
+        }
+
+        // Give back what this user still has so repeated runs start alike
+        for (const auto &resourceId : held)
+        {
+            client.queue(Op::Return, [&](FrameWriter &out)
+                         {
+                             out.putString(userId);
+                             out.putString(resourceId); });
+        }
+        for (size_t i = 0; i < held.size() && client.receive(response); ++i)
+        {
+        }
+    }
+
+    uint32_t percentile(const vector<uint32_t> &sorted, double fraction)
+    {
+        if (sorted.empty())
+            return 0;
+        size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+        return sorted[min(index, sorted.size() - 1)];
+    }
+
+    void printUsage(const char *program)
+    {
+        cerr << "usage: " << program << " [--socket PATH | --port N] [--connections N] [--depth N]"
+             << " [--seconds N] [--writes PERCENT]" << endl
+             << "Registers users and makes loans; run the server on a scratch data file." << endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            printUsage(argv[0]);
+            return 2;
+        }
+        if (arg == "--socket")
+            options.socketPath = argv[++i];
+        else if (arg == "--port")
+            options.tcpPort = atoi(argv[++i]);
+        else if (arg == "--connections")
+            options.connections = max(atoi(argv[++i]), 1);
+        else if (arg == "--depth")
+            options.depth = max(atoi(argv[++i]), 1);
+        else if (arg == "--seconds")
+            options.seconds = max(atoi(argv[++i]), 1);
+        else if (arg == "--writes")
+            options.writePercent = min(max(atoi(argv[++i]), 0), 100);
+        else
+        {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    vector<string> resourceIds;
+    vector<string> keywords;
+    {
+        RpcClient client;
+        if (!connectClient(client, options))
+            return 1;
+        if (!loadCatalog(client, resourceIds, keywords))
+        {
+            cerr << "Error: Failed to list resources" << endl;
+            return 1;
+        }
+    }
+    if (resourceIds.empty())
+    {
+        cerr << "Error: The catalog is empty; add resources before running the load generator" << endl;
+        return 1;
+    }
+
+    cout << options.connections << " connection(s), " << options.depth << " in flight each, "
+         << options.writePercent << "% borrows/returns over " << resourceIds.size() << " resources, "
+         << options.seconds << "s" << endl;
+
+    vector<WorkerStats> stats(options.connections);
+    vector<thread> workers;
+    auto start = steady_clock::now();
+    auto deadline = start + seconds(options.seconds);
+    for (int i = 0; i < options.connections; ++i)
+        workers.emplace_back(runConnection, cref(options), i, cref(resourceIds), cref(keywords), deadline, ref(stats[i]));
+    for (auto &worker : workers)
+        worker.join();
+    double elapsed = duration<double>(steady_clock::now() - start).count();
+
+    vector<uint32_t> latencies;
+    size_t ok = 0, refused = 0, errors = 0, failedConnections = 0;
+    for (auto &s : stats)
+    {
+        latencies.insert(latencies.end(), s.latencies.begin(), s.latencies.end());
+        ok += s.ok;
+        refused += s.refused;
+        errors += s.errors;
+        failedConnections += s.failed ? 1 : 0;
+    }
+    sort(latencies.begin(), latencies.end());
+
+    cout << fixed << setprecision(0);
+    cout << "requests:  " << latencies.size() << " (" << ok << " ok, " << refused << " refused, " << errors << " errors)\n";
+    cout << "rate:      " << latencies.size() / elapsed << " req/s\n";
+    cout << "latency:   p50 " << percentile(latencies, 0.50) << "us  p90 " << percentile(latencies, 0.90)
+         << "us  p99 " << percentile(latencies, 0.99) << "us  p99.9 " << percentile(latencies, 0.999)
+         << "us  max " << (latencies.empty() ? 0 : latencies.back()) << "us" << endl;
+    if (failedConnections > 0)
+    {
+        cerr << "Error: " << failedConnections << " connection(s) failed" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include "protocol.h"
+#include <algorithm>
+
+namespace Protocol
+{
+    FrameWriter::FrameWriter(vector<uint8_t> &out, uint32_t requestId, uint8_t code) : out(out), start(out.size())
+    {
+        putU32(0);
+        putU32(requestId);
+        putU8(code);
+    }
+
+    void FrameWriter::putU8(uint8_t value)
+    {
+        out.push_back(value);
+    }
+
+    void FrameWriter::putU32(uint32_t value)
+    {
+        for (int shift = 0; shift < 32; shift += 8)
+            out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+
+    void FrameWriter::putU64(uint64_t value)
+    {
+        for (int shift = 0; shift < 64; shift += 8)
+            out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+
+    void FrameWriter::putString(const string &value)
+    {
+        size_t length = min<size_t>(value.size(), UINT16_MAX);
+        out.push_back(static_cast<uint8_t>(length));
+        out.push_back(static_cast<uint8_t>(length >> 8));
+        out.insert(out.end(), value.begin(), value.begin() + length);
+    }
+
+    void FrameWriter::setCode(uint8_t code)
+    {
+        out[start + 8] = code;
+    }
+
+    void FrameWriter::clearFields()
+    {
+        out.resize(start + HEADER_SIZE);
+    }
+
+    void FrameWriter::finish()
+    {
+        uint32_t length = static_cast<uint32_t>(out.size() - start - 4);
+        for (int i = 0; i < 4; ++i)
+            out[start + i] = static_cast<uint8_t>(length >> (8 * i));
+    }
+
+    FrameReader::FrameReader(const uint8_t *data, size_t size) : pos(data), end(data + size), failed(false)
+    {
+    }
+
+    uint8_t FrameReader::getU8()
+    {
+        if (failed || end - pos < 1)
+        {
+            failed = true;
+            return 0;
+        }
+        return *pos++;
+    }
+
+    uint32_t FrameReader::getU32()
+    {
+        if (failed || end - pos < 4)
+        {
+            failed = true;
+            return 0;
+        }
+        uint32_t value = readU32(pos);
+        pos += 4;
+        return value;
+    }
+
+    uint64_t FrameReader::getU64()
+    {
+        if (failed || end - pos < 8)
+        {
+            failed = true;
+            return 0;
+        }
+        uint64_t value = readU32(pos) | (static_cast<uint64_t>(readU32(pos + 4)) << 32);
+        pos += 8;
+        return value;
+    }
+
+    string FrameReader::getString()
+    {
+        if (failed || end - pos < 2)
+        {
+            failed = true;
+            return string();
+        }
+        size_t length = pos[0] | (pos[1] << 8);
+        if (static_cast<size_t>(end - pos - 2) < length)
+        {
+            failed = true;
+            return string();
+        }
+        string value(reinterpret_cast<const char *>(pos + 2), length);
+        pos += 2 + length;
+        return value;
+    }
+
+    bool FrameReader::ok() const
+    {
+        return !failed;
+    }
+
+    bool FrameReader::atEnd() const
+    {
+        return pos == end;
+    }
+
+    bool frameSize(const uint8_t *buf, size_t size, uint32_t &total)
+    {
+        if (size < 4)
+            return false;
+        total = static_cast<uint32_t>(min<uint64_t>(uint64_t(readU32(buf)) + 4, UINT32_MAX));
+        return true;
+    }
+
+    uint32_t readU32(const uint8_t *in)
+    {
+        return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8) |
+               (static_cast<uint32_t>(in[2]) << 16) | (static_cast<uint32_t>(in[3]) << 24);
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+using namespace std;
+
+// Binary protocol spoken by the library server.
+// Every message is a frame: [length:u32][requestId:u32][code:u8][fields],
+// where length counts everything after itself. In a request the code is the
+// operation, in a response it is the status. Integers are little-endian and
+// strings are [length:u16][bytes]. Clients may send several requests without
+// waiting (pipelining); responses carry the requestId they answer and can
+// arrive in any order.
+namespace Protocol
+{
+    enum class Op : uint8_t
+    {
+        Ping = 0,                  // -> nothing
+        RegisterUser = 1,          // name, email, role:u8 (Student or Teacher) -> userId
+        GetUser = 2,               // userId -> name, email, role:u8
+        Borrow = 3,                // userId, resourceId -> loanId, copy:u32, dueDate:u64
+        Return = 4,                // userId, resourceId -> loanId, copy:u32
+        Renew = 5,                 // userId, resourceId -> loanId, copy:u32, dueDate:u64, renewals:u32
+        Search = 6,                // keyword, limit:u32 -> total:u32, count:u32, count x (resourceId, title, available:u32, copies:u32)
+        ActiveLoans = 7,           // userId -> count:u32, count x (loanId, resourceId, copy:u32, dueDate:u64)
+        Reserve = 8,               // userId, resourceId -> reservationId
+        CancelReservation = 9,     // userId, reservationId -> reservationId
+        Notifications = 10,        // userId -> count:u32, count x (notificationId, message, read:u8)
+        MarkNotificationRead = 11, // userId, notificationId -> notificationId
+        ListResources = 12         // offset:u32, limit:u32 -> same as Search
+    };
+
+    // Response codes below 0xF0 are ServiceStatus values
+    const uint8_t MALFORMED_REQUEST = 0xF0;
+    const uint8_t UNKNOWN_OPERATION = 0xF1;
+    const uint8_t INTERNAL_ERROR = 0xF2;
+
+    const size_t HEADER_SIZE = 9;              // length, requestId, code
+    const uint32_t MAX_REQUEST_SIZE = 64 * 1024;
+    const uint32_t MAX_RESPONSE_SIZE = 16 * 1024 * 1024;
+    const uint32_t MAX_LIST_ENTRIES = 1000;    // larger Search/ListResources limits are clamped
+
+    // Appends one frame to a buffer; the length is filled in by finish()
+    class FrameWriter
+    {
+    private:
+        vector<uint8_t> &out;
+        size_t start;
+
+    public:
+        FrameWriter(vector<uint8_t> &out, uint32_t requestId, uint8_t code);
+
+        void putU8(uint8_t value);
+        void putU32(uint32_t value);
+        void putU64(uint64_t value);
+        void putString(const string &value); // truncated to 65535 bytes
+        void setCode(uint8_t code);
+        void clearFields(); // drops everything after the header
+        void finish();
+    };
+
+    // Reads the fields of one frame. A read past the end sets the failed
+    // flag and returns zero or an empty string, so a handler can read every
+    // field and check ok() once.
+    class FrameReader
+    {
+    private:
+        const uint8_t *pos;
+        const uint8_t *end;
+        bool failed;
+
+    public:
+        FrameReader(const uint8_t *data, size_t size);
+
+        uint8_t getU8();
+        uint32_t getU32();
+        uint64_t getU64();
+        string getString();
+        bool ok() const;     // no read failed
+        bool atEnd() const;  // every byte was consumed
+    };
+
+    // Size of the frame at the start of buf, length prefix included, once
+    // the prefix has arrived. The caller checks it against its limits before
+    // waiting for the rest, then reads requestId and code with a FrameReader
+    // over the bytes after the prefix.
+    bool frameSize(const uint8_t *buf, size_t size, uint32_t &total);
+
+    uint32_t readU32(const uint8_t *in);
+}
+
+#endif
@@ -0,0 +1,171 @@
+#include "rpcclient.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+bool RpcResponse::ok() const
+{
+    return status == 0;
+}
+
+Protocol::FrameReader RpcResponse::fields() const
+{
+    return Protocol::FrameReader(body.data(), body.size());
+}
+
+RpcClient::RpcClient() : fd(-1), nextRequestId(1), inputOffset(0)
+{
+}
+
+RpcClient::~RpcClient()
+{
+    close();
+}
+
+bool RpcClient::connectUnix(const string &path)
+{
+    close();
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+    {
+        cerr << "Error: Invalid socket path: " << path << endl;
+        return false;
+    }
+    strcpy(address.sun_path, path.c_str());
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        cerr << "Error: Failed to connect to " << path << ": " << strerror(errno) << endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool RpcClient::connectTcp(int port)
+{
+    close();
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        cerr << "Error: Failed to connect to 127.0.0.1:" << port << ": " << strerror(errno) << endl;
+        close();
+        return false;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return true;
+}
+
+void RpcClient::close()
+{
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+    output.clear();
+    input.clear();
+    inputOffset = 0;
+}
+
+bool RpcClient::isConnected() const
+{
+    return fd >= 0;
+}
+
+uint32_t RpcClient::queue(Protocol::Op op, const function<void(Protocol::FrameWriter &)> &fields)
+{
+    uint32_t requestId = nextRequestId++;
+    Protocol::FrameWriter writer(output, requestId, static_cast<uint8_t>(op));
+    if (fields)
+        fields(writer);
+    writer.finish();
+    return requestId;
+}
+
+bool RpcClient::flush()
+{
+    size_t sent = 0;
+    while (sent < output.size())
+    {
+        ssize_t written = send(fd, output.data() + sent, output.size() - sent, MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            cerr << "Error: Failed to send request: " << strerror(errno) << endl;
+            return false;
+        }
+        sent += written;
+    }
+    output.clear();
+    return true;
+}
+
+bool RpcClient::receive(RpcResponse &response)
+{
+    if (fd < 0 || !flush())
+        return false;
+
+    while (true)
+    {
+        const uint8_t *data = input.data() + inputOffset;
+        size_t available = input.size() - inputOffset;
+        uint32_t total;
+        if (Protocol::frameSize(data, available, total))
+        {
+            if (total < Protocol::HEADER_SIZE || total > Protocol::MAX_RESPONSE_SIZE + 4)
+            {
+                cerr << "Error: Malformed response from server" << endl;
+                return false;
+            }
+            if (available >= total)
+            {
+                response.requestId = Protocol::readU32(data + 4);
+                response.status = data[8];
+                response.body.assign(data + Protocol::HEADER_SIZE, data + total);
+                inputOffset += total;
+                if (inputOffset == input.size())
+                {
+                    input.clear();
+                    inputOffset = 0;
+                }
+                return true;
+            }
+        }
+
+        if (inputOffset > 0)
+        {
+            input.erase(input.begin(), input.begin() + inputOffset);
+            inputOffset = 0;
+        }
+        uint8_t buffer[64 * 1024];
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+        {
+            if (received < 0)
+                cerr << "Error: Failed to read response: " << strerror(errno) << endl;
+            return false;
+        }
+        input.insert(input.end(), buffer, buffer + received);
+    }
+}
+
+bool RpcClient::call(Protocol::Op op, const function<void(Protocol::FrameWriter &)> &fields, RpcResponse &response)
+{
+    uint32_t requestId = queue(op, fields);
+    return receive(response) && response.requestId == requestId;
+}
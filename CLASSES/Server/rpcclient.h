@@ -0,0 +1,56 @@
+#ifndef RPCCLIENT_H
+#define RPCCLIENT_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "protocol.h"
+using namespace std;
+
+struct RpcResponse
+{
+    uint32_t requestId = 0;
+    uint8_t status = 0;  // ServiceStatus value or a Protocol error code
+    vector<uint8_t> body; // reply fields, read with fields()
+
+    bool ok() const;
+    Protocol::FrameReader fields() const;
+};
+
+// Blocking client for the library server. Requests are queued and sent
+// together on the next flush() or receive(), so a caller can keep several
+// in flight and match the answers by requestId.
+class RpcClient
+{
+private:
+    int fd;
+    uint32_t nextRequestId;
+    vector<uint8_t> output;
+    vector<uint8_t> input;
+    size_t inputOffset;
+
+public:
+    // Constructor/Destructor
+    RpcClient();
+    ~RpcClient();
+
+    RpcClient(const RpcClient &) = delete;
+    RpcClient &operator=(const RpcClient &) = delete;
+
+    bool connectUnix(const string &path);
+    bool connectTcp(int port); // 127.0.0.1
+    void close();
+    bool isConnected() const;
+
+    // Queues a request and returns its requestId; fields writes the arguments
+    uint32_t queue(Protocol::Op op, const function<void(Protocol::FrameWriter &)> &fields);
+    bool flush();
+    // Sends anything queued, then waits for the next response
+    bool receive(RpcResponse &response);
+
+    // queue + receive for callers that do not pipeline
+    bool call(Protocol::Op op, const function<void(Protocol::FrameWriter &)> &fields, RpcResponse &response);
+};
+
+#endif
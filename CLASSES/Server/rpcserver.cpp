@@ -0,0 +1,720 @@
+#include "rpcserver.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+using Protocol::FrameReader;
+using Protocol::FrameWriter;
+using Protocol::Op;
+
+namespace
+{
+    bool fail(const string &what)
+    {
+        cerr << "Error: " << what << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    void signalEventFd(int fd)
+    {
+        uint64_t one = 1;
+        while (write(fd, &one, sizeof(one)) < 0 && errno == EINTR)
+        {
+        }
+    }
+
+    struct ResourceEntry
+    {
+        string resourceId;
+        string title;
+        uint32_t available;
+        uint32_t copies;
+    };
+
+    ResourceEntry describe(const Resource &resource)
+    {
+        return ResourceEntry{resource.getResourceId(), resource.getTitle(),
+                             static_cast<uint32_t>(resource.getAvailableCopies()),
+                             static_cast<uint32_t>(resource.getCopies())};
+    }
+
+    void putResources(FrameWriter &out, size_t total, const vector<ResourceEntry> &entries)
+    {
+        out.putU32(static_cast<uint32_t>(total));
+        out.putU32(static_cast<uint32_t>(entries.size()));
+        for (const auto &entry : entries)
+        {
+            out.putString(entry.resourceId);
+            out.putString(entry.title);
+            out.putU32(entry.available);
+            out.putU32(entry.copies);
+        }
+    }
+
+    uint8_t code(ServiceStatus status)
+    {
+        return static_cast<uint8_t>(status);
+    }
+}
+
+RpcServer::RpcServer(LibraryService &service, const ServerOptions &options)
+    : service(service), options(options), listenFd(-1), epollFd(-1), wakeFd(-1), ownsSocketFile(false),
+      stopping(false), nextConnectionId(WAKE_ID + 1), inFlight(0), readBuffer(READ_CHUNK)
+{
+    this->options.maxInFlight = max<size_t>(this->options.maxInFlight, 1);
+}
+
+RpcServer::~RpcServer()
+{
+    // Workers post completions to wakeFd, so they go first
+    pool.reset();
+    for (auto &entry : connections)
+        close(entry.second->fd);
+    if (listenFd >= 0)
+        close(listenFd);
+    if (epollFd >= 0)
+        close(epollFd);
+    if (wakeFd >= 0)
+        close(wakeFd);
+    if (ownsSocketFile)
+        unlink(options.socketPath.c_str());
+}
+
+bool RpcServer::openListener()
+{
+    if (options.tcpPort > 0)
+    {
+        listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0)
+            return fail("Failed to create socket");
+
+        int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        // Loopback only: the protocol has no authentication
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(options.tcpPort));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+            return fail("Failed to bind 127.0.0.1:" + to_string(options.tcpPort));
+    }
+    else
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (options.socketPath.empty() || options.socketPath.size() >= sizeof(address.sun_path))
+        {
+            cerr << "Error: Invalid socket path: " << options.socketPath << endl;
+            return false;
+        }
+        strcpy(address.sun_path, options.socketPath.c_str());
+
+        // A socket file left behind by a server that is gone is replaced;
+        // one that still accepts connections belongs to a running server
+        struct stat info;
+        if (lstat(options.socketPath.c_str(), &info) == 0)
+        {
+            if (!S_ISSOCK(info.st_mode))
+            {
+                cerr << "Error: " << options.socketPath << " exists and is not a socket" << endl;
+                return false;
+            }
+            int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            bool inUse = probe >= 0 && connect(probe, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+            if (probe >= 0)
+                close(probe);
+            if (inUse)
+            {
+                cerr << "Error: Another server is listening on " << options.socketPath << endl;
+                return false;
+            }
+            unlink(options.socketPath.c_str());
+        }
+
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0)
+            return fail("Failed to create socket");
+        if (::bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+            return fail("Failed to bind " + options.socketPath);
+        ownsSocketFile = true;
+        chmod(options.socketPath.c_str(), 0660);
+    }
+
+    if (listen(listenFd, SOMAXCONN) < 0)
+        return fail("Failed to listen on " + endpoint());
+    return true;
+}
+
+bool RpcServer::start()
+{
+    if (!openListener())
+        return false;
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0)
+        return fail("Failed to create epoll instance");
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0)
+        return fail("Failed to create eventfd");
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = LISTEN_ID;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) < 0)
+        return fail("Failed to watch the listening socket");
+    event.data.u64 = WAKE_ID;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event) < 0)
+        return fail("Failed to watch the eventfd");
+
+    pool = make_unique<ThreadPool>(options.workers);
+    return true;
+}
+
+void RpcServer::run()
+{
+    epoll_event events[64];
+    while (!stopping.load())
+    {
+        int ready = epoll_wait(epollFd, events, 64, -1);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            fail("epoll_wait failed");
+            break;
+        }
+
+        for (int i = 0; i < ready; ++i)
+        {
+            uint64_t id = events[i].data.u64;
+            if (id == LISTEN_ID)
+            {
+                acceptConnections();
+                continue;
+            }
+            if (id == WAKE_ID)
+            {
+                uint64_t count;
+                while (read(wakeFd, &count, sizeof(count)) < 0 && errno == EINTR)
+                {
+                }
+                continue;
+            }
+
+            // Ids are never reused, so a connection closed earlier in this batch is simply gone
+            auto found = connections.find(id);
+            if (found == connections.end())
+                continue;
+            Connection &conn = *found->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+            {
+                closeConnection(id);
+                continue;
+            }
+            if ((events[i].events & EPOLLOUT) && !flush(conn))
+            {
+                closeConnection(id);
+                continue;
+            }
+            if (events[i].events & EPOLLIN)
+            {
+                readFrom(id, conn);
+                continue;
+            }
+            dispatchFrames(id, conn);
+            updateInterest(id, conn);
+            closeIfDone(id);
+        }
+
+        deliverCompletions();
+        resumeStalled();
+    }
+
+    // Answer everything already handed to the workers, then hang up
+    close(listenFd);
+    listenFd = -1;
+    pool.reset();
+    deliverCompletions();
+    for (auto &entry : connections)
+        close(entry.second->fd);
+    connections.clear();
+    stalled.clear();
+}
+
+void RpcServer::stop()
+{
+    stopping.store(true);
+    if (wakeFd >= 0)
+        signalEventFd(wakeFd);
+}
+
+string RpcServer::endpoint() const
+{
+    if (options.tcpPort > 0)
+        return "127.0.0.1:" + to_string(options.tcpPort);
+    return options.socketPath;
+}
+
+void RpcServer::acceptConnections()
+{
+    while (true)
+    {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                fail("Failed to accept a connection");
+            return;
+        }
+        if (connections.size() >= options.maxConnections)
+        {
+            close(fd);
+            continue;
+        }
+        if (options.tcpPort > 0)
+        {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        uint64_t id = nextConnectionId++;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = id;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            fail("Failed to watch a connection");
+            close(fd);
+            continue;
+        }
+        auto conn = make_unique<Connection>();
+        conn->fd = fd;
+        conn->events = EPOLLIN;
+        connections.emplace(id, std::move(conn));
+    }
+}
+
+// One read per wakeup keeps a busy peer from starving the others
+void RpcServer::readFrom(uint64_t id, Connection &conn)
+{
+    ssize_t received = recv(conn.fd, readBuffer.data(), readBuffer.size(), 0);
+    if (received > 0)
+    {
+        conn.input.insert(conn.input.end(), readBuffer.begin(), readBuffer.begin() + received);
+    }
+    else if (received == 0)
+    {
+        // The peer is done sending; answer what it sent, then close
+        conn.closing = true;
+    }
+    else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+    {
+        closeConnection(id);
+        return;
+    }
+
+    dispatchFrames(id, conn);
+    updateInterest(id, conn);
+    closeIfDone(id);
+}
+
+void RpcServer::dispatchFrames(uint64_t id, Connection &conn)
+{
+    // Frames still buffered at shutdown are dropped; the pool may be gone
+    if (stopping.load() || !pool)
+        return;
+
+    while (!conn.stalled)
+    {
+        if (inFlight >= options.maxInFlight)
+        {
+            conn.stalled = true;
+            stalled.push_back(id);
+            break;
+        }
+        if (conn.output.size() - conn.outputOffset >= MAX_PENDING_OUTPUT)
+            break;
+
+        const uint8_t *data = conn.input.data() + conn.inputOffset;
+        size_t available = conn.input.size() - conn.inputOffset;
+        uint32_t total;
+        if (!Protocol::frameSize(data, available, total))
+            break;
+        if (total < Protocol::HEADER_SIZE || total > Protocol::MAX_REQUEST_SIZE)
+        {
+            // Frame boundaries are lost, so nothing after this can be read
+            conn.closing = true;
+            conn.input.clear();
+            conn.inputOffset = 0;
+            break;
+        }
+        if (available < total)
+            break;
+
+        vector<uint8_t> request(data + 4, data + total);
+        conn.inputOffset += total;
+        ++inFlight;
+        ++conn.inFlight;
+        pool->submit([this, id, request]()
+                     {
+                         Completion done{id, {}};
+                         handleRequest(request, done.response);
+                         bool wasEmpty;
+                         {
+                             lock_guard<mutex> lock(completionMutex);
+                             wasEmpty = completions.empty();
+                             completions.push_back(std::move(done));
+                         }
+                         // The loop drains the whole queue per wakeup
+                         if (wasEmpty)
+                             signalEventFd(wakeFd); });
+    }
+
+    if (conn.inputOffset == conn.input.size())
+    {
+        conn.input.clear();
+        conn.inputOffset = 0;
+    }
+    else if (conn.inputOffset >= READ_CHUNK)
+    {
+        conn.input.erase(conn.input.begin(), conn.input.begin() + conn.inputOffset);
+        conn.inputOffset = 0;
+    }
+}
+
+void RpcServer::deliverCompletions()
+{
+    vector<Completion> ready;
+    {
+        lock_guard<mutex> lock(completionMutex);
+        ready.swap(completions);
+    }
+    if (ready.empty())
+        return;
+
+    // Responses for one connection are queued together and sent in one write
+    vector<uint64_t> touched;
+    for (auto &done : ready)
+    {
+        --inFlight;
+        auto found = connections.find(done.connectionId);
+        if (found == connections.end())
+            continue;
+        Connection &conn = *found->second;
+        --conn.inFlight;
+        if (conn.outputOffset == conn.output.size())
+        {
+            conn.output.clear();
+            conn.outputOffset = 0;
+            touched.push_back(done.connectionId);
+        }
+        conn.output.insert(conn.output.end(), done.response.begin(), done.response.end());
+    }
+
+    for (uint64_t id : touched)
+    {
+        Connection &conn = *connections[id];
+        if (!flush(conn))
+        {
+            closeConnection(id);
+            continue;
+        }
+        dispatchFrames(id, conn);
+        updateInterest(id, conn);
+        closeIfDone(id);
+    }
+}
+
+void RpcServer::resumeStalled()
+{
+    while (inFlight < options.maxInFlight && !stalled.empty())
+    {
+        uint64_t id = stalled.front();
+        stalled.pop_front();
+        auto found = connections.find(id);
+        if (found == connections.end())
+            continue;
+        Connection &conn = *found->second;
+        conn.stalled = false;
+        dispatchFrames(id, conn);
+        updateInterest(id, conn);
+        closeIfDone(id);
+    }
+}
+
+// Returns false once the peer can no longer be written to
+bool RpcServer::flush(Connection &conn)
+{
+    while (conn.outputOffset < conn.output.size())
+    {
+        ssize_t sent = send(conn.fd, conn.output.data() + conn.outputOffset,
+                            conn.output.size() - conn.outputOffset, MSG_NOSIGNAL);
+        if (sent >= 0)
+        {
+            conn.outputOffset += sent;
+            continue;
+        }
+        if (errno == EINTR)
+            continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    conn.output.clear();
+    conn.outputOffset = 0;
+    return true;
+}
+
+void RpcServer::updateInterest(uint64_t id, Connection &conn)
+{
+    size_t pendingOutput = conn.output.size() - conn.outputOffset;
+    uint32_t wanted = 0;
+    if (!conn.closing && !conn.stalled && pendingOutput < MAX_PENDING_OUTPUT)
+        wanted |= EPOLLIN;
+    if (pendingOutput > 0)
+        wanted |= EPOLLOUT;
+    if (wanted == conn.events)
+        return;
+
+    epoll_event event{};
+    event.events = wanted;
+    event.data.u64 = id;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &event);
+    conn.events = wanted;
+}
+
+void RpcServer::closeIfDone(uint64_t id)
+{
+    auto found = connections.find(id);
+    if (found == connections.end())
+        return;
+    const Connection &conn = *found->second;
+    if (conn.closing && !conn.stalled && conn.inFlight == 0 && conn.outputOffset == conn.output.size())
+        closeConnection(id);
+}
+
+void RpcServer::closeConnection(uint64_t id)
+{
+    auto found = connections.find(id);
+    if (found == connections.end())
+        return;
+    // Closing the descriptor also removes it from the epoll set
+    close(found->second->fd);
+    connections.erase(found);
+}
+
+// Runs on a worker
+void RpcServer::handleRequest(const vector<uint8_t> &request, vector<uint8_t> &response)
+{
+    FrameReader in(request.data(), request.size());
+    uint32_t requestId = in.getU32();
+    uint8_t op = in.getU8();
+
+    FrameWriter out(response, requestId, code(ServiceStatus::Ok));
+    uint8_t status;
+    try
+    {
+        status = execute(static_cast<Op>(op), in, out);
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error: Request " << static_cast<int>(op) << " failed: " << e.what() << endl;
+        status = Protocol::INTERNAL_ERROR;
+    }
+
+    if (status != code(ServiceStatus::Ok) || response.size() > Protocol::MAX_RESPONSE_SIZE)
+    {
+        if (status == code(ServiceStatus::Ok))
+            status = Protocol::INTERNAL_ERROR;
+        out.clearFields();
+    }
+    out.setCode(status);
+    out.finish();
+}
+
+// A mutation is answered Ok only once it is durable. StorageError means
+// the change was made but its outcome on disk is unknown: it is retried by
+// the next commit, so a client must read the state back rather than resend.
+uint8_t RpcServer::committed(ServiceStatus status)
+{
+    if (status == ServiceStatus::Ok && !service.commit())
+        return code(ServiceStatus::StorageError);
+    return code(status);
+}
+
+// Reads the request fields, calls the service and writes the reply fields.
+// Fields written before a failure are dropped by the caller.
+uint8_t RpcServer::execute(Op op, FrameReader &in, FrameWriter &out)
+{
+    const uint8_t malformed = Protocol::MALFORMED_REQUEST;
+    auto complete = [&in]()
+    { return in.ok() && in.atEnd(); };
+
+    switch (op)
+    {
+    case Op::Ping:
+        return complete() ? code(ServiceStatus::Ok) : malformed;
+
+    case Op::RegisterUser:
+    {
+        string name = in.getString();
+        string email = in.getString();
+        uint8_t role = in.getU8();
+        if (!complete())
+            return malformed;
+        // Staff accounts are created by staff at the desk, not over the socket
+        if (role != static_cast<uint8_t>(UserRole::Student) && role != static_cast<uint8_t>(UserRole::Teacher))
+            return code(ServiceStatus::PermissionDenied);
+        ServiceResult result = service.registerUser(name, email, static_cast<UserRole>(role));
+        out.putString(result.id);
+        return committed(result.status);
+    }
+
+    case Op::GetUser:
+    {
+        string userId = in.getString();
+        if (!complete())
+            return malformed;
+        User user;
+        if (!service.getUser(userId, user))
+            return code(ServiceStatus::UserNotFound);
+        out.putString(user.getName());
+        out.putString(user.getEmail());
+        out.putU8(static_cast<uint8_t>(user.getUserRole()));
+        return code(ServiceStatus::Ok);
+    }
+
+    case Op::Borrow:
+    case Op::Return:
+    case Op::Renew:
+    {
+        string userId = in.getString();
+        string resourceId = in.getString();
+        if (!complete())
+            return malformed;
+        LoanResult result = (op == Op::Borrow)   ? service.borrowResource(userId, resourceId)
+                            : (op == Op::Return) ? service.returnResource(userId, resourceId)
+                                                 : service.renewLoan(userId, resourceId);
+        out.putString(result.loanId);
+        out.putU32(static_cast<uint32_t>(result.copyNumber));
+        if (op != Op::Return)
+            out.putU64(static_cast<uint64_t>(result.dueDate));
+        if (op == Op::Renew)
+            out.putU32(static_cast<uint32_t>(result.renewalCount));
+        return committed(result.status);
+    }
+
+    case Op::Search:
+    {
+        string keyword = in.getString();
+        uint32_t limit = min(in.getU32(), Protocol::MAX_LIST_ENTRIES);
+        if (!complete())
+            return malformed;
+        vector<ResourceEntry> entries;
+        size_t total = service.searchResources(keyword, [&](const Resource &resource)
+                                               {
+                                                   if (entries.size() < limit)
+                                                       entries.push_back(describe(resource)); });
+        putResources(out, total, entries);
+        return code(ServiceStatus::Ok);
+    }
+
+    case Op::ListResources:
+    {
+        uint32_t offset = in.getU32();
+        uint32_t limit = min(in.getU32(), Protocol::MAX_LIST_ENTRIES);
+        if (!complete())
+            return malformed;
+        vector<ResourceEntry> entries;
+        size_t total = service.forEachResource(offset, limit, [&](const Resource &resource)
+                                               { entries.push_back(describe(resource)); });
+        putResources(out, total, entries);
+        return code(ServiceStatus::Ok);
+    }
+
+    case Op::ActiveLoans:
+    {
+        string userId = in.getString();
+        if (!complete())
+            return malformed;
+        User user;
+        if (!service.getUser(userId, user))
+            return code(ServiceStatus::UserNotFound);
+        vector<Loan> loans = service.activeLoansFor(userId);
+        out.putU32(static_cast<uint32_t>(loans.size()));
+        for (const auto &loan : loans)
+        {
+            out.putString(loan.getLoanId());
+            out.putString(loan.getResourceId());
+            out.putU32(static_cast<uint32_t>(loan.getCopyNumber()));
+            out.putU64(static_cast<uint64_t>(loan.getDueDate()));
+        }
+        return code(ServiceStatus::Ok);
+    }
+
+    case Op::Reserve:
+    {
+        string userId = in.getString();
+        string resourceId = in.getString();
+        if (!complete())
+            return malformed;
+        ServiceResult result = service.makeReservation(userId, resourceId);
+        out.putString(result.id);
+        return committed(result.status);
+    }
+
+    case Op::CancelReservation:
+    {
+        string userId = in.getString();
+        string reservationId = in.getString();
+        if (!complete())
+            return malformed;
+        ServiceResult result = service.cancelReservation(userId, reservationId);
+        out.putString(result.id);
+        return committed(result.status);
+    }
+
+    case Op::Notifications:
+    {
+        string userId = in.getString();
+        if (!complete())
+            return malformed;
+        User user;
+        if (!service.getUser(userId, user))
+            return code(ServiceStatus::UserNotFound);
+        vector<Notification> notifications = service.notificationsFor(userId);
+        out.putU32(static_cast<uint32_t>(notifications.size()));
+        for (const auto &notification : notifications)
+        {
+            out.putString(notification.getNotificationId());
+            out.putString(notification.getMessage());
+            out.putU8(notification.isRead() ? 1 : 0);
+        }
+        return code(ServiceStatus::Ok);
+    }
+
+    case Op::MarkNotificationRead:
+    {
+        string userId = in.getString();
+        string notificationId = in.getString();
+        if (!complete())
+            return malformed;
+        ServiceResult result = service.markNotificationRead(userId, notificationId);
+        out.putString(result.id);
+        return committed(result.status);
+    }
+    }
+
+    return Protocol::UNKNOWN_OPERATION;
+}
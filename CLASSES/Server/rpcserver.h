@@ -0,0 +1,119 @@
+#ifndef RPCSERVER_H
+#define RPCSERVER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include "Service/libraryservice.h"
+#include "Concurrency/threadpool.h"
+#include "protocol.h"
+using namespace std;
+
+struct ServerOptions
+{
+    string socketPath = "library.sock"; // Unix domain socket, used when tcpPort is 0
+    int tcpPort = 0;                    // listen on 127.0.0.1:tcpPort instead
+    size_t workers = 0;                 // 0 = one per hardware thread
+    size_t maxInFlight = 256;           // requests queued or running, over all connections
+    size_t maxConnections = 1024;
+};
+
+// Serves LibraryService over the binary protocol in protocol.h.
+// One thread runs an epoll loop that accepts connections, reads frames and
+// writes responses; the requests themselves run on a fixed pool of workers.
+// Once maxInFlight requests are waiting, the loop stops reading until some
+// complete, so a flood of pipelined requests queues in the clients' socket
+// buffers instead of in memory. Mutations are committed before they are
+// answered; workers that commit at the same time share one fsync.
+// Callers are trusted to name the acting user, as with the console login;
+// the service still checks what that user may do.
+class RpcServer
+{
+private:
+    struct Connection
+    {
+        int fd = -1;
+        vector<uint8_t> input;
+        size_t inputOffset = 0; // bytes before this have been dispatched
+        vector<uint8_t> output;
+        size_t outputOffset = 0; // bytes before this have been sent
+        size_t inFlight = 0;
+        bool stalled = false;    // waiting for room under maxInFlight
+        bool closing = false;    // peer hung up or broke the protocol
+        uint32_t events = 0;     // current epoll interest
+    };
+
+    struct Completion
+    {
+        uint64_t connectionId;
+        vector<uint8_t> response;
+    };
+
+    LibraryService &service;
+    ServerOptions options;
+    int listenFd;
+    int epollFd;
+    int wakeFd; // eventfd: completions are ready or stop() was called
+    bool ownsSocketFile;
+    atomic<bool> stopping;
+
+    // Owned by the event loop thread
+    unordered_map<uint64_t, unique_ptr<Connection>> connections;
+    deque<uint64_t> stalled;
+    uint64_t nextConnectionId;
+    size_t inFlight;
+    vector<uint8_t> readBuffer;
+
+    // Filled by workers, drained by the event loop
+    mutex completionMutex;
+    vector<Completion> completions;
+
+    unique_ptr<ThreadPool> pool;
+
+    static const uint64_t LISTEN_ID = 0;
+    static const uint64_t WAKE_ID = 1;
+    static const size_t READ_CHUNK = 64 * 1024;
+    static const size_t MAX_PENDING_OUTPUT = 4 * 1024 * 1024; // stop reading from a peer that does not read
+
+    // Event loop
+    bool openListener();
+    void acceptConnections();
+    void readFrom(uint64_t id, Connection &conn);
+    void dispatchFrames(uint64_t id, Connection &conn);
+    void deliverCompletions();
+    void resumeStalled();
+    bool flush(Connection &conn);
+    void updateInterest(uint64_t id, Connection &conn);
+    void closeIfDone(uint64_t id);
+    void closeConnection(uint64_t id);
+
+    // Workers
+    void handleRequest(const vector<uint8_t> &request, vector<uint8_t> &response);
+    uint8_t execute(Protocol::Op op, Protocol::FrameReader &in, Protocol::FrameWriter &out);
+    uint8_t committed(ServiceStatus status);
+
+public:
+    // Constructor/Destructor
+    // service must outlive the server
+    RpcServer(LibraryService &service, const ServerOptions &options);
+    ~RpcServer();
+
+    RpcServer(const RpcServer &) = delete;
+    RpcServer &operator=(const RpcServer &) = delete;
+
+    // Binds the socket and starts the workers. Returns false on failure.
+    bool start();
+    // Serves until stop(), then finishes the requests already accepted
+    void run();
+    // Safe to call from another thread or a signal handler
+    void stop();
+
+    string endpoint() const;
+};
+
+#endif
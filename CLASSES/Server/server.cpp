@@ -0,0 +1,90 @@
+// Library server: serves the data file over a local socket until SIGINT or SIGTERM.
+// usage: library_server [data file] [--socket PATH | --port N] [--workers N] [--max-inflight N]
+#include "rpcserver.h"
+#include <iostream>
+#include <csignal>
+#include <cstring>
+
+namespace
+{
+    RpcServer *runningServer = nullptr;
+
+    void handleSignal(int)
+    {
+        if (runningServer)
+            runningServer->stop();
+    }
+
+    void printUsage(const char *program)
+    {
+        cerr << "usage: " << program
+             << " [data file] [--socket PATH | --port N] [--workers N] [--max-inflight N]" << endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    string dataFile = "library_data.json";
+    ServerOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--socket" && hasValue)
+            options.socketPath = argv[++i];
+        else if (arg == "--port" && hasValue)
+            options.tcpPort = atoi(argv[++i]);
+        else if (arg == "--workers" && hasValue)
+            options.workers = static_cast<size_t>(max(atoi(argv[++i]), 0));
+        else if (arg == "--max-inflight" && hasValue)
+            options.maxInFlight = static_cast<size_t>(max(atoi(argv[++i]), 1));
+        else if (!arg.empty() && arg[0] != '-')
+            dataFile = arg;
+        else
+        {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    try
+    {
+        LibraryService service(dataFile);
+        const LoadReport &report = service.loadReport();
+        if (report.recovered > 0)
+            cout << "Recovered " << report.recovered << " logged change(s).\n";
+        if (report.skipped > 0)
+            cout << "Skipped " << report.skipped << " unreadable logged change(s).\n";
+        if (report.createdAdmin)
+            cout << "Default admin user created: admin001\n";
+
+        RpcServer server(service, options);
+        if (!server.start())
+            return 1;
+
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = handleSignal;
+        sigemptyset(&action.sa_mask);
+        runningServer = &server;
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+        signal(SIGPIPE, SIG_IGN);
+
+        cout << "Serving " << dataFile << " on " << server.endpoint() << endl;
+        server.run();
+        runningServer = nullptr;
+
+        cout << "Shutting down" << endl;
+        if (!service.close())
+            return 1;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,1249 @@
+#include "libraryservice.h"
+#include "Persistence/persistence.h"
+#include "Registry/idinterner.h"
+#include "Registry/idallocator.h"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+bool ServiceResult::ok() const
+{
+    return status == ServiceStatus::Ok;
+}
+
+bool LoanResult::ok() const
+{
+    return status == ServiceStatus::Ok;
+}
+
+// Constructor/Destructor
+LibraryService::LibraryService(const string &dataFile)
+    : mutationsSinceSnapshot(0), captureAll(false), closed(false), DATA_FILE(dataFile),
+      LOG_FILE(dataFile.substr(0, dataFile.find_last_of('.')) + ".wal"), LOG_ARCHIVE(LOG_FILE + ".old")
+{
+    loadData();
+
+    // Create default admin user if no users exist. This runs before the
+    // snapshot thread starts, so nothing else reads users yet.
+    if (users.empty())
+    {
+        User admin("admin001", "System Administrator", "admin@library.com", UserRole::LibraryAdmin);
+        users.push_back(admin);
+        userRegistry.add(admin.getUserId(), users.size() - 1);
+        logMutation("registerUser", {{"user", admin.toJson()}});
+        wal.commit();
+        report.createdAdmin = true;
+    }
+
+    snapshotter.start(DATA_FILE, LOG_ARCHIVE, chrono::seconds(SNAPSHOT_INTERVAL_SECONDS), SNAPSHOT_DIRTY_LIMIT,
+                      [this]()
+                      { return captureChanges(); });
+}
+
+LibraryService::~LibraryService()
+{
+    close();
+}
+
+// Helper methods
+string LibraryService::generateId(const string &prefix)
+{
+    return IdAllocator::global().next(prefix);
+}
+
+bool LibraryService::hasUser(const string &userId) const
+{
+    shared_lock<shared_mutex> lock(usersMutex);
+    return findUser(userId) != nullptr;
+}
+
+User *LibraryService::findUser(const string &userId)
+{
+    size_t pos = userRegistry.lookup(userId);
+    return (pos != Registry::noPosition) ? &users[pos] : nullptr;
+}
+
+const User *LibraryService::findUser(const string &userId) const
+{
+    size_t pos = userRegistry.lookup(userId);
+    return (pos != Registry::noPosition) ? &users[pos] : nullptr;
+}
+
+Resource *LibraryService::findResource(const string &resourceId)
+{
+    size_t pos = resourceRegistry.lookup(resourceId);
+    return (pos != Registry::noPosition) ? resources[pos].get() : nullptr;
+}
+
+Loan *LibraryService::findActiveLoan(const string &userId, const string &resourceId)
+{
+    size_t pos = activeLoans.findActive(userId, resourceId);
+    return (pos != Registry::noPosition) ? &loans[pos] : nullptr;
+}
+
+// Lowest copy number no active loan holds. A successful checkout leaves
+// fewer loans than copies, so one is always free.
+int LibraryService::freeCopy(const string &resourceId) const
+{
+    const vector<size_t> &active = activeLoans.activeForResource(resourceId);
+    vector<bool> taken(active.size() + 1, false);
+    for (size_t pos : active)
+    {
+        size_t copy = static_cast<size_t>(loans[pos].getCopyNumber());
+        if (copy <= active.size())
+            taken[copy - 1] = true;
+    }
+    return static_cast<int>(find(taken.begin(), taken.end(), false) - taken.begin()) + 1;
+}
+
+Reservation *LibraryService::findReservation(const string &reservationId)
+{
+    size_t pos = reservationRegistry.lookup(reservationId);
+    return (pos != Registry::noPosition) ? &reservations[pos] : nullptr;
+}
+
+Notification *LibraryService::findNotification(const string &notificationId)
+{
+    size_t pos = notificationRegistry.lookup(notificationId);
+    return (pos != Registry::noPosition) ? &notifications[pos] : nullptr;
+}
+
+// Files written before the counters were saved only have the IDs themselves
+void LibraryService::observeIds()
+{
+    IdAllocator &ids = IdAllocator::global();
+    for (const auto &user : users)
+        ids.observe("USER", user.getUserId());
+    for (const auto &resource : resources)
+        ids.observe("RES", resource->getResourceId());
+    for (const auto &loan : loans)
+        ids.observe("LOAN", loan.getLoanId());
+    for (const auto &reservation : reservations)
+    {
+        ids.observe("RSV", reservation.getReservationId());
+        ids.observe("RES", reservation.getReservationId()); // reservations used to share the resource prefix
+    }
+    for (const auto &notification : notifications)
+        ids.observe("NOTIF", notification.getNotificationId());
+    for (const auto &event : events)
+        ids.observe("EVT", event.getEventId());
+}
+
+void LibraryService::rebuildIndexes()
+{
+    userRegistry.clear();
+    userRegistry.reserve(users.size());
+    for (size_t i = 0; i < users.size(); i++)
+        userRegistry.add(users[i].getUserId(), i);
+
+    resourceRegistry.clear();
+    resourceRegistry.reserve(resources.size());
+    textIndex.clear();
+    trigramIndex.clear();
+    catalog.clear();
+    catalog.reserve(resources.size());
+    for (size_t i = 0; i < resources.size(); i++)
+        indexResource(i);
+
+    loanRegistry.clear();
+    loanRegistry.reserve(loans.size());
+    for (size_t i = 0; i < loans.size(); i++)
+        loanRegistry.add(loans[i].getLoanId(), i);
+
+    reservationRegistry.clear();
+    reservationRegistry.reserve(reservations.size());
+    for (size_t i = 0; i < reservations.size(); i++)
+        reservationRegistry.add(reservations[i].getReservationId(), i);
+
+    notificationRegistry.clear();
+    notificationRegistry.reserve(notifications.size());
+    for (size_t i = 0; i < notifications.size(); i++)
+        notificationRegistry.add(notifications[i].getNotificationId(), i);
+
+    eventRegistry.clear();
+    eventRegistry.reserve(events.size());
+    for (size_t i = 0; i < events.size(); i++)
+        eventRegistry.add(events[i].getEventId(), i);
+}
+
+void LibraryService::indexResource(size_t pos)
+{
+    Registry::Handle handle = resourceRegistry.add(resources[pos]->getResourceId(), pos);
+    if (handle != Registry::npos)
+    {
+        textIndex.add(handle, *resources[pos]);
+        trigramIndex.add(handle, *resources[pos]);
+        catalog.add(handle, *resources[pos]);
+    }
+}
+
+void LibraryService::eraseResource(size_t pos)
+{
+    const string resourceId = resources[pos]->getResourceId();
+    Registry::Handle removed = resourceRegistry.find(resourceId);
+    if (removed != Registry::npos && resourceRegistry.position(removed) == pos)
+    {
+        textIndex.remove(removed, *resources[pos]);
+        trigramIndex.remove(removed, *resources[pos]);
+        catalog.remove(removed);
+        resourceRegistry.remove(resourceId);
+    }
+
+    // Move the last resource into the freed slot so removal stays O(1)
+    size_t last = resources.size() - 1;
+    if (pos != last)
+    {
+        Registry::Handle moved = resourceRegistry.find(resources[last]->getResourceId());
+        if (resourceRegistry.position(moved) == last)
+            resourceRegistry.relocate(moved, pos);
+        resources[pos] = std::move(resources[last]);
+    }
+    resources.pop_back();
+}
+
+// Called by the winner of a checkout or checkin with the resource's shard
+// held. The filter column follows the latest state word, so whoever
+// publishes last leaves it right. The record gets the word this caller's
+// own CAS produced: a later word could count a loan whose record is not
+// logged yet.
+void LibraryService::publishState(const string &resourceId, const Resource &resource, uint64_t stateWord, json &record)
+{
+    uint32_t copies = static_cast<uint32_t>(resource.getCopies());
+    catalog.setAvailable(resourceRegistry.find(resourceId), Resource::copiesOnLoanIn(resource.getStateWord()) < copies);
+    record["available"] = Resource::copiesOnLoanIn(stateWord) < copies;
+    record["state"] = stateWord;
+}
+
+// Loan records are the truth about what is on loan. Replay can still leave a
+// state word counting a checkout whose record did not survive a crash, and
+// then that copy would never come back, so the counts are rebuilt from the
+// active loans after loading.
+void LibraryService::reconcileHoldings()
+{
+    for (const auto &resource : resources)
+    {
+        const string &resourceId = resource->getResourceId();
+        int onLoan = static_cast<int>(activeLoans.activeForResource(resourceId).size());
+        if (onLoan == resource->getCopiesOnLoan())
+            continue;
+        resource->setCopiesOnLoan(onLoan);
+        catalog.setAvailable(resourceRegistry.find(resourceId), resource->getAvailable());
+        lock_guard<mutex> lock(changesMutex);
+        changes.emplace_back("resources", resourceId);
+    }
+}
+
+ServiceStatus LibraryService::addNotification(const string &userId, const string &message, string &notificationId)
+{
+    try
+    {
+        Notification notification(generateId("NOTIF"), userId, message, time(nullptr));
+        json record = {{"notification", notification.toJson()}};
+        {
+            unique_lock<shared_mutex> lock(notificationsMutex);
+            notifications.push_back(notification);
+            notificationRegistry.add(notification.getNotificationId(), notifications.size() - 1);
+        }
+        notificationId = notification.getNotificationId();
+        return logMutation("notify", std::move(record)) ? ServiceStatus::Ok : ServiceStatus::StorageError;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Warning: Notification rejected: " << e.what() << endl;
+        return ServiceStatus::InvalidArgument;
+    }
+}
+
+// Write-ahead log. Records are appended after the change is made but while
+// the shards are still held, so changes to one entity are logged in order.
+// Appending only buffers the record; the fsync happens in commit(), after
+// the caller has let go of its locks. Returns false if the record could
+// not be logged, though the change is made.
+bool LibraryService::logMutation(const string &op, json record)
+{
+    record["op"] = op;
+    noteChanges(record);
+    snapshotter.changed(++mutationsSinceSnapshot);
+    return wal.append(record);
+}
+
+// Entities a log record changed, as (section, id). A record for an entity
+// that is gone by the time of the capture marks it removed.
+void LibraryService::noteChanges(const json &record)
+{
+    const string op = record.at("op").get<string>();
+    lock_guard<mutex> lock(changesMutex);
+    if (op == "registerUser")
+    {
+        changes.emplace_back("users", record.at("user").at("userId").get<string>());
+    }
+    else if (op == "addResource")
+    {
+        changes.emplace_back("resources", record.at("resource").at("resourceId").get<string>());
+    }
+    else if (op == "removeResource")
+    {
+        changes.emplace_back("resources", record.at("resourceId").get<string>());
+    }
+    else if (op == "borrow" || op == "return" || op == "renew")
+    {
+        const json &loan = record.at("loan");
+        changes.emplace_back("loans", loan.at("loanId").get<string>());
+        changes.emplace_back("resources", loan.at("resourceId").get<string>());
+    }
+    else if (op == "reserve")
+    {
+        changes.emplace_back("reservations", record.at("reservation").at("reservationId").get<string>());
+    }
+    else if (op == "notify")
+    {
+        changes.emplace_back("notifications", record.at("notification").at("notificationId").get<string>());
+    }
+    else if (op == "event")
+    {
+        changes.emplace_back("events", record.at("event").at("eventId").get<string>());
+    }
+}
+
+// Runs on the snapshotter thread. Every collection is locked so the capture
+// sees each operation whole or not at all, but only the entities on the
+// change list are looked up and copied, so the locks are held for
+// O(changes). Serialization and fsync happen after they are released.
+unique_ptr<SnapshotState> LibraryService::captureChanges()
+{
+    auto state = make_unique<SnapshotState>();
+    {
+        lock_guard<mutex> lock(changesMutex);
+        if (changes.empty() && !captureAll)
+            return state;
+    }
+
+    unique_lock<shared_mutex> usersLock(usersMutex);
+    unique_lock<shared_mutex> catalogLock(catalogMutex);
+    unique_lock<shared_mutex> loansLock(loansMutex);
+    unique_lock<shared_mutex> reservationsLock(reservationsMutex);
+    unique_lock<shared_mutex> notificationsLock(notificationsMutex);
+    unique_lock<shared_mutex> eventsLock(eventsMutex);
+
+    // Records logged so far are covered by this capture; later ones go to a fresh log
+    if (!wal.rotate(LOG_ARCHIVE))
+        return state;
+    vector<pair<string, string>> changed;
+    {
+        lock_guard<mutex> lock(changesMutex);
+        changed.swap(changes);
+    }
+    mutationsSinceSnapshot = 0;
+
+    if (captureAll)
+    {
+        state->complete = true;
+        state->users = users;
+        for (const auto &r : resources)
+            state->resources.push_back(r->clone());
+        state->loans = loans;
+        state->reservations = reservations;
+        state->notifications = notifications;
+        state->events = events;
+        captureAll = false;
+        return state;
+    }
+
+    sort(changed.begin(), changed.end());
+    changed.erase(unique(changed.begin(), changed.end()), changed.end());
+    for (const auto &entry : changed)
+    {
+        const string &section = entry.first;
+        const string &id = entry.second;
+        size_t pos = Registry::noPosition;
+        if (section == "users")
+        {
+            pos = userRegistry.lookup(id);
+            if (pos != Registry::noPosition)
+                state->users.push_back(users[pos]);
+        }
+        else if (section == "resources")
+        {
+            pos = resourceRegistry.lookup(id);
+            if (pos != Registry::noPosition)
+                state->resources.push_back(resources[pos]->clone());
+        }
+        else if (section == "loans")
+        {
+            pos = loanRegistry.lookup(id);
+            if (pos != Registry::noPosition)
+                state->loans.push_back(loans[pos]);
+        }
+        else if (section == "reservations")
+        {
+            pos = reservationRegistry.lookup(id);
+            if (pos != Registry::noPosition)
+                state->reservations.push_back(reservations[pos]);
+        }
+        else if (section == "notifications")
+        {
+            pos = notificationRegistry.lookup(id);
+            if (pos != Registry::noPosition)
+                state->notifications.push_back(notifications[pos]);
+        }
+        else if (section == "events")
+        {
+            pos = eventRegistry.lookup(id);
+            if (pos != Registry::noPosition)
+                state->events.push_back(events[pos]);
+        }
+
+        if (pos == Registry::noPosition)
+            state->removed.push_back(entry);
+    }
+    return state;
+}
+
+// Records hold after-images of the changed entities, so replaying a record
+// that the snapshot already contains is harmless.
+void LibraryService::applyLogRecord(const json &record)
+{
+    const string op = record.at("op").get<string>();
+
+    if (op == "registerUser")
+    {
+        User user = User::fromJson(record.at("user"));
+        size_t pos = userRegistry.lookup(user.getUserId());
+        if (pos != Registry::noPosition)
+        {
+            users[pos] = user;
+        }
+        else
+        {
+            users.push_back(user);
+            userRegistry.add(user.getUserId(), users.size() - 1);
+        }
+    }
+    else if (op == "addResource")
+    {
+        unique_ptr<Resource> resource = Resource::fromJson(record.at("resource"));
+        // A later record may remove it again, but its ID must stay used
+        IdAllocator::global().observe("RES", resource->getResourceId());
+        size_t pos = resourceRegistry.lookup(resource->getResourceId());
+        if (pos != Registry::noPosition)
+        {
+            resources[pos] = std::move(resource);
+        }
+        else
+        {
+            resources.push_back(std::move(resource));
+            resourceRegistry.add(resources.back()->getResourceId(), resources.size() - 1);
+        }
+    }
+    else if (op == "removeResource")
+    {
+        size_t pos = resourceRegistry.lookup(record.at("resourceId").get<string>());
+        if (pos != Registry::noPosition)
+            eraseResource(pos);
+    }
+    else if (op == "borrow" || op == "return" || op == "renew")
+    {
+        Loan loan = Loan::fromJson(record.at("loan"));
+        size_t pos = loanRegistry.lookup(loan.getLoanId());
+        if (pos != Registry::noPosition)
+        {
+            loans[pos] = loan;
+        }
+        else
+        {
+            loans.push_back(loan);
+            loanRegistry.add(loan.getLoanId(), loans.size() - 1);
+        }
+
+        // Concurrent loans may log out of order; the state word says which is newer
+        Resource *resource = findResource(loan.getResourceId());
+        if (resource && record.contains("state"))
+            resource->applyStateWord(record["state"].get<uint64_t>());
+        else if (resource && record.contains("available"))
+            resource->setAvailable(record["available"].get<bool>());
+    }
+    else if (op == "reserve")
+    {
+        Reservation reservation = Reservation::fromJson(record.at("reservation"));
+        size_t pos = reservationRegistry.lookup(reservation.getReservationId());
+        if (pos != Registry::noPosition)
+        {
+            reservations[pos] = reservation;
+        }
+        else
+        {
+            reservations.push_back(reservation);
+            reservationRegistry.add(reservation.getReservationId(), reservations.size() - 1);
+        }
+    }
+    else if (op == "notify")
+    {
+        Notification notification = Notification::fromJson(record.at("notification"));
+        size_t pos = notificationRegistry.lookup(notification.getNotificationId());
+        if (pos != Registry::noPosition)
+        {
+            notifications[pos] = notification;
+        }
+        else
+        {
+            notifications.push_back(notification);
+            notificationRegistry.add(notification.getNotificationId(), notifications.size() - 1);
+        }
+    }
+    else if (op == "event")
+    {
+        LibraryEvent event = LibraryEvent::fromJson(record.at("event"));
+        size_t pos = eventRegistry.lookup(event.getEventId());
+        if (pos != Registry::noPosition)
+        {
+            events[pos] = event;
+        }
+        else
+        {
+            events.push_back(event);
+            eventRegistry.add(event.getEventId(), events.size() - 1);
+        }
+    }
+    else
+    {
+        cerr << "Warning: Unknown log record '" << op << "'" << endl;
+    }
+}
+
+// Runs in the constructor, before any other thread can see the service
+void LibraryService::loadData()
+{
+    report.loaded = Persistence::loadFromFile(DATA_FILE, users, resources, loans, reservations, notifications, events, &activeLoans);
+    // Saving changes on top of a file that cannot be read would fail every time
+    error_code ec;
+    captureAll = !report.loaded && filesystem::exists(DATA_FILE, ec);
+    rebuildIndexes();
+
+    // An archive is left behind when the last background snapshot did not
+    // finish. Replayed records go on the change list for the next capture.
+    auto replay = [this](const json &record)
+    {
+        applyLogRecord(record);
+        noteChanges(record);
+    };
+    size_t archiveSkipped, logSkipped;
+    size_t replayed = WriteAheadLog::replay(LOG_ARCHIVE, replay, &archiveSkipped);
+    replayed += WriteAheadLog::replay(LOG_FILE, replay, &logSkipped);
+    report.skipped = archiveSkipped + logSkipped;
+    if (replayed + report.skipped > 0)
+    {
+        rebuildIndexes();
+        activeLoans.build(loans);
+        mutationsSinceSnapshot = replayed;
+    }
+    reconcileHoldings();
+    report.recovered = replayed;
+    observeIds();
+    wal.open(LOG_FILE);
+}
+
+bool LibraryService::commit()
+{
+    // Everything logged so far, by any caller, becomes durable; callers that
+    // commit while another's fsync is running share the next one
+    return wal.commit();
+}
+
+bool LibraryService::close()
+{
+    if (closed.exchange(true))
+        return true;
+
+    snapshotter.stop();
+    wal.commit();
+    // Saves what changed since the last capture and removes the log archive
+    bool saved = snapshotter.saveNow();
+    Persistence::closeStore(DATA_FILE);
+    if (!saved)
+        return false;
+
+    // The data file now covers everything in both logs
+    wal.reset();
+    return true;
+}
+
+// Users
+ServiceResult LibraryService::registerUser(const string &name, const string &email, UserRole role)
+{
+    ServiceResult result;
+    User newUser(generateId("USER"), name, email, role);
+    {
+        unique_lock<shared_mutex> lock(usersMutex);
+        users.push_back(newUser);
+        userRegistry.add(newUser.getUserId(), users.size() - 1);
+    }
+    result.id = newUser.getUserId();
+    if (!logMutation("registerUser", {{"user", newUser.toJson()}}))
+        result.status = ServiceStatus::StorageError;
+    return result;
+}
+
+bool LibraryService::getUser(const string &userId, User &user) const
+{
+    shared_lock<shared_mutex> lock(usersMutex);
+    const User *found = findUser(userId);
+    if (!found)
+        return false;
+    user = *found;
+    return true;
+}
+
+bool LibraryService::isAdmin(const string &userId) const
+{
+    shared_lock<shared_mutex> lock(usersMutex);
+    const User *user = findUser(userId);
+    return user && (user->getUserRole() == UserRole::LibraryAdmin ||
+                    user->getUserRole() == UserRole::LibraryEmployee);
+}
+
+// Resources
+ServiceResult LibraryService::addResource(const string &actorId, unique_ptr<Resource> resource)
+{
+    ServiceResult result;
+    if (!isAdmin(actorId))
+    {
+        result.status = ServiceStatus::PermissionDenied;
+        return result;
+    }
+    if (!resource)
+    {
+        result.status = ServiceStatus::InvalidArgument;
+        return result;
+    }
+
+    // The service owns the ID space, whatever the caller put there
+    result.id = generateId("RES");
+    resource->setResourceId(result.id);
+    json record = {{"resource", resource->toJson()}};
+
+    // Logged before the lock is released, so no borrow of the new resource
+    // and no snapshot can come between it and its record
+    unique_lock<shared_mutex> lock(catalogMutex);
+    resources.push_back(std::move(resource));
+    indexResource(resources.size() - 1);
+    if (!logMutation("addResource", std::move(record)))
+        result.status = ServiceStatus::StorageError;
+    return result;
+}
+
+ServiceResult LibraryService::removeResource(const string &actorId, const string &resourceId)
+{
+    ServiceResult result;
+    result.id = resourceId;
+    if (!isAdmin(actorId))
+    {
+        result.status = ServiceStatus::PermissionDenied;
+        return result;
+    }
+
+    // Exclusive, so no checkout is in flight; logged under it like addResource
+    unique_lock<shared_mutex> lock(catalogMutex);
+    size_t pos = resourceRegistry.lookup(resourceId);
+    if (pos == Registry::noPosition)
+    {
+        result.status = ServiceStatus::ResourceNotFound;
+        return result;
+    }
+
+    bool onLoan = resources[pos]->getCopiesOnLoan() > 0;
+    if (!onLoan)
+    {
+        shared_lock<shared_mutex> loansLock(loansMutex);
+        onLoan = !activeLoans.activeForResource(resourceId).empty();
+    }
+    if (onLoan)
+    {
+        result.status = ServiceStatus::ResourceOnLoan;
+        return result;
+    }
+
+    eraseResource(pos);
+    if (!logMutation("removeResource", {{"resourceId", resourceId}}))
+        result.status = ServiceStatus::StorageError;
+    return result;
+}
+
+size_t LibraryService::searchResources(const string &keyword, const function<void(const Resource &)> &visit) const
+{
+    shared_lock<shared_mutex> lock(catalogMutex);
+    size_t found = 0;
+
+    // Trigrams handle any keyword of three or more characters, including ones
+    // spanning several words; shorter ones through the term index's short grams.
+    vector<Registry::Handle> candidates;
+    bool exact = false;
+    if (trigramIndex.candidates(keyword, candidates) ||
+        textIndex.candidates(keyword, candidates, exact))
+    {
+        for (Registry::Handle handle : candidates)
+        {
+            size_t pos = resourceRegistry.position(handle);
+            if (pos == Registry::noPosition)
+                continue;
+
+            const Resource &resource = *resources[pos];
+            if (exact || resource.matchesKeyword(keyword))
+            {
+                visit(resource);
+                ++found;
+            }
+        }
+    }
+    else
+    {
+        for (const auto &resource : resources)
+        {
+            if (resource->matchesKeyword(keyword))
+            {
+                visit(*resource);
+                ++found;
+            }
+        }
+    }
+    return found;
+}
+
+// Filters run over the catalog columns; only matches touch the resources
+size_t LibraryService::filterResources(const CatalogFilter &filter, const function<void(const Resource &)> &visit) const
+{
+    shared_lock<shared_mutex> lock(catalogMutex);
+    vector<Registry::Handle> matches;
+    catalog.select(filter, matches);
+
+    size_t found = 0;
+    for (Registry::Handle handle : matches)
+    {
+        size_t pos = resourceRegistry.position(handle);
+        if (pos == Registry::noPosition)
+            continue;
+        visit(*resources[pos]);
+        ++found;
+    }
+    return found;
+}
+
+size_t LibraryService::forEachResource(const function<void(const Resource &)> &visit) const
+{
+    shared_lock<shared_mutex> lock(catalogMutex);
+    for (const auto &resource : resources)
+        visit(*resource);
+    return resources.size();
+}
+
+size_t LibraryService::forEachResource(size_t offset, size_t limit, const function<void(const Resource &)> &visit) const
+{
+    shared_lock<shared_mutex> lock(catalogMutex);
+    size_t end = (offset < resources.size()) ? offset + min(limit, resources.size() - offset) : offset;
+    for (size_t pos = offset; pos < end; pos++)
+        visit(*resources[pos]);
+    return resources.size();
+}
+
+// Loans
+LoanResult LibraryService::borrowResource(const string &userId, const string &resourceId)
+{
+    LoanResult result;
+    if (!hasUser(userId))
+    {
+        result.status = ServiceStatus::UserNotFound;
+        return result;
+    }
+
+    lock_guard<mutex> userShard(userLocks.forKey(userId));
+    shared_lock<shared_mutex> catalogLock(catalogMutex);
+    Resource *resource = findResource(resourceId);
+    if (!resource)
+    {
+        result.status = ServiceStatus::ResourceNotFound;
+        return result;
+    }
+    {
+        shared_lock<shared_mutex> loansLock(loansMutex);
+        if (findActiveLoan(userId, resourceId))
+        {
+            result.status = ServiceStatus::AlreadyBorrowed;
+            return result;
+        }
+    }
+
+    // Of several users borrowing the same resource only as many get past
+    // here as there are copies; the others fail without waiting on a lock
+    uint64_t stateWord;
+    if (!resource->checkout(stateWord))
+    {
+        result.status = ServiceStatus::NotAvailable;
+        return result;
+    }
+
+    json record;
+    {
+        unique_lock<shared_mutex> loansLock(loansMutex);
+        time_t now = time(nullptr);
+        int copy = freeCopy(resourceId);
+        loans.emplace_back(generateId("LOAN"), userId, resourceId, now, now + Loan::getLoanPeriod(), copy);
+        loanRegistry.add(loans.back().getLoanId(), loans.size() - 1);
+        activeLoans.add(loans.back(), loans.size() - 1);
+        result.loanId = loans.back().getLoanId();
+        result.copyNumber = copy;
+        result.dueDate = loans.back().getDueDate();
+        record = {{"loan", loans.back().toJson()}};
+    }
+
+    lock_guard<mutex> resourceShard(resourceLocks.forKey(resourceId));
+    publishState(resourceId, *resource, stateWord, record);
+    if (!logMutation("borrow", std::move(record)))
+        result.status = ServiceStatus::StorageError;
+    return result;
+}
+
+LoanResult LibraryService::returnResource(const string &userId, const string &resourceId)
+{
+    LoanResult result;
+    lock_guard<mutex> userShard(userLocks.forKey(userId));
+    shared_lock<shared_mutex> catalogLock(catalogMutex);
+    json record;
+    {
+        unique_lock<shared_mutex> loansLock(loansMutex);
+        Loan *loan = findActiveLoan(userId, resourceId);
+        if (!loan)
+        {
+            result.status = ServiceStatus::LoanNotFound;
+            return result;
+        }
+
+        loan->markReturned();
+        if (!loan->getIsReturned())
+        {
+            result.status = ServiceStatus::InvalidState;
+            return result;
+        }
+        activeLoans.remove(*loan, loan - loans.data());
+
+        result.loanId = loan->getLoanId();
+        result.copyNumber = loan->getCopyNumber();
+        result.dueDate = loan->getDueDate();
+        result.renewalCount = loan->getRenewalCount();
+        record = {{"loan", loan->toJson()}};
+    }
+
+    // The loan held one checkout, so this checkin always has a copy to put back
+    Resource *resource = findResource(resourceId);
+    uint64_t stateWord = 0;
+    bool checkedIn = resource && resource->checkin(stateWord);
+
+    lock_guard<mutex> resourceShard(resourceLocks.forKey(resourceId));
+    if (checkedIn)
+        publishState(resourceId, *resource, stateWord, record);
+    if (!logMutation("return", std::move(record)))
+        result.status = ServiceStatus::StorageError;
+    return result;
+}
+
+LoanResult LibraryService::renewLoan(const string &userId, const string &resourceId)
+{
+    LoanResult result;
+    lock_guard<mutex> userShard(userLocks.forKey(userId));
+    json record;
+    {
+        // Exclusive: listings copy loans under the shared lock
+        unique_lock<shared_mutex> loansLock(loansMutex);
+        Loan *loan = findActiveLoan(userId, resourceId);
+        if (!loan)
+        {
+            result.status = ServiceStatus::LoanNotFound;
+            return result;
+        }
+
+        result.loanId = loan->getLoanId();
+        result.copyNumber = loan->getCopyNumber();
+        if (!loan->renew())
+        {
+            result.status = ServiceStatus::RenewalRefused;
+            return result;
+        }
+        result.dueDate = loan->getDueDate();
+        result.renewalCount = loan->getRenewalCount();
+        record = {{"loan", loan->toJson()}};
+    }
+    if (!logMutation("renew", std::move(record)))
+        result.status = ServiceStatus::StorageError;
+    return result;
+}
+
+vector<Loan> LibraryService::activeLoansFor(const string &userId) const
+{
+    shared_lock<shared_mutex> lock(loansMutex);
+    vector<Loan> result;
+    for (size_t pos : activeLoans.activeForUser(userId))
+        result.push_back(loans[pos]);
+    return result;
+}
+
+vector<Loan> LibraryService::allActiveLoans() const
+{
+    shared_lock<shared_mutex> lock(loansMutex);
+    vector<Loan> result;
+    for (const auto &loan : loans)
+    {
+        if (!loan.getIsReturned())
+            result.push_back(loan);
+    }
+    return result;
+}
+
+ServiceStatus LibraryService::checkOverdueLoans(const string &actorId, vector<Loan> &overdue)
+{
+    overdue.clear();
+    if (!isAdmin(actorId))
+        return ServiceStatus::PermissionDenied;
+
+    {
+        shared_lock<shared_mutex> lock(loansMutex);
+        for (const auto &loan : loans)
+        {
+            if (loan.isOverdue())
+                overdue.push_back(loan);
+        }
+    }
+
+    for (const auto &loan : overdue)
+    {
+        string notificationId;
+        addNotification(loan.getUserId(),
+                        "Your loan " + loan.getLoanId() + " for resource " + loan.getResourceId() +
+                            " is overdue. Please return it as soon as possible.",
+                        notificationId);
+    }
+    return ServiceStatus::Ok;
+}
+
+// Reservations
+ServiceResult LibraryService::makeReservation(const string &userId, const string &resourceId)
+{
+    ServiceResult result;
+    if (!hasUser(userId))
+    {
+        result.status = ServiceStatus::UserNotFound;
+        return result;
+    }
+
+    lock_guard<mutex> userShard(userLocks.forKey(userId));
+    json record;
+    {
+        shared_lock<shared_mutex> catalogLock(catalogMutex);
+        Resource *resource = findResource(resourceId);
+        if (!resource)
+        {
+            result.status = ServiceStatus::ResourceNotFound;
+            return result;
+        }
+        if (resource->getAvailable())
+        {
+            result.status = ServiceStatus::AlreadyAvailable;
+            return result;
+        }
+
+        lock_guard<mutex> resourceShard(resourceLocks.forKey(resourceId));
+        Reservation newReservation(generateId("RSV"), userId, resourceId, time(nullptr));
+        unique_lock<shared_mutex> reservationsLock(reservationsMutex);
+        reservations.push_back(newReservation);
+        reservationRegistry.add(newReservation.getReservationId(), reservations.size() - 1);
+        result.id = newReservation.getReservationId();
+        record = {{"reservation", newReservation.toJson()}};
+    }
+    if (!logMutation("reserve", std::move(record)))
+        result.status = ServiceStatus::StorageError;
+    return result;
+}
+
+// Reservations are changed under the shard of their resource, which is only
+// known after a lookup
+bool LibraryService::reservationResource(const string &reservationId, string &resourceId) const
+{
+    shared_lock<shared_mutex> lock(reservationsMutex);
+    size_t pos = reservationRegistry.lookup(reservationId);
+    if (pos == Registry::noPosition)
+        return false;
+    resourceId = reservations[pos].getResourceId();
+    return true;
+}
+
+// Users cancel their own reservations; staff may cancel any
+ServiceResult LibraryService::cancelReservation(const string &userId, const string &reservationId)
+{
+    ServiceResult result;
+    result.id = reservationId;
+
+    string resourceId;
+    if (!reservationResource(reservationId, resourceId))
+    {
+        result.status = ServiceStatus::ReservationNotFound;
+        return result;
+    }
+    bool staff = isAdmin(userId);
+
+    lock_guard<mutex> shard(resourceLocks.forKey(resourceId));
+    json record;
+    {
+        unique_lock<shared_mutex> lock(reservationsMutex);
+        Reservation *reservation = findReservation(reservationId);
+        if (reservation->getUserId() != userId && !staff)
+        {
+            result.status = ServiceStatus::PermissionDenied;
+            return result;
+        }
+        if (!reservation->isPending())
+        {
+            result.status = ServiceStatus::InvalidState;
+            return result;
+        }
+
+        reservation->cancel();
+        record = {{"reservation", reservation->toJson()}};
+    }
+    if (!logMutation("reserve", std::move(record)))
+        result.status = ServiceStatus::StorageError;
+    return result;
+}
+
+// The resource must be back on the shelf; its holder is told it is ready
+ServiceResult LibraryService::fulfillReservation(const string &actorId, const string &reservationId)
+{
+    ServiceResult result;
+    result.id = reservationId;
+    if (!isAdmin(actorId))
+    {
+        result.status = ServiceStatus::PermissionDenied;
+        return result;
+    }
+
+    string resourceId;
+    if (!reservationResource(reservationId, resourceId))
+    {
+        result.status = ServiceStatus::ReservationNotFound;
+        return result;
+    }
+
+    json record;
+    string holder, message;
+    {
+        shared_lock<shared_mutex> catalogLock(catalogMutex);
+        lock_guard<mutex> shard(resourceLocks.forKey(resourceId));
+        unique_lock<shared_mutex> reservationsLock(reservationsMutex);
+        Reservation *reservation = findReservation(reservationId);
+        if (!reservation->isPending())
+        {
+            result.status = ServiceStatus::InvalidState;
+            return result;
+        }
+
+        Resource *resource = findResource(resourceId);
+        if (!resource)
+        {
+            result.status = ServiceStatus::ResourceNotFound;
+            return result;
+        }
+        if (!resource->getAvailable())
+        {
+            result.status = ServiceStatus::NotAvailable;
+            return result;
+        }
+
+        reservation->fulfill();
+        record = {{"reservation", reservation->toJson()}};
+        holder = reservation->getUserId();
+        message = "Your reservation " + reservationId + " for \"" + resource->getTitle() + "\" is ready for pickup.";
+    }
+    if (!logMutation("reserve", std::move(record)))
+        result.status = ServiceStatus::StorageError;
+
+    string notificationId;
+    if (addNotification(holder, message, notificationId) == ServiceStatus::StorageError)
+        result.status = ServiceStatus::StorageError;
+    return result;
+}
+
+vector<Reservation> LibraryService::pendingReservationsFor(const string &userId) const
+{
+    vector<Reservation> result;
+    IdInterner::Handle user = IdInterner::global().find(userId);
+    shared_lock<shared_mutex> lock(reservationsMutex);
+    for (const auto &reservation : reservations)
+    {
+        if (reservation.getUserHandle() == user && reservation.isPending())
+            result.push_back(reservation);
+    }
+    return result;
+}
+
+vector<Reservation> LibraryService::allPendingReservations() const
+{
+    vector<Reservation> result;
+    shared_lock<shared_mutex> lock(reservationsMutex);
+    for (const auto &reservation : reservations)
+    {
+        if (reservation.isPending())
+            result.push_back(reservation);
+    }
+    return result;
+}
+
+// Notifications
+ServiceResult LibraryService::sendNotification(const string &actorId, const string &userId, const string &message)
+{
+    ServiceResult result;
+    if (!isAdmin(actorId))
+    {
+        result.status = ServiceStatus::PermissionDenied;
+        return result;
+    }
+    if (!hasUser(userId))
+    {
+        result.status = ServiceStatus::UserNotFound;
+        return result;
+    }
+
+    result.status = addNotification(userId, message, result.id);
+    return result;
+}
+
+// A notification is changed under the shard of the user it belongs to
+ServiceResult LibraryService::markNotificationRead(const string &userId, const string &notificationId)
+{
+    ServiceResult result;
+    result.id = notificationId;
+
+    lock_guard<mutex> shard(userLocks.forKey(userId));
+    json record;
+    {
+        unique_lock<shared_mutex> lock(notificationsMutex);
+        Notification *notification = findNotification(notificationId);
+        if (!notification)
+        {
+            result.status = ServiceStatus::NotificationNotFound;
+            return result;
+        }
+        if (notification->getUserId() != userId)
+        {
+            result.status = ServiceStatus::PermissionDenied;
+            return result;
+        }
+        if (notification->isRead())
+            return result;
+
+        notification->markRead();
+        record = {{"notification", notification->toJson()}};
+    }
+    if (!logMutation("notify", std::move(record)))
+        result.status = ServiceStatus::StorageError;
+    return result;
+}
+
+vector<Notification> LibraryService::notificationsFor(const string &userId) const
+{
+    vector<Notification> result;
+    IdInterner::Handle user = IdInterner::global().find(userId);
+    shared_lock<shared_mutex> lock(notificationsMutex);
+    for (const auto &notification : notifications)
+    {
+        if (notification.getUserHandle() == user)
+            result.push_back(notification);
+    }
+    return result;
+}
+
+// Events
+ServiceResult LibraryService::createEvent(const string &actorId, const string &title, const string &description,
+                                          time_t eventDate, const string &location)
+{
+    ServiceResult result;
+    if (!isAdmin(actorId))
+    {
+        result.status = ServiceStatus::PermissionDenied;
+        return result;
+    }
+
+    try
+    {
+        LibraryEvent event(generateId("EVT"), title, description, eventDate, location);
+        {
+            unique_lock<shared_mutex> lock(eventsMutex);
+            events.push_back(event);
+            eventRegistry.add(event.getEventId(), events.size() - 1);
+        }
+        result.id = event.getEventId();
+        if (!logMutation("event", {{"event", event.toJson()}}))
+            result.status = ServiceStatus::StorageError;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Warning: Event rejected: " << e.what() << endl;
+        result.status = ServiceStatus::InvalidArgument;
+    }
+    return result;
+}
+
+vector<LibraryEvent> LibraryService::allEvents() const
+{
+    shared_lock<shared_mutex> lock(eventsMutex);
+    return events;
+}
+
+// Statistics
+SnapshotMetrics LibraryService::snapshotMetrics() const
+{
+    return snapshotter.metrics();
+}
+
+size_t LibraryService::pendingMutations() const
+{
+    return mutationsSinceSnapshot;
+}
+
+const LoadReport &LibraryService::loadReport() const
+{
+    return report;
+}
+
+const char *LibraryService::statusMessage(ServiceStatus status)
+{
+    switch (status)
+    {
+    case ServiceStatus::Ok:
+        return "OK";
+    case ServiceStatus::UserNotFound:
+        return "User not found!";
+    case ServiceStatus::ResourceNotFound:
+        return "Resource not found!";
+    case ServiceStatus::LoanNotFound:
+        return "No active loan found for this resource!";
+    case ServiceStatus::ReservationNotFound:
+        return "Reservation not found!";
+    case ServiceStatus::NotificationNotFound:
+        return "Notification not found!";
+    case ServiceStatus::PermissionDenied:
+        return "You are not allowed to do that!";
+    case ServiceStatus::NotAvailable:
+        return "Resource is not available for borrowing!";
+    case ServiceStatus::AlreadyAvailable:
+        return "Resource is available. You can borrow it directly!";
+    case ServiceStatus::AlreadyBorrowed:
+        return "You already have this resource borrowed!";
+    case ServiceStatus::ResourceOnLoan:
+        return "Resource is currently on loan and cannot be removed!";
+    case ServiceStatus::RenewalRefused:
+        return "Cannot renew loan. Maximum renewals reached.";
+    case ServiceStatus::InvalidState:
+        return "That is no longer possible in its current state!";
+    case ServiceStatus::InvalidArgument:
+        return "Invalid input!";
+    case ServiceStatus::StorageError:
+        return "The change was made but could not be saved yet!";
+    }
+    return "Unknown error";
+}
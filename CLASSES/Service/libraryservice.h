@@ -0,0 +1,241 @@
+#ifndef LIBRARYSERVICE_H
+#define LIBRARYSERVICE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <ctime>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include "User/user.h"
+#include "Resource/resource.h"
+#include "Loan/loan.h"
+#include "Reservation/reservation.h"
+#include "Notification/notification.h"
+#include "LibraryEvent/libraryevent.h"
+#include "Persistence/wal.h"
+#include "Persistence/snapshotter.h"
+#include "Registry/registry.h"
+#include "Registry/loanindex.h"
+#include "Registry/textindex.h"
+#include "Registry/trigramindex.h"
+#include "Registry/catalogcolumns.h"
+#include "lockshards.h"
+using namespace std;
+
+enum class ServiceStatus
+{
+    Ok,
+    UserNotFound,
+    ResourceNotFound,
+    LoanNotFound,
+    ReservationNotFound,
+    NotificationNotFound,
+    PermissionDenied,    // the acting user may not do this
+    NotAvailable,        // the resource is on loan
+    AlreadyAvailable,    // reserving a resource that can be borrowed
+    AlreadyBorrowed,     // the user already has this resource
+    ResourceOnLoan,      // removing a resource that is on loan
+    RenewalRefused,      // renewal limit reached, loan overdue, ...
+    InvalidState,        // e.g. cancelling a reservation that is not pending
+    InvalidArgument,     // the entity rejected a field value
+    StorageError         // made but not yet durable; see commit()
+};
+
+// Outcome of a mutation. id is the created or changed entity.
+struct ServiceResult
+{
+    ServiceStatus status = ServiceStatus::Ok;
+    string id;
+
+    bool ok() const;
+};
+
+struct LoanResult
+{
+    ServiceStatus status = ServiceStatus::Ok;
+    string loanId;
+    int copyNumber = 0;
+    time_t dueDate = 0;
+    int renewalCount = 0;
+
+    bool ok() const;
+};
+
+// What happened while the service opened its data file
+struct LoadReport
+{
+    bool loaded = false;     // the data file existed and was read
+    size_t recovered = 0;    // log records replayed on top of it
+    size_t skipped = 0;      // log records that could not be applied
+    bool createdAdmin = false;
+};
+
+// Non-interactive operations on the library. Every call takes the IDs it
+// acts on and reports the outcome as a status code; nothing reads stdin or
+// writes stdout, so any front end (the console menu, a server, a benchmark)
+// can drive it.
+// Mutations are appended to the write-ahead log and become durable at the
+// next commit(), so callers can batch several operations into one fsync.
+// Query callbacks receive references that are only valid during the call.
+// Safe to call from several threads. Work on one user is serialized by a
+// lock shard picked from its ID; borrowers race for a resource through its
+// atomic state word, so operations on unrelated users run in parallel and
+// queries only take shared locks. Callbacks run under a shared lock and must
+// not call mutating methods.
+class LibraryService
+{
+private:
+    vector<User> users;
+    vector<unique_ptr<Resource>> resources;
+    vector<Loan> loans;
+    vector<Reservation> reservations;
+    vector<Notification> notifications;
+    vector<LibraryEvent> events;
+
+    // ID -> position lookups, kept in sync with the vectors above
+    Registry userRegistry;
+    Registry resourceRegistry;
+    Registry loanRegistry;
+    Registry reservationRegistry;
+    Registry notificationRegistry;
+    Registry eventRegistry;
+    LoanIndex activeLoans;
+    TextIndex textIndex;
+    TrigramIndex trigramIndex;
+    CatalogColumns catalog; // columnar copy of resources for filtering
+
+    // Mutations since the last snapshot, replayed on startup. Thread-safe;
+    // its own lock is the innermost and is never held across an fsync.
+    WriteAheadLog wal;
+
+    // Background snapshots. Each logged change adds the (section, id) of the
+    // entities it touched to changes, so a capture copies only those.
+    atomic<size_t> mutationsSinceSnapshot;
+    mutex changesMutex; // innermost, held only to add to or swap out changes
+    vector<pair<string, string>> changes;
+    bool captureAll; // the data file did not load; the first capture replaces it
+    Snapshotter snapshotter;
+    LoadReport report;
+    atomic<bool> closed;
+
+    // Loans, and the notifications of a user, change under the user's shard.
+    // A resource's shard is held only by the winner of a checkout or checkin
+    // while it publishes the new state, and by reservation changes.
+    // Collection locks guard the vectors and their indexes: shared while
+    // elements are read, exclusive while one is added, changed or removed,
+    // or while changed ones are copied for a snapshot. Resource state words
+    // change under the shared catalog lock; they are atomic. Locks are taken
+    // in this order: user shard, users, catalog, resource shard, loans,
+    // reservations, notifications, events.
+    LockShards userLocks;
+    LockShards resourceLocks;
+    mutable shared_mutex usersMutex;
+    mutable shared_mutex catalogMutex; // resources and their indexes
+    mutable shared_mutex loansMutex;   // loans, loanRegistry and activeLoans
+    mutable shared_mutex reservationsMutex;
+    mutable shared_mutex notificationsMutex;
+    mutable shared_mutex eventsMutex; // events and eventRegistry
+    static const int SNAPSHOT_INTERVAL_SECONDS = 300;
+    static const size_t SNAPSHOT_DIRTY_LIMIT = 500;
+
+    const string DATA_FILE;
+    const string LOG_FILE;
+    const string LOG_ARCHIVE; // log records covered by captures not saved yet
+
+    // Helper methods. The find helpers expect the matching collection lock.
+    string generateId(const string &prefix);
+    bool hasUser(const string &userId) const;
+    User *findUser(const string &userId);
+    const User *findUser(const string &userId) const;
+    Resource *findResource(const string &resourceId);
+    Loan *findActiveLoan(const string &userId, const string &resourceId);
+    int freeCopy(const string &resourceId) const;
+    Reservation *findReservation(const string &reservationId);
+    bool reservationResource(const string &reservationId, string &resourceId) const;
+    Notification *findNotification(const string &notificationId);
+    void rebuildIndexes();
+    void indexResource(size_t pos);
+    void eraseResource(size_t pos);
+    void observeIds();
+    void publishState(const string &resourceId, const Resource &resource, uint64_t stateWord, json &record);
+    void reconcileHoldings();
+    ServiceStatus addNotification(const string &userId, const string &message, string &notificationId);
+
+    // Write-ahead log
+    bool logMutation(const string &op, json record);
+    void applyLogRecord(const json &record);
+    void noteChanges(const json &record);
+    unique_ptr<SnapshotState> captureChanges();
+    void loadData();
+
+public:
+    // dataFile may be a .json file or a .lsm store directory
+    LibraryService(const string &dataFile = "library_data.json");
+    ~LibraryService();
+
+    LibraryService(const LibraryService &) = delete;
+    LibraryService &operator=(const LibraryService &) = delete;
+
+    // Makes logged mutations durable. On false the changes stay made and
+    // logged, and the next commit that succeeds makes them durable; they are
+    // lost only if the process stops first. Callers must not repeat the
+    // operations. Snapshots are taken by their own thread, not here.
+    bool commit();
+    // Stops background snapshots and saves; later calls do nothing. No other
+    // call may be in progress or follow it.
+    bool close();
+
+    // Users
+    ServiceResult registerUser(const string &name, const string &email, UserRole role);
+    bool getUser(const string &userId, User &user) const;
+    // Library admins and employees count as staff
+    bool isAdmin(const string &userId) const;
+
+    // Resources (adding and removing needs a staff actor)
+    ServiceResult addResource(const string &actorId, unique_ptr<Resource> resource);
+    ServiceResult removeResource(const string &actorId, const string &resourceId);
+    size_t searchResources(const string &keyword, const function<void(const Resource &)> &visit) const;
+    size_t filterResources(const CatalogFilter &filter, const function<void(const Resource &)> &visit) const;
+    size_t forEachResource(const function<void(const Resource &)> &visit) const;
+    // One page of the catalog: at most limit resources from position offset.
+    // Returns the catalog size.
+    size_t forEachResource(size_t offset, size_t limit, const function<void(const Resource &)> &visit) const;
+
+    // Loans
+    LoanResult borrowResource(const string &userId, const string &resourceId);
+    LoanResult returnResource(const string &userId, const string &resourceId);
+    LoanResult renewLoan(const string &userId, const string &resourceId);
+    vector<Loan> activeLoansFor(const string &userId) const;
+    vector<Loan> allActiveLoans() const;
+    // Notifies the borrower of every overdue loan and returns those loans
+    ServiceStatus checkOverdueLoans(const string &actorId, vector<Loan> &overdue);
+
+    // Reservations
+    ServiceResult makeReservation(const string &userId, const string &resourceId);
+    ServiceResult cancelReservation(const string &userId, const string &reservationId);
+    ServiceResult fulfillReservation(const string &actorId, const string &reservationId);
+    vector<Reservation> pendingReservationsFor(const string &userId) const;
+    vector<Reservation> allPendingReservations() const;
+
+    // Notifications
+    ServiceResult sendNotification(const string &actorId, const string &userId, const string &message);
+    ServiceResult markNotificationRead(const string &userId, const string &notificationId);
+    vector<Notification> notificationsFor(const string &userId) const;
+
+    // Events
+    ServiceResult createEvent(const string &actorId, const string &title, const string &description,
+                              time_t eventDate, const string &location);
+    vector<LibraryEvent> allEvents() const;
+
+    // Statistics
+    SnapshotMetrics snapshotMetrics() const;
+    size_t pendingMutations() const;
+    const LoadReport &loadReport() const;
+
+    static const char *statusMessage(ServiceStatus status);
+};
+
+#endif
@@ -0,0 +1,25 @@
+#include "lockshards.h"
+#include <functional>
+
+LockShards::LockShards(size_t count)
+    : count(1)
+{
+    while (this->count < count)
+        this->count <<= 1;
+    shards.reset(new Shard[this->count]);
+}
+
+size_t LockShards::indexOf(const string &key) const
+{
+    return hash<string>()(key) & (count - 1);
+}
+
+mutex &LockShards::forKey(const string &key)
+{
+    return shards[indexOf(key)].lock;
+}
+
+size_t LockShards::size() const
+{
+    return count;
+}
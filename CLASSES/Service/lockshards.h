@@ -0,0 +1,35 @@
+#ifndef LOCKSHARDS_H
+#define LOCKSHARDS_H
+#include <string>
+#include <memory>
+#include <mutex>
+using namespace std;
+
+// Fixed set of mutexes picked by hashing a key. Operations on keys in
+// different shards run in parallel; keys that share a shard take turns.
+// Each shard sits on its own cache line so neighbouring locks do not
+// contend for the same line.
+class LockShards
+{
+private:
+    struct alignas(64) Shard
+    {
+        mutex lock;
+    };
+
+    unique_ptr<Shard[]> shards;
+    size_t count; // power of two
+
+public:
+    // Constructor/Destructor
+    explicit LockShards(size_t count = 64);
+    ~LockShards() = default;
+    LockShards(const LockShards &) = delete;
+    LockShards &operator=(const LockShards &) = delete;
+
+    size_t indexOf(const string &key) const;
+    mutex &forKey(const string &key);
+    size_t size() const;
+};
+
+#endif
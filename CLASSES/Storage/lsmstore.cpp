@@ -0,0 +1,475 @@
+#include "lsmstore.h"
+#include "Persistence/atomicfile.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+
+namespace fs = std::filesystem;
+
+LsmStore::LsmStore()
+    : nextTableNumber(1), memtableLimit(4 * 1024 * 1024), compactionTrigger(4), opened(false), stopping(false)
+{
+}
+
+LsmStore::~LsmStore()
+{
+    close();
+}
+
+string LsmStore::tablePath(uint64_t number) const
+{
+    ostringstream name;
+    name << setw(6) << setfill('0') << number << ".sst";
+    return (fs::path(directory) / name.str()).string();
+}
+
+string LsmStore::manifestPath() const
+{
+    return (fs::path(directory) / "MANIFEST").string();
+}
+
+// The manifest lists live tables newest first; it is replaced atomically
+bool LsmStore::writeManifest() const
+{
+    json manifest;
+    manifest["nextTable"] = nextTableNumber;
+    manifest["tables"] = json::array();
+    for (const auto &table : tables)
+        manifest["tables"].push_back(fs::path(table->getPath()).filename().string());
+
+    string tempPath = AtomicFile::tempPath(manifestPath());
+    {
+        ofstream ofs(tempPath, ios::trunc);
+        ofs << manifest.dump();
+        if (!ofs)
+            return false;
+    }
+
+    return AtomicFile::commit(tempPath, manifestPath(), 0);
+}
+
+bool LsmStore::loadManifest()
+{
+    tables.clear();
+    ifstream ifs(manifestPath());
+    if (!ifs.is_open())
+        return true; // new store
+
+    try
+    {
+        json manifest;
+        ifs >> manifest;
+        nextTableNumber = manifest.at("nextTable").get<uint64_t>();
+        for (const auto &name : manifest.at("tables"))
+        {
+            auto table = SSTable::open((fs::path(directory) / name.get<string>()).string());
+            if (!table)
+                throw runtime_error("Cannot open table " + name.get<string>());
+            tables.push_back(table);
+        }
+        return true;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Error: Corrupt store manifest: " << e.what() << endl;
+        return false;
+    }
+}
+
+bool LsmStore::open(const string &directory, size_t memtableLimit, size_t compactionTrigger)
+{
+    close();
+    this->directory = directory;
+    this->memtableLimit = memtableLimit;
+    this->compactionTrigger = max<size_t>(compactionTrigger, 2);
+
+    error_code ec;
+    fs::create_directories(directory, ec);
+    if (ec || !loadManifest())
+        return false;
+
+    // Writes since the last flush are only in the log
+    string logPath = (fs::path(directory) / "memtable.wal").string();
+    WriteAheadLog::replay(logPath, [this](const json &record)
+                          {
+                              if (record.value("d", false))
+                                  memtable.remove(record.at("k").get<string>());
+                              else
+                                  memtable.put(record.at("k").get<string>(), record.at("v").get<string>()); });
+    if (!wal.open(logPath))
+        return false;
+
+    stopping = false;
+    opened = true;
+    compactor = thread(&LsmStore::compactorLoop, this);
+    return true;
+}
+
+// A clean close writes the memtable out as a table, so the next open has no
+// log to replay. Merging is left to the background thread.
+void LsmStore::close()
+{
+    if (!opened)
+        return;
+
+    {
+        lock_guard<mutex> lock(stateMutex);
+        stopping = true;
+    }
+    compactorWake.notify_all();
+    if (compactor.joinable())
+        compactor.join();
+
+    bool flushed;
+    {
+        lock_guard<mutex> lock(stateMutex);
+        flushed = flushLocked();
+    }
+    if (!flushed)
+        cerr << "Warning: Cannot flush store memtable, its writes stay in the log: " << directory << endl;
+
+    wal.close();
+    tables.clear();
+    memtable.clear();
+    opened = false;
+}
+
+bool LsmStore::isOpen() const
+{
+    return opened;
+}
+
+bool LsmStore::put(const string &key, const string &value)
+{
+    lock_guard<mutex> lock(stateMutex);
+    if (!opened || !wal.append(json{{"k", key}, {"v", value}}))
+        return false;
+
+    memtable.put(key, value);
+    return memtable.approximateBytes() < memtableLimit || flushLocked();
+}
+
+bool LsmStore::remove(const string &key)
+{
+    lock_guard<mutex> lock(stateMutex);
+    if (!opened || !wal.append(json{{"k", key}, {"d", true}}))
+        return false;
+
+    memtable.remove(key);
+    return memtable.approximateBytes() < memtableLimit || flushLocked();
+}
+
+bool LsmStore::sync()
+{
+    lock_guard<mutex> lock(stateMutex);
+    return wal.commit();
+}
+
+bool LsmStore::flush()
+{
+    lock_guard<mutex> lock(stateMutex);
+    return flushLocked();
+}
+
+// Writes the memtable as the newest table; called with stateMutex held
+bool LsmStore::flushLocked()
+{
+    if (memtable.empty())
+        return wal.commit();
+
+    uint64_t number = nextTableNumber++;
+    string path = tablePath(number);
+    auto it = memtable.begin();
+    bool written = SSTable::write(path, [&](SSTable::Entry &entry)
+                                  {
+                                      if (it == memtable.end())
+                                          return false;
+                                      entry.key = it->first;
+                                      entry.value = it->second;
+                                      ++it;
+                                      return true; });
+    auto table = written ? SSTable::open(path) : nullptr;
+    if (!table)
+        return false;
+
+    tables.insert(tables.begin(), table);
+    if (!writeManifest())
+    {
+        // The table was never committed; the memtable and log still hold its writes
+        tables.erase(tables.begin());
+        error_code ec;
+        fs::remove(path, ec);
+        return false;
+    }
+
+    // The table now holds everything the log did
+    memtable.clear();
+    wal.reset();
+
+    if (tables.size() >= compactionTrigger)
+        compactorWake.notify_one();
+    return true;
+}
+
+// Finds the oldest run of compactionTrigger adjacent tables whose sizes are
+// within TIER_RATIO of each other, so a merge rewrites one size tier rather
+// than the whole store. Tables below SMALL_TABLE_ENTRIES count as that size.
+// Called with stateMutex held.
+bool LsmStore::pickRun(size_t &first, size_t &count) const
+{
+    auto tierSize = [this](size_t i)
+    {
+        uint64_t entries = tables[i]->getEntryCount();
+        return entries < SMALL_TABLE_ENTRIES ? SMALL_TABLE_ENTRIES : entries;
+    };
+
+    for (size_t oldest = tables.size(); oldest-- > 0;)
+    {
+        uint64_t low = tierSize(oldest), high = low;
+        size_t n = 1;
+        while (n < compactionTrigger && oldest >= n)
+        {
+            uint64_t size = tierSize(oldest - n);
+            low = min(low, size);
+            high = max(high, size);
+            if (high > low * TIER_RATIO)
+                break;
+            ++n;
+        }
+        if (n == compactionTrigger)
+        {
+            first = oldest + 1 - n;
+            count = n;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Merges one size tier, or every table present when it starts if all is
+// set, into a single table in their place. Tables flushed while the merge
+// runs are newer and stay in front of the result.
+bool LsmStore::compactOnce(bool all)
+{
+    lock_guard<mutex> compactionLock(compactionMutex);
+
+    vector<shared_ptr<SSTable>> inputs;
+    uint64_t number;
+    bool includesOldest;
+    {
+        lock_guard<mutex> lock(stateMutex);
+        size_t first = 0, count = tables.size();
+        if (all ? count < 2 : !pickRun(first, count))
+            return true;
+        inputs.assign(tables.begin() + first, tables.begin() + first + count);
+        includesOldest = first + count == tables.size();
+        number = nextTableNumber++;
+    }
+
+    // k-way merge; on equal keys the newest table (lowest index) wins
+    vector<SSTable::Iterator> iterators;
+    for (const auto &table : inputs)
+        iterators.emplace_back(table);
+
+    string path = tablePath(number);
+    bool written = SSTable::write(path, [&](SSTable::Entry &entry)
+                                  {
+                                      int best = -1;
+                                      for (size_t i = 0; i < iterators.size(); i++)
+                                      {
+                                          if (iterators[i].valid() &&
+                                              (best < 0 || iterators[i].entry().key < iterators[best].entry().key))
+                                              best = static_cast<int>(i);
+                                      }
+                                      if (best < 0)
+                                          return false;
+
+                                      entry = iterators[best].entry();
+                                      for (auto &it : iterators)
+                                      {
+                                          while (it.valid() && it.entry().key == entry.key)
+                                              it.next();
+                                      }
+                                      return true; },
+                                  includesOldest); // with no older table left, tombstones can go
+    // A block that could not be read would be missing from the result;
+    // keep the inputs rather than lose its keys
+    bool complete = all_of(iterators.begin(), iterators.end(), [](const SSTable::Iterator &it)
+                           { return it.ok(); });
+    auto merged = written && complete ? SSTable::open(path) : nullptr;
+    if (!merged)
+    {
+        error_code ec;
+        fs::remove(path, ec);
+        return false;
+    }
+
+    {
+        lock_guard<mutex> lock(stateMutex);
+        // Only flushes ran meanwhile, and they add in front, so the inputs
+        // are still adjacent
+        size_t pos = find(tables.begin(), tables.end(), inputs.front()) - tables.begin();
+        tables.erase(tables.begin() + pos, tables.begin() + pos + inputs.size());
+        tables.insert(tables.begin() + pos, merged);
+        if (!writeManifest())
+        {
+            // The manifest still lists the inputs, so keep reading those
+            tables.erase(tables.begin() + pos);
+            tables.insert(tables.begin() + pos, inputs.begin(), inputs.end());
+            error_code ec;
+            fs::remove(path, ec);
+            return false;
+        }
+    }
+
+    for (const auto &table : inputs)
+    {
+        error_code ec;
+        fs::remove(table->getPath(), ec);
+    }
+    return true;
+}
+
+// The tables stay over the trigger after a failed merge, so the next
+// attempt waits, twice as long after each failure in a row
+void LsmStore::compactorLoop()
+{
+    const chrono::seconds firstBackoff(1), maxBackoff(300);
+    chrono::seconds backoff(0);
+
+    size_t first, count;
+    unique_lock<mutex> lock(stateMutex);
+    while (!stopping)
+    {
+        compactorWake.wait(lock, [&]
+                           { return stopping || pickRun(first, count); });
+        if (stopping)
+            break;
+
+        lock.unlock();
+        bool merged = compactOnce(false);
+        lock.lock();
+
+        if (merged)
+        {
+            backoff = chrono::seconds(0);
+            continue;
+        }
+        backoff = (backoff.count() == 0) ? firstBackoff : min(backoff * 2, maxBackoff);
+        cerr << "Warning: Store compaction failed, retrying in " << backoff.count() << "s." << endl;
+        compactorWake.wait_for(lock, backoff, [this]
+                               { return stopping; });
+    }
+}
+
+bool LsmStore::compact()
+{
+    return compactOnce(true);
+}
+
+bool LsmStore::get(const string &key, string &value, bool &found) const
+{
+    found = false;
+    vector<shared_ptr<SSTable>> snapshot;
+    {
+        lock_guard<mutex> lock(stateMutex);
+        const StoreValue *entry = memtable.find(key);
+        if (entry)
+        {
+            found = !entry->deleted;
+            if (found)
+                value = entry->data;
+            return true;
+        }
+        snapshot = tables;
+    }
+
+    // An unreadable table may hold a newer value than the older ones
+    for (const auto &table : snapshot)
+    {
+        StoreValue stored;
+        bool inTable;
+        if (!table->get(key, stored, inTable))
+            return false;
+        if (inTable)
+        {
+            found = !stored.deleted;
+            if (found)
+                value = stored.data;
+            return true;
+        }
+    }
+    return true;
+}
+
+bool LsmStore::scan(const string &prefix, const function<void(const string &, const string &)> &visit) const
+{
+    // Copy the matching memtable range so the lock is not held while visiting
+    vector<SSTable::Entry> recent;
+    vector<shared_ptr<SSTable>> snapshot;
+    {
+        lock_guard<mutex> lock(stateMutex);
+        for (auto it = memtable.lowerBound(prefix); it != memtable.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+            recent.push_back({it->first, it->second});
+        snapshot = tables;
+    }
+
+    vector<SSTable::Iterator> iterators;
+    for (const auto &table : snapshot)
+        iterators.emplace_back(table, prefix);
+
+    auto inRange = [&prefix](const string &key)
+    { return key.compare(0, prefix.size(), prefix) == 0; };
+
+    size_t recentPos = 0;
+    while (true)
+    {
+        // Smallest key across sources; the memtable shadows every table
+        const SSTable::Entry *best = nullptr;
+        if (recentPos < recent.size())
+            best = &recent[recentPos];
+        for (auto &it : iterators)
+        {
+            // Stop before visiting a key the unreadable block might shadow
+            if (!it.ok())
+                return false;
+            if (it.valid() && inRange(it.entry().key) && (!best || it.entry().key < best->key))
+                best = &it.entry();
+        }
+        if (!best)
+            break;
+
+        SSTable::Entry current = *best;
+        if (recentPos < recent.size() && recent[recentPos].key == current.key)
+            current = recent[recentPos++];
+        else
+        {
+            for (auto &it : iterators)
+            {
+                if (it.valid() && it.entry().key == current.key)
+                {
+                    current = it.entry();
+                    break;
+                }
+            }
+        }
+        for (auto &it : iterators)
+        {
+            while (it.valid() && it.entry().key == current.key)
+                it.next();
+        }
+
+        if (!current.value.deleted)
+            visit(current.key, current.value.data);
+    }
+    return true;
+}
+
+size_t LsmStore::tableCount() const
+{
+    lock_guard<mutex> lock(stateMutex);
+    return tables.size();
+}
@@ -0,0 +1,89 @@
+#ifndef LSMSTORE_H
+#define LSMSTORE_H
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include "memtable.h"
+#include "sstable.h"
+#include "Persistence/wal.h"
+using namespace std;
+
+// Log-structured merge key-value store.
+// Writes go to a write-ahead log and a sorted memtable. When the memtable
+// grows past its limit it is written out as an immutable SSTable. A
+// background thread merges runs of tables of similar size, so a large old
+// table is only rewritten once enough others have grown to match it.
+// Reads check the memtable, then tables from newest to oldest. close()
+// flushes the memtable, so only a crash leaves writes to replay from the log.
+class LsmStore
+{
+private:
+    string directory;
+    MemTable memtable;
+    WriteAheadLog wal;
+    vector<shared_ptr<SSTable>> tables; // newest first
+    uint64_t nextTableNumber;
+    size_t memtableLimit;
+    size_t compactionTrigger;
+    bool opened;
+
+    mutable mutex stateMutex;
+    mutex compactionMutex;
+    condition_variable compactorWake;
+    thread compactor;
+    bool stopping;
+
+    // Tables in one merge differ in entry count by at most TIER_RATIO;
+    // smaller tables count as SMALL_TABLE_ENTRIES
+    static const uint64_t TIER_RATIO = 4;
+    static const uint64_t SMALL_TABLE_ENTRIES = 4096;
+
+    // Helper methods
+    string tablePath(uint64_t number) const;
+    string manifestPath() const;
+    bool writeManifest() const;
+    bool loadManifest();
+    bool flushLocked();
+    bool pickRun(size_t &first, size_t &count) const;
+    bool compactOnce(bool all);
+    void compactorLoop();
+
+public:
+    // Constructor/Destructor
+    LsmStore();
+    ~LsmStore();
+
+    LsmStore(const LsmStore &) = delete;
+    LsmStore &operator=(const LsmStore &) = delete;
+
+    bool open(const string &directory, size_t memtableLimit = 4 * 1024 * 1024, size_t compactionTrigger = 4);
+    void close();
+    bool isOpen() const;
+
+    // Writes
+    bool put(const string &key, const string &value);
+    bool remove(const string &key);
+    // Makes all writes so far durable
+    bool sync();
+    // Writes the memtable to a table right away
+    bool flush();
+    // Merges all tables into one, waiting for the result
+    bool compact();
+
+    // Reads. Both return false if a table could not be read, rather than
+    // passing over the keys it holds.
+    // found tells whether key has a live value
+    bool get(const string &key, string &value, bool &found) const;
+    // Visits live keys starting with prefix, in key order
+    bool scan(const string &prefix, const function<void(const string &, const string &)> &visit) const;
+
+    size_t tableCount() const;
+};
+
+#endif
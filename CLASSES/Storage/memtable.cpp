@@ -0,0 +1,74 @@
+#include "memtable.h"
+
+MemTable::MemTable() : bytes(0)
+{
+}
+
+StoreValue &MemTable::slot(const string &key)
+{
+    auto it = entries.find(key);
+    if (it == entries.end())
+    {
+        bytes += key.size();
+        it = entries.emplace(key, StoreValue()).first;
+    }
+    return it->second;
+}
+
+void MemTable::put(const string &key, const string &value)
+{
+    StoreValue &entry = slot(key);
+    bytes = bytes - entry.data.size() + value.size();
+    entry.data = value;
+    entry.deleted = false;
+}
+
+void MemTable::remove(const string &key)
+{
+    StoreValue &entry = slot(key);
+    bytes -= entry.data.size();
+    entry.data.clear();
+    entry.deleted = true;
+}
+
+const StoreValue *MemTable::find(const string &key) const
+{
+    auto it = entries.find(key);
+    return (it != entries.end()) ? &it->second : nullptr;
+}
+
+void MemTable::clear()
+{
+    entries.clear();
+    bytes = 0;
+}
+
+size_t MemTable::size() const
+{
+    return entries.size();
+}
+
+size_t MemTable::approximateBytes() const
+{
+    return bytes;
+}
+
+bool MemTable::empty() const
+{
+    return entries.empty();
+}
+
+map<string, StoreValue>::const_iterator MemTable::lowerBound(const string &key) const
+{
+    return entries.lower_bound(key);
+}
+
+map<string, StoreValue>::const_iterator MemTable::begin() const
+{
+    return entries.begin();
+}
+
+map<string, StoreValue>::const_iterator MemTable::end() const
+{
+    return entries.end();
+}
@@ -0,0 +1,46 @@
+#ifndef MEMTABLE_H
+#define MEMTABLE_H
+#include <string>
+#include <map>
+#include <cstddef>
+using namespace std;
+
+// Value stored in the LSM tree; deleted entries are tombstones that shadow
+// older values until compaction drops them.
+struct StoreValue
+{
+    string data;
+    bool deleted = false;
+};
+
+// Sorted in-memory table holding the most recent writes
+class MemTable
+{
+private:
+    map<string, StoreValue> entries;
+    size_t bytes;
+
+    StoreValue &slot(const string &key);
+
+public:
+    // Constructor/Destructor
+    MemTable();
+    ~MemTable() = default;
+
+    void put(const string &key, const string &value);
+    void remove(const string &key);
+    // Returns the entry for key (possibly a tombstone), or nullptr if absent
+    const StoreValue *find(const string &key) const;
+    void clear();
+
+    size_t size() const;
+    size_t approximateBytes() const;
+    bool empty() const;
+
+    // Sorted access, used to flush to disk and to scan ranges
+    map<string, StoreValue>::const_iterator lowerBound(const string &key) const;
+    map<string, StoreValue>::const_iterator begin() const;
+    map<string, StoreValue>::const_iterator end() const;
+};
+
+#endif
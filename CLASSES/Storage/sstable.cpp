@@ -0,0 +1,306 @@
+#include "sstable.h"
+#include "Persistence/atomicfile.h"
+#include "Persistence/wal.h"
+#include <algorithm>
+#include <iostream>
+
+void SSTable::putUint32(string &out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+void SSTable::putUint64(string &out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+uint32_t SSTable::getUint32(const char *in)
+{
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; i--)
+        value = (value << 8) | static_cast<unsigned char>(in[i]);
+    return value;
+}
+
+uint64_t SSTable::getUint64(const char *in)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--)
+        value = (value << 8) | static_cast<unsigned char>(in[i]);
+    return value;
+}
+
+void SSTable::appendRecord(string &block, const string &key, const StoreValue &value)
+{
+    putUint32(block, static_cast<uint32_t>(key.size()));
+    putUint32(block, static_cast<uint32_t>(value.data.size()));
+    block.push_back(value.deleted ? 1 : 0);
+    block += key;
+    block += value.data;
+}
+
+bool SSTable::write(const string &filepath, const function<bool(Entry &)> &next, bool dropTombstones)
+{
+    ofstream ofs(filepath, ios::binary | ios::trunc);
+    if (!ofs.is_open())
+    {
+        cerr << "Error: Cannot create table file: " << filepath << endl;
+        return false;
+    }
+
+    string block;
+    string indexBlock;
+    string lastKey;
+    uint64_t offset = 0;
+    uint64_t count = 0;
+
+    auto flushBlock = [&]()
+    {
+        if (block.empty())
+            return;
+        ofs.write(block.data(), block.size());
+        putUint32(indexBlock, static_cast<uint32_t>(lastKey.size()));
+        indexBlock += lastKey;
+        putUint64(indexBlock, offset);
+        putUint32(indexBlock, static_cast<uint32_t>(block.size()));
+        putUint32(indexBlock, WriteAheadLog::crc32(block.data(), block.size()));
+        offset += block.size();
+        block.clear();
+    };
+
+    Entry entry;
+    while (next(entry))
+    {
+        if (dropTombstones && entry.value.deleted)
+            continue;
+        appendRecord(block, entry.key, entry.value);
+        lastKey = entry.key;
+        ++count;
+        if (block.size() >= BLOCK_SIZE)
+            flushBlock();
+    }
+    flushBlock();
+
+    string footer;
+    putUint64(footer, offset);
+    putUint64(footer, count);
+    putUint64(footer, MAGIC);
+    ofs.write(indexBlock.data(), indexBlock.size());
+    ofs.write(footer.data(), footer.size());
+    ofs.close();
+
+    // The manifest may reference this table as soon as we return
+    if (ofs.fail() || !AtomicFile::syncFile(filepath))
+    {
+        cerr << "Error: Failed to write table file: " << filepath << endl;
+        return false;
+    }
+    return true;
+}
+
+shared_ptr<SSTable> SSTable::open(const string &filepath)
+{
+    auto table = make_shared<SSTable>();
+    table->path = filepath;
+    table->file.open(filepath, ios::binary);
+    if (!table->file.is_open())
+        return nullptr;
+
+    table->file.seekg(0, ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(table->file.tellg());
+    if (fileSize < 24)
+        return nullptr;
+
+    char footer[24];
+    table->file.seekg(fileSize - 24);
+    table->file.read(footer, 24);
+    uint64_t indexOffset = getUint64(footer);
+    table->entryCount = getUint64(footer + 8);
+    uint64_t magic = getUint64(footer + 16);
+    table->checksummed = magic == MAGIC;
+    if (!table->file || (magic != MAGIC && magic != OLD_MAGIC) || indexOffset > fileSize - 24)
+    {
+        cerr << "Error: Corrupt table file: " << filepath << endl;
+        return nullptr;
+    }
+
+    string indexBlock(fileSize - 24 - indexOffset, '\0');
+    table->file.seekg(indexOffset);
+    table->file.read(&indexBlock[0], indexBlock.size());
+    if (!table->file)
+    {
+        cerr << "Error: Cannot read table index: " << filepath << endl;
+        return nullptr;
+    }
+
+    size_t handleSize = table->checksummed ? 16 : 12;
+    size_t pos = 0;
+    while (pos < indexBlock.size())
+    {
+        uint32_t keyLength = pos + 4 <= indexBlock.size() ? getUint32(&indexBlock[pos]) : 0;
+        pos += 4;
+        if (pos + keyLength + handleSize > indexBlock.size())
+        {
+            cerr << "Error: Corrupt table index: " << filepath << endl;
+            return nullptr;
+        }
+
+        BlockHandle handle;
+        handle.lastKey = indexBlock.substr(pos, keyLength);
+        pos += keyLength;
+        handle.offset = getUint64(&indexBlock[pos]);
+        handle.size = getUint32(&indexBlock[pos + 8]);
+        handle.checksum = table->checksummed ? getUint32(&indexBlock[pos + 12]) : 0;
+        pos += handleSize;
+        table->index.push_back(handle);
+    }
+    return table;
+}
+
+bool SSTable::readBlock(size_t blockIndex, vector<Entry> &entries) const
+{
+    entries.clear();
+    if (blockIndex >= index.size())
+        return false;
+
+    const BlockHandle &handle = index[blockIndex];
+    string block(handle.size, '\0');
+    {
+        lock_guard<mutex> lock(fileMutex);
+        file.clear();
+        file.seekg(handle.offset);
+        file.read(&block[0], handle.size);
+        if (!file)
+        {
+            cerr << "Error: Cannot read block " << blockIndex << " of table: " << path << endl;
+            return false;
+        }
+    }
+
+    if (checksummed && WriteAheadLog::crc32(block.data(), block.size()) != handle.checksum)
+    {
+        cerr << "Error: Checksum mismatch in block " << blockIndex << " of table: " << path << endl;
+        return false;
+    }
+
+    size_t pos = 0;
+    while (pos < block.size())
+    {
+        if (pos + 9 > block.size())
+        {
+            cerr << "Error: Corrupt block " << blockIndex << " of table: " << path << endl;
+            return false;
+        }
+        uint32_t keyLength = getUint32(&block[pos]);
+        uint32_t valueLength = getUint32(&block[pos + 4]);
+        bool deleted = block[pos + 8] != 0;
+        pos += 9;
+        if (static_cast<uint64_t>(keyLength) + valueLength > block.size() - pos)
+        {
+            cerr << "Error: Corrupt block " << blockIndex << " of table: " << path << endl;
+            return false;
+        }
+
+        Entry entry;
+        entry.key = block.substr(pos, keyLength);
+        entry.value.data = block.substr(pos + keyLength, valueLength);
+        entry.value.deleted = deleted;
+        entries.push_back(std::move(entry));
+        pos += keyLength + valueLength;
+    }
+    return true;
+}
+
+// First block whose last key is >= key
+size_t SSTable::findBlock(const string &key) const
+{
+    auto it = lower_bound(index.begin(), index.end(), key,
+                          [](const BlockHandle &handle, const string &k)
+                          { return handle.lastKey < k; });
+    return static_cast<size_t>(it - index.begin());
+}
+
+bool SSTable::get(const string &key, StoreValue &value, bool &found) const
+{
+    found = false;
+    size_t blockIndex = findBlock(key);
+    if (blockIndex >= index.size())
+        return true; // past the last key
+
+    vector<Entry> entries;
+    if (!readBlock(blockIndex, entries))
+        return false;
+
+    auto it = lower_bound(entries.begin(), entries.end(), key,
+                          [](const Entry &entry, const string &k)
+                          { return entry.key < k; });
+    if (it != entries.end() && it->key == key)
+    {
+        value = it->value;
+        found = true;
+    }
+    return true;
+}
+
+const string &SSTable::getPath() const
+{
+    return path;
+}
+
+uint64_t SSTable::getEntryCount() const
+{
+    return entryCount;
+}
+
+// Iterator
+SSTable::Iterator::Iterator(shared_ptr<const SSTable> table, const string &startKey)
+    : table(table), blockIndex(table->findBlock(startKey)), position(0), failed(false)
+{
+    loadBlock();
+    while (valid() && block[position].key < startKey)
+        next();
+}
+
+void SSTable::Iterator::loadBlock()
+{
+    position = 0;
+    block.clear();
+    while (blockIndex < table->index.size())
+    {
+        if (!table->readBlock(blockIndex, block))
+        {
+            block.clear();
+            failed = true;
+            return;
+        }
+        if (!block.empty())
+            return;
+        ++blockIndex;
+    }
+}
+
+bool SSTable::Iterator::valid() const
+{
+    return position < block.size();
+}
+
+const SSTable::Entry &SSTable::Iterator::entry() const
+{
+    return block[position];
+}
+
+void SSTable::Iterator::next()
+{
+    if (++position >= block.size())
+    {
+        ++blockIndex;
+        loadBlock();
+    }
+}
+
+bool SSTable::Iterator::ok() const
+{
+    return !failed;
+}
@@ -0,0 +1,103 @@
+#ifndef SSTABLE_H
+#define SSTABLE_H
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+#include <functional>
+#include "memtable.h"
+using namespace std;
+
+// Immutable sorted table on disk.
+// Layout: data blocks of records [keyLen:u32][valueLen:u32][deleted:u8][key][value],
+// then a block index of [keyLen:u32][lastKey][offset:u64][size:u32][crc32:u32] entries,
+// then a footer [indexOffset:u64][entryCount:u64][magic:u64].
+// The block index is kept in memory, so a point read costs at most one block read.
+// A block that cannot be read or fails its checksum is an error, never a
+// missing key: callers must not fall back to older data or drop it.
+class SSTable
+{
+public:
+    struct Entry
+    {
+        string key;
+        StoreValue value;
+    };
+
+    // Streams entries in key order, one block at a time
+    class Iterator
+    {
+    private:
+        shared_ptr<const SSTable> table;
+        size_t blockIndex;
+        vector<Entry> block;
+        size_t position;
+        bool failed;
+
+        void loadBlock();
+
+    public:
+        Iterator(shared_ptr<const SSTable> table, const string &startKey = "");
+        bool valid() const;
+        const Entry &entry() const;
+        void next();
+        // False if a block could not be read; the iterator stopped there
+        bool ok() const;
+    };
+
+private:
+    struct BlockHandle
+    {
+        string lastKey;
+        uint64_t offset;
+        uint32_t size;
+        uint32_t checksum;
+    };
+
+    string path;
+    vector<BlockHandle> index;
+    uint64_t entryCount;
+    mutable ifstream file;
+    mutable mutex fileMutex;
+
+    bool checksummed; // false for tables written before blocks had checksums
+
+    static const uint64_t MAGIC = 0x32425453534D534CULL;    // "LSMSSTB2"
+    static const uint64_t OLD_MAGIC = 0x31425453534D534CULL; // "LSMSSTB1", no checksums
+    static const size_t BLOCK_SIZE = 4096;
+
+    // Helper methods
+    static void putUint32(string &out, uint32_t value);
+    static void putUint64(string &out, uint64_t value);
+    static uint32_t getUint32(const char *in);
+    static uint64_t getUint64(const char *in);
+    static void appendRecord(string &block, const string &key, const StoreValue &value);
+    bool readBlock(size_t blockIndex, vector<Entry> &entries) const;
+    size_t findBlock(const string &key) const;
+
+public:
+    // Constructor/Destructor
+    SSTable() = default;
+    ~SSTable() = default;
+
+    SSTable(const SSTable &) = delete;
+    SSTable &operator=(const SSTable &) = delete;
+
+    // Writes entries (which must be sorted by key) to a new table file.
+    // next() fills the entry and returns false once exhausted.
+    static bool write(const string &filepath, const function<bool(Entry &)> &next, bool dropTombstones = false);
+
+    // Opens an existing table and loads its block index
+    static shared_ptr<SSTable> open(const string &filepath);
+
+    // Looks key up; found tells whether the table has an entry for it
+    // (possibly a tombstone). Returns false if its block could not be read.
+    bool get(const string &key, StoreValue &value, bool &found) const;
+
+    const string &getPath() const;
+    uint64_t getEntryCount() const;
+};
+
+#endif
@@ -0,0 +1,288 @@
+// Recovery checks for file persistence: write-ahead log torn tails and
+// rotate/replay ordering, delta files applied on load and merged into a new
+// base, saves into one open LSM store, and loading a malformed file. Each
+// case works in a fresh directory.
+// usage: library_persistencetest [DIRECTORY]   (default: a directory under /tmp)
+// Prints one line per case and exits with 1 if any check failed.
+#include "Persistence/persistence.h"
+#include "Persistence/wal.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <ctime>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition, const string &what)
+    {
+        if (!condition)
+        {
+            cerr << "  FAILED: " << what << endl;
+            ++failures;
+        }
+    }
+
+    string freshDirectory(const string &root, const string &name)
+    {
+        string directory = (fs::path(root) / name).string();
+        fs::remove_all(directory);
+        fs::create_directories(directory);
+        return directory;
+    }
+
+    // Record numbers replayed from each log in turn, as recovery reads them
+    vector<int> replayAll(const vector<string> &paths)
+    {
+        vector<int> order;
+        for (const auto &path : paths)
+            WriteAheadLog::replay(path, [&](const json &record)
+                                  { order.push_back(record.at("n").get<int>()); });
+        return order;
+    }
+
+    void appendTornRecord(const string &path)
+    {
+        ofstream log(path, ios::binary | ios::app);
+        log.write("\x40\x00\x00\x00\x12\x34", 6);
+    }
+
+    struct LibraryData
+    {
+        vector<User> users;
+        vector<unique_ptr<Resource>> resources;
+        vector<Loan> loans;
+        vector<Reservation> reservations;
+        vector<Notification> notifications;
+        vector<LibraryEvent> events;
+
+        bool save(const string &path) const
+        {
+            return Persistence::saveToFile(path, users, resources, loans, reservations, notifications, events);
+        }
+        bool saveChanges(const string &path, const vector<pair<string, string>> &removed) const
+        {
+            return Persistence::saveChanges(path, users, resources, loans, reservations, notifications, events, removed);
+        }
+        bool load(const string &path)
+        {
+            return Persistence::loadFromFile(path, users, resources, loans, reservations, notifications, events);
+        }
+
+        const User *user(const string &id) const
+        {
+            for (const auto &u : users)
+            {
+                if (u.getUserId() == id)
+                    return &u;
+            }
+            return nullptr;
+        }
+        bool hasLoan(const string &id) const
+        {
+            for (const auto &l : loans)
+            {
+                if (l.getLoanId() == id)
+                    return true;
+            }
+            return false;
+        }
+    };
+
+    string userId(int i)
+    {
+        return "usr" + to_string(1000 + i);
+    }
+
+    Loan makeLoan(const string &id, int user)
+    {
+        time_t now = time(nullptr);
+        return Loan(id, userId(user), "res001", now, now + 14 * 24 * 60 * 60);
+    }
+
+    void walTornTailAndRotation(const string &root)
+    {
+        string directory = freshDirectory(root, "wal");
+        string logPath = (fs::path(directory) / "library.wal").string();
+        string archivePath = logPath + ".archive";
+
+        WriteAheadLog wal;
+        check(wal.open(logPath), "open");
+        wal.append({{"n", 1}});
+        wal.append({{"n", 2}});
+        check(wal.commit(), "commit");
+        check(wal.rotate(archivePath), "rotate into a new archive");
+
+        // A second rotation before the snapshot finished extends the archive
+        wal.append({{"n", 3}});
+        check(wal.commit(), "commit after rotation");
+        appendTornRecord(archivePath);
+        check(wal.rotate(archivePath), "rotate into the existing archive");
+        wal.append({{"n", 4}});
+        check(wal.commit(), "commit to the new log");
+        wal.close();
+
+        check(replayAll({archivePath, logPath}) == vector<int>({1, 2, 3, 4}), "archive then log replays in write order");
+
+        // Replay stops at a torn tail and leaves the file alone
+        uintmax_t intact = fs::file_size(logPath);
+        appendTornRecord(logPath);
+        size_t skipped = 0;
+        check(WriteAheadLog::replay(logPath, [](const json &) {}, &skipped) == 1 && skipped == 0, "replay applies the intact record");
+        check(fs::file_size(logPath) == intact + 6, "replay does not modify the log");
+
+        // Opening for append cuts the tail, so new records follow the intact ones
+        check(wal.open(logPath), "reopen after torn tail");
+        check(fs::file_size(logPath) == intact, "open cuts the torn tail");
+        wal.append({{"n", 5}});
+        check(wal.commit(), "commit after recovery");
+        wal.close();
+        check(replayAll({archivePath, logPath}) == vector<int>({1, 2, 3, 4, 5}), "records after recovery are replayed");
+    }
+
+    void deltaApplyAndMerge(const string &root)
+    {
+        string path = (fs::path(freshDirectory(root, "delta")) / "library.json").string();
+        string delta = path + ".delta";
+
+        LibraryData saved;
+        for (int i = 0; i < 20; i++)
+            saved.users.emplace_back(userId(i), "Reader", "reader" + to_string(i) + "@example.com");
+        saved.loans.push_back(makeLoan("LN001", 0));
+        saved.loans.push_back(makeLoan("LN002", 1));
+        check(saved.save(path), "save base");
+        uintmax_t baseSize = fs::file_size(path);
+
+        // A small change set goes to the delta and leaves the base alone
+        Loan::setMaxRenewals(4);
+        LibraryData changes;
+        changes.users.emplace_back(userId(0), "Renamed", "reader0@example.com");
+        changes.loans.push_back(makeLoan("LN003", 2));
+        check(changes.saveChanges(path, {{"loans", "LN001"}}), "save changes");
+        check(fs::exists(delta) && fs::file_size(path) == baseSize, "changes are appended to the delta");
+
+        Loan::setMaxRenewals();
+        LibraryData loaded;
+        check(loaded.load(path), "load base and delta");
+        check(loaded.users.size() == 20 && loaded.user(userId(0)) && loaded.user(userId(0))->getName() == "Renamed",
+              "changed user replaces the saved one");
+        check(!loaded.hasLoan("LN001") && loaded.hasLoan("LN002") && loaded.hasLoan("LN003"), "delta removes and adds loans");
+        check(Loan::getMaxRenewals() == 4, "delta carries the loan settings");
+
+        // Once the delta outgrows half the base, the next save merges it
+        LibraryData renamed;
+        for (int i = 0; i < 20; i++)
+            renamed.users.emplace_back(userId(i), "Member", "reader" + to_string(i) + "@example.com");
+        for (int round = 0; round < 10 && fs::exists(delta); round++)
+            check(renamed.saveChanges(path, {}), "save changes until the delta is merged");
+        check(!fs::exists(delta), "merge removes the delta");
+
+        LibraryData merged;
+        check(merged.load(path), "load merged base");
+        check(merged.users.size() == 20 && merged.user(userId(0)) && merged.user(userId(0))->getName() == "Member",
+              "merged base holds the latest users");
+        check(!merged.hasLoan("LN001") && merged.hasLoan("LN002") && merged.hasLoan("LN003"), "merged base keeps earlier delta records");
+        Loan::setMaxRenewals();
+    }
+
+    size_t tableFiles(const string &directory)
+    {
+        size_t files = 0;
+        for (const auto &entry : fs::directory_iterator(directory))
+            files += entry.path().extension() == ".sst";
+        return files;
+    }
+
+    void storeStaysOpenAcrossSaves(const string &root)
+    {
+        string path = (fs::path(freshDirectory(root, "store")) / "library.lsm").string();
+
+        LibraryData saved;
+        for (int i = 0; i < 20; i++)
+            saved.users.emplace_back(userId(i), "Reader", "reader" + to_string(i) + "@example.com");
+        check(saved.save(path), "save store");
+
+        for (int round = 0; round < 5; round++)
+        {
+            LibraryData changes;
+            changes.users.emplace_back(userId(round), "Member", "reader" + to_string(round) + "@example.com");
+            check(changes.saveChanges(path, {}), "save changes to store");
+        }
+        check(tableFiles(path) == 0, "saves write into the open store's memtable, not new tables");
+
+        LibraryData loaded;
+        check(loaded.load(path), "load from the open store");
+        check(loaded.users.size() == 20 && loaded.user(userId(4)) && loaded.user(userId(4))->getName() == "Member",
+              "load sees every save");
+
+        Persistence::closeStore(path);
+        check(tableFiles(path) == 1, "closing the store flushes one table");
+        LibraryData reopened;
+        check(reopened.load(path), "load after closing the store");
+        check(reopened.users.size() == 20 && reopened.user(userId(0))->getName() == "Member", "saves survive the close");
+        Persistence::closeStore(path);
+    }
+
+    void malformedFileLeavesConfig(const string &root)
+    {
+        string path = (fs::path(freshDirectory(root, "malformed")) / "library.json").string();
+
+        LibraryData saved;
+        for (int i = 0; i < 50; i++)
+            saved.users.emplace_back(userId(i), "Reader", "reader" + to_string(i) + "@example.com");
+        Loan::setMaxRenewals(7);
+        Loan::setLoanPeriod(30); // days
+        check(saved.save(path), "save");
+
+        // Cut the file inside the users section, after its config
+        fs::resize_file(path, fs::file_size(path) / 2);
+
+        Loan::setMaxRenewals(3);
+        Loan::setLoanPeriod(10);
+        LibraryData loaded;
+        check(!loaded.load(path), "load of a truncated file fails");
+        check(Loan::getMaxRenewals() == 3 && Loan::getLoanPeriod() == 10 * 24 * 60 * 60, "config of a failed load is not applied");
+
+        // Valid Json with an out-of-range setting fails the same way
+        {
+            ofstream ofs(path, ios::trunc);
+            ofs << R"({"config": {"maxRenewals": 99}, "users": []})";
+        }
+        check(!loaded.load(path), "load of an out-of-range config fails");
+        check(Loan::getMaxRenewals() == 3, "out-of-range config is not applied");
+
+        Loan::setMaxRenewals();
+        Loan::setLoanPeriod(14);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    string root = (argc > 1) ? argv[1] : (fs::temp_directory_path() / "library_persistencetest").string();
+    fs::create_directories(root);
+
+    struct Case
+    {
+        const char *name;
+        void (*run)(const string &);
+    };
+    const Case cases[] = {
+        {"log torn tail and rotation order", walTornTailAndRotation},
+        {"delta apply and merge", deltaApplyAndMerge},
+        {"store stays open across saves", storeStaysOpenAcrossSaves},
+        {"malformed file leaves config", malformedFileLeavesConfig},
+    };
+
+    for (const auto &test : cases)
+    {
+        int before = failures;
+        test.run(root);
+        cout << (failures == before ? "ok   " : "FAIL ") << test.name << endl;
+    }
+
+    fs::remove_all(root);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,306 @@
+// Crash-recovery checks for the LSM store: memtable and table shadowing,
+// flushing on a clean close, size-tiered background merges, tombstones
+// across compaction, the manifest, rolling back a failed manifest write,
+// and reopening after a torn write-ahead log tail. Each case works in a
+// fresh store directory.
+// usage: library_storetest [DIRECTORY]   (default: a directory under /tmp)
+// Prints one line per case and exits with 1 if any check failed.
+#include "Storage/lsmstore.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <map>
+#include <thread>
+#include <chrono>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool condition, const string &what)
+    {
+        if (!condition)
+        {
+            cerr << "  FAILED: " << what << endl;
+            ++failures;
+        }
+    }
+
+    // Live value of key, or "<none>"; "<error>" if the read failed
+    string valueOf(const LsmStore &store, const string &key)
+    {
+        string value;
+        bool found;
+        if (!store.get(key, value, found))
+            return "<error>";
+        return found ? value : "<none>";
+    }
+
+    map<string, string> scanAll(const LsmStore &store, const string &prefix, bool *ok = nullptr)
+    {
+        map<string, string> result;
+        bool read = store.scan(prefix, [&](const string &key, const string &value)
+                               {
+                                   check(result.count(key) == 0, "scan visits " + key + " once");
+                                   result[key] = value; });
+        if (ok)
+            *ok = read;
+        return result;
+    }
+
+    string freshDirectory(const string &root, const string &name)
+    {
+        string directory = (fs::path(root) / name).string();
+        fs::remove_all(directory);
+        return directory;
+    }
+
+    size_t tableFiles(const string &directory)
+    {
+        size_t files = 0;
+        for (const auto &entry : fs::directory_iterator(directory))
+            files += entry.path().extension() == ".sst";
+        return files;
+    }
+
+    void memtableShadowsTables(const string &root)
+    {
+        string directory = freshDirectory(root, "shadowing");
+        LsmStore store;
+        check(store.open(directory), "open");
+
+        store.put("book/1", "v1");
+        store.put("book/2", "v1");
+        check(store.flush(), "flush oldest table");
+        store.put("book/1", "v2");
+        check(store.flush(), "flush newer table");
+        store.put("book/1", "v3");
+
+        check(valueOf(store, "book/1") == "v3", "memtable value wins over both tables");
+        check(valueOf(store, "book/2") == "v1", "key only in the oldest table is found");
+        map<string, string> books = scanAll(store, "book/");
+        check(books.size() == 2 && books["book/1"] == "v3", "scan returns the newest value once");
+
+        check(store.flush(), "flush memtable");
+        check(valueOf(store, "book/1") == "v3", "newest table wins over older ones");
+
+        store.close();
+        check(store.open(directory), "reopen");
+        check(valueOf(store, "book/1") == "v3", "newest value survives reopen");
+        check(store.tableCount() == 3, "manifest lists every table");
+    }
+
+    void tombstonesAcrossCompaction(const string &root)
+    {
+        string directory = freshDirectory(root, "tombstones");
+        LsmStore store;
+        check(store.open(directory, 4 * 1024 * 1024, 100), "open"); // no background merges
+
+        for (int i = 0; i < 1000; i++)
+            store.put("loan/" + to_string(1000 + i), "active");
+        check(store.flush(), "flush values");
+        for (int i = 0; i < 1000; i += 2)
+            store.remove("loan/" + to_string(1000 + i));
+        check(store.flush(), "flush tombstones");
+
+        check(valueOf(store, "loan/1000") == "<none>", "tombstone in a newer table hides the value");
+        check(scanAll(store, "loan/").size() == 500, "scan skips removed keys");
+
+        check(store.compact(), "compact");
+        check(store.tableCount() == 1, "compaction leaves one table");
+        check(valueOf(store, "loan/1000") == "<none>", "removed key stays removed after compaction");
+        check(valueOf(store, "loan/1001") == "active", "live key survives compaction");
+
+        // The merged table dropped the tombstones; nothing older may resurface
+        store.close();
+        check(store.open(directory), "reopen");
+        map<string, string> loans = scanAll(store, "loan/");
+        check(loans.size() == 500 && loans.count("loan/1000") == 0, "removed keys stay removed after reopen");
+
+        check(tableFiles(directory) == 1, "compaction deletes its input tables");
+    }
+
+    void closeFlushesMemtable(const string &root)
+    {
+        string directory = freshDirectory(root, "close");
+        string logPath = (fs::path(directory) / "memtable.wal").string();
+        LsmStore store;
+        check(store.open(directory), "open");
+        store.put("user/1", "alice");
+        store.close();
+        check(fs::file_size(logPath) == 0, "clean close leaves no log to replay");
+
+        check(store.open(directory), "reopen");
+        check(store.tableCount() == 1 && valueOf(store, "user/1") == "alice", "memtable was flushed to a table");
+    }
+
+    bool waitForTables(const LsmStore &store, size_t count)
+    {
+        for (int i = 0; i < 500 && store.tableCount() != count; i++)
+            this_thread::sleep_for(chrono::milliseconds(10));
+        return store.tableCount() == count;
+    }
+
+    void backgroundMergesSizeTiers(const string &root)
+    {
+        string directory = freshDirectory(root, "tiers");
+        LsmStore store;
+        check(store.open(directory, 4 * 1024 * 1024, 4), "open");
+
+        // One large table, well above the small tables' tier
+        for (int i = 0; i < 20000; i++)
+            store.put("book/" + to_string(100000 + i), "base");
+        check(store.flush(), "flush large table");
+        fs::path large = fs::path(directory) / "000001.sst";
+
+        store.put("book/100000", "updated");
+        check(store.flush(), "flush small table");
+        store.remove("book/100001");
+        check(store.flush(), "flush small table");
+        store.put("book/200000", "new");
+        check(store.flush(), "flush small table");
+        store.put("book/200001", "new");
+        check(store.flush(), "flush small table");
+
+        check(waitForTables(store, 2), "background thread merges the small tables");
+        check(fs::exists(large), "merge leaves the large table alone");
+        check(valueOf(store, "book/100000") == "updated", "merged table shadows the large one");
+        check(valueOf(store, "book/100001") == "<none>", "tombstone is kept while an older table holds the key");
+        check(scanAll(store, "book/").size() == 20001, "scan sees every live key");
+    }
+
+    void failedManifestRollsBack(const string &root)
+    {
+        string directory = freshDirectory(root, "manifest");
+        LsmStore store;
+        check(store.open(directory, 4 * 1024 * 1024, 100), "open");
+        store.put("book/1", "v1");
+        check(store.flush(), "flush first table");
+        store.put("book/2", "v1");
+        check(store.flush(), "flush second table");
+        store.put("book/3", "v1");
+
+        // A directory in the way of the manifest's temporary file fails the write
+        string blocker = (fs::path(directory) / "MANIFEST.tmp").string();
+        fs::create_directory(blocker);
+        check(!store.flush(), "flush fails when the manifest cannot be written");
+        check(store.tableCount() == 2 && tableFiles(directory) == 2, "failed flush leaves no table behind");
+        check(!store.compact(), "compaction fails when the manifest cannot be written");
+        check(store.tableCount() == 2 && tableFiles(directory) == 2, "failed compaction keeps its inputs");
+        check(valueOf(store, "book/1") == "v1" && valueOf(store, "book/3") == "v1", "reads still see every write");
+
+        fs::remove(blocker);
+        check(store.flush(), "flush once the manifest can be written");
+        check(store.tableCount() == 3 && tableFiles(directory) == 3, "the retried flush writes one table");
+        check(store.compact() && store.tableCount() == 1, "compaction once the manifest can be written");
+        store.close();
+        check(store.open(directory, 4 * 1024 * 1024, 100), "reopen");
+        check(scanAll(store, "book/").size() == 3, "all writes survive");
+    }
+
+    void reopenAfterTornLog(const string &root)
+    {
+        string live = freshDirectory(root, "tornlog-live");
+        string directory = freshDirectory(root, "tornlog");
+        string logPath = (fs::path(directory) / "memtable.wal").string();
+        {
+            LsmStore store;
+            check(store.open(live), "open");
+            store.put("user/1", "alice");
+            store.put("user/2", "bob");
+            check(store.sync(), "sync");
+
+            // What a crash leaves on disk: the synced log and no table
+            fs::copy(live, directory, fs::copy_options::recursive);
+        }
+
+        // A write cut short by a crash: half a record after the intact ones
+        uintmax_t intact = fs::file_size(logPath);
+        {
+            ofstream log(logPath, ios::binary | ios::app);
+            log.write("\x40\x00\x00\x00\x12\x34", 6);
+        }
+
+        LsmStore store;
+        check(store.open(directory), "reopen after torn tail");
+        check(valueOf(store, "user/1") == "alice" && valueOf(store, "user/2") == "bob", "intact records are replayed");
+        check(fs::file_size(logPath) == intact, "torn tail is cut off");
+
+        // Writes after the recovery must not land behind the torn bytes
+        store.put("user/3", "carol");
+        check(store.sync(), "sync after recovery");
+        store.close();
+        check(store.open(directory), "reopen again");
+        check(scanAll(store, "user/").size() == 3, "writes after recovery survive");
+    }
+
+    void corruptBlockIsAnError(const string &root)
+    {
+        string directory = freshDirectory(root, "corrupt");
+        {
+            LsmStore store;
+            check(store.open(directory, 4 * 1024 * 1024, 100), "open");
+            for (int i = 0; i < 200; i++)
+                store.put("res/" + to_string(100 + i), "old");
+            check(store.flush(), "flush older table");
+            for (int i = 0; i < 200; i++)
+                store.put("res/" + to_string(100 + i), "new");
+            check(store.flush(), "flush newer table");
+        }
+
+        // Flip a byte in the first block of the newer table
+        fs::path newest;
+        for (const auto &entry : fs::directory_iterator(directory))
+        {
+            if (entry.path().extension() == ".sst" && (newest.empty() || entry.path() > newest))
+                newest = entry.path();
+        }
+        {
+            fstream table(newest, ios::in | ios::out | ios::binary);
+            table.seekp(20);
+            table.put('#');
+        }
+
+        LsmStore store;
+        check(store.open(directory, 4 * 1024 * 1024, 100), "reopen");
+        check(valueOf(store, "res/100") == "<error>", "read of a bad block fails instead of returning the older value");
+        bool ok = true;
+        scanAll(store, "res/", &ok);
+        check(!ok, "scan over a bad block fails");
+        check(!store.compact(), "compaction over a bad block fails");
+        check(store.tableCount() == 2 && fs::exists(newest), "failed compaction keeps its inputs");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    string root = (argc > 1) ? argv[1] : (fs::temp_directory_path() / "library_storetest").string();
+    fs::create_directories(root);
+
+    struct Case
+    {
+        const char *name;
+        void (*run)(const string &);
+    };
+    const Case cases[] = {
+        {"memtable and table shadowing", memtableShadowsTables},
+        {"clean close flushes the memtable", closeFlushesMemtable},
+        {"background merges one size tier", backgroundMergesSizeTiers},
+        {"tombstones across compaction", tombstonesAcrossCompaction},
+        {"failed manifest write rolls back", failedManifestRollsBack},
+        {"reopen after a torn log tail", reopenAfterTornLog},
+        {"corrupt block is an error", corruptBlockIsAnError},
+    };
+
+    for (const auto &test : cases)
+    {
+        int before = failures;
+        test.run(root);
+        cout << (failures == before ? "ok   " : "FAIL ") << test.name << endl;
+    }
+
+    fs::remove_all(root);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,200 @@
+#include "textsearch.h"
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define TEXTSEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    inline unsigned char foldChar(unsigned char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+    }
+
+    // Compares m bytes ignoring ASCII case; needle is already lowercase
+    inline bool equalFolded(const char *text, const char *needle, size_t m)
+    {
+        for (size_t i = 0; i < m; i++)
+        {
+            if (foldChar(text[i]) != static_cast<unsigned char>(needle[i]))
+                return false;
+        }
+        return true;
+    }
+
+    // Needles are short (search keywords), so fold them onto the stack
+    const size_t MAX_STACK_NEEDLE = 256;
+}
+
+bool TextSearch::searchScalar(const char *haystack, size_t n, const char *needle, size_t m)
+{
+    unsigned char first = needle[0];
+    for (size_t i = 0; i + m <= n; i++)
+    {
+        if (foldChar(haystack[i]) == first && equalFolded(haystack + i + 1, needle + 1, m - 1))
+            return true;
+    }
+    return false;
+}
+
+#ifdef TEXTSEARCH_X86
+
+// Lowercases 'A'..'Z' in a 16-byte block: shift the range to the bottom of
+// the signed byte range so a single signed compare selects it.
+static inline __m128i foldBlock128(__m128i block)
+{
+    const __m128i shift = _mm_set1_epi8(static_cast<char>(128 - 'A'));
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(-128 + 26));
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    __m128i isUpper = _mm_cmplt_epi8(_mm_add_epi8(block, shift), limit);
+    return _mm_or_si128(block, _mm_and_si128(isUpper, caseBit));
+}
+
+// Compares the first and last needle characters against 16 candidate
+// positions at once and only verifies the positions where both match.
+bool TextSearch::searchSSE2(const char *haystack, size_t n, const char *needle, size_t m)
+{
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[m - 1]);
+
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16)
+    {
+        __m128i blockFirst = foldBlock128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i)));
+        __m128i blockLast = foldBlock128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i + m - 1)));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first),
+                                                        _mm_cmpeq_epi8(blockLast, last)));
+        while (mask != 0)
+        {
+            unsigned bit = __builtin_ctz(mask);
+            if (m <= 2 || equalFolded(haystack + i + bit + 1, needle + 1, m - 2))
+                return true;
+            mask &= mask - 1;
+        }
+    }
+
+    // Remaining positions
+    return (i + m <= n) && searchScalar(haystack + i, n - i, needle, m);
+}
+
+__attribute__((target("avx2"))) static inline __m256i foldBlock256(__m256i block)
+{
+    const __m256i shift = _mm256_set1_epi8(static_cast<char>(128 - 'A'));
+    const __m256i limit = _mm256_set1_epi8(static_cast<char>(-128 + 26));
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    __m256i isUpper = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(block, shift));
+    return _mm256_or_si256(block, _mm256_and_si256(isUpper, caseBit));
+}
+
+__attribute__((target("avx2"))) bool TextSearch::searchAVX2(const char *haystack, size_t n, const char *needle, size_t m)
+{
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= n; i += 32)
+    {
+        __m256i blockFirst = foldBlock256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i)));
+        __m256i blockLast = foldBlock256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i + m - 1)));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, last))));
+        while (mask != 0)
+        {
+            unsigned bit = __builtin_ctz(mask);
+            if (m <= 2 || equalFolded(haystack + i + bit + 1, needle + 1, m - 2))
+                return true;
+            mask &= mask - 1;
+        }
+    }
+
+    // Fewer than 32 positions left, finish with the 16-byte kernel
+    return (i + m <= n) && searchSSE2(haystack + i, n - i, needle, m);
+}
+
+TextSearch::SearchKernel TextSearch::selectKernel()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return &TextSearch::searchAVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return &TextSearch::searchSSE2;
+    return &TextSearch::searchScalar;
+}
+
+#else
+
+bool TextSearch::searchSSE2(const char *haystack, size_t n, const char *needle, size_t m)
+{
+    return searchScalar(haystack, n, needle, m);
+}
+
+bool TextSearch::searchAVX2(const char *haystack, size_t n, const char *needle, size_t m)
+{
+    return searchScalar(haystack, n, needle, m);
+}
+
+TextSearch::SearchKernel TextSearch::selectKernel()
+{
+    return &TextSearch::searchScalar;
+}
+
+#endif
+
+bool TextSearch::containsIgnoreCase(const char *haystack, size_t n, const char *needle, size_t m)
+{
+    if (m == 0 || n == 0 || m > n)
+        return false;
+
+    static const SearchKernel kernel = selectKernel();
+
+    char stackNeedle[MAX_STACK_NEEDLE];
+    string heapNeedle;
+    char *folded = stackNeedle;
+    if (m > MAX_STACK_NEEDLE)
+    {
+        heapNeedle.resize(m);
+        folded = &heapNeedle[0];
+    }
+    for (size_t i = 0; i < m; i++)
+        folded[i] = static_cast<char>(foldChar(needle[i]));
+
+    return kernel(haystack, n, folded, m);
+}
+
+bool TextSearch::containsIgnoreCase(const string &haystack, const string &needle)
+{
+    return containsIgnoreCase(haystack.data(), haystack.length(), needle.data(), needle.length());
+}
+
+void TextSearch::toLowerInPlace(string &str)
+{
+    size_t i = 0;
+#ifdef TEXTSEARCH_X86
+    for (; i + 16 <= str.length(); i += 16)
+    {
+        __m128i *block = reinterpret_cast<__m128i *>(&str[i]);
+        _mm_storeu_si128(block, foldBlock128(_mm_loadu_si128(block)));
+    }
+#endif
+    for (; i < str.length(); i++)
+        str[i] = static_cast<char>(foldChar(str[i]));
+}
+
+string TextSearch::toLower(const string &str)
+{
+    string result = str;
+    toLowerInPlace(result);
+    return result;
+}
+
+const char *TextSearch::kernelName()
+{
+    SearchKernel kernel = selectKernel();
+    if (kernel == &TextSearch::searchAVX2)
+        return "avx2";
+    if (kernel == &TextSearch::searchSSE2)
+        return "sse2";
+    return "scalar";
+}
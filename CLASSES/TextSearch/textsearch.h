@@ -0,0 +1,36 @@
+#ifndef TEXTSEARCH_H
+#define TEXTSEARCH_H
+#include <string>
+#include <cstddef>
+using namespace std;
+
+// ASCII case-insensitive string helpers.
+// The substring search compares blocks of 16 (SSE2) or 32 (AVX2) bytes at a
+// time, folding case in registers, so no lowercase copies are made. The
+// implementation is picked once at runtime from what the CPU supports.
+class TextSearch
+{
+private:
+    typedef bool (*SearchKernel)(const char *, size_t, const char *, size_t);
+
+    // Kernels
+    static bool searchScalar(const char *haystack, size_t n, const char *needle, size_t m);
+    static bool searchSSE2(const char *haystack, size_t n, const char *needle, size_t m);
+    static bool searchAVX2(const char *haystack, size_t n, const char *needle, size_t m);
+    static SearchKernel selectKernel();
+
+public:
+    // True if needle occurs in haystack ignoring ASCII case.
+    // An empty needle or haystack never matches, as with Resource::contains.
+    static bool containsIgnoreCase(const string &haystack, const string &needle);
+    static bool containsIgnoreCase(const char *haystack, size_t n, const char *needle, size_t m);
+
+    // ASCII lowercase conversion
+    static void toLowerInPlace(string &str);
+    static string toLower(const string &str);
+
+    // Name of the kernel in use ("avx2", "sse2" or "scalar")
+    static const char *kernelName();
+};
+
+#endif